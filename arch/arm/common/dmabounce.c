@@ -277,6 +277,7 @@ static inline dma_addr_t map_single(struct device *dev, void *ptr, size_t size,
 		 * We don't need to sync the DMA buffer since
 		 * it was allocated via the coherent allocators.
 		 */
+		dma_cache_stat_cpu_to_dev(dev, size, dir);
 		__dma_single_cpu_to_dev(ptr, size, dir);
 	}
 
@@ -316,6 +317,7 @@ static inline void unmap_single(struct device *dev, dma_addr_t dma_addr,
 		}
 		free_safe_buffer(dev->archdata.dmabounce, buf);
 	} else {
+		dma_cache_stat_dev_to_cpu(dev, size, dir);
 		__dma_single_dev_to_cpu(dma_to_virt(dev, dma_addr), size, dir);
 	}
 }
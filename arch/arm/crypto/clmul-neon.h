@@ -0,0 +1,59 @@
+/*
+ *  linux/arch/arm/crypto/clmul-neon.h
+ *
+ *  64x64 bit carry-less multiply for NEON, for use from assembler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * ARMv7 NEON only has an 8x8 bit carry-less multiply (vmull.p8), so the
+ * 64x64 bit product is put together from eight of them.  The construction
+ * is the one from Camara, Gouvea, Lopez and Dahab, "Fast Software
+ * Polynomial Multiplication on ARM Processors using the NEON Engine".
+ */
+
+/*
+ * \rq = \a * \b as polynomials over GF(2).  \rl/\rh are the two halves of
+ * \rq.  Clobbers q11 - q14; expects the masks in d30 (k48), d31 (k32) and
+ * d7 (k16).
+ */
+	.macro	clmul64, rq, rl, rh, a, b
+	vext.8		d22, \a, \a, #1		@ A1
+	vmull.p8	q11, d22, \b		@ F = A1*B
+	vext.8		\rl, \b, \b, #1		@ B1
+	vmull.p8	\rq, \a, \rl		@ E = A*B1
+	vext.8		d24, \a, \a, #2		@ A2
+	vmull.p8	q12, d24, \b		@ H = A2*B
+	vext.8		d28, \b, \b, #2		@ B2
+	vmull.p8	q14, \a, d28		@ G = A*B2
+	vext.8		d26, \a, \a, #3		@ A3
+	veor		q11, q11, \rq		@ L = E + F
+	vmull.p8	q13, d26, \b		@ J = A3*B
+	vext.8		\rl, \b, \b, #3		@ B3
+	veor		q12, q12, q14		@ M = G + H
+	vmull.p8	\rq, \a, \rl		@ I = A*B3
+	veor		d22, d22, d23		@ t0 = (L) (P0 + P1) << 8
+	vand		d23, d23, d30
+	vext.8		d28, \b, \b, #4		@ B4
+	veor		d24, d24, d25		@ t1 = (M) (P2 + P3) << 16
+	vand		d25, d25, d31
+	vmull.p8	q14, \a, d28		@ K = A*B4
+	veor		q13, q13, \rq		@ N = I + J
+	veor		d22, d22, d23
+	veor		d24, d24, d25
+	veor		d26, d26, d27		@ t2 = (N) (P4 + P5) << 24
+	vand		d27, d27, d7
+	vext.8		q11, q11, q11, #15
+	veor		d28, d28, d29		@ t3 = (K) (P6 + P7) << 32
+	vmov.i64	d29, #0
+	vext.8		q12, q12, q12, #14
+	veor		d26, d26, d27
+	vmull.p8	\rq, \a, \b		@ D = A*B
+	vext.8		q14, q14, q14, #12
+	vext.8		q13, q13, q13, #13
+	veor		q11, q11, q12
+	veor		q13, q13, q14
+	veor		\rq, \rq, q11
+	veor		\rq, \rq, q13
+	.endm
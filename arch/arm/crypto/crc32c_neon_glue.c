@@ -0,0 +1,210 @@
+/*
+ * CRC32c (Castagnoli) using the NEON polynomial multiply for the bulk of
+ * long buffers.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * Short buffers, callers in interrupt context and the head and tail of
+ * each buffer go through the slice-by-8 __crc32c_le() from lib/crc32.c.
+ * Whether the NEON code is faster than that depends on the core (the
+ * 64x64 bit multiply is built from eight vmull.p8), so the module only
+ * registers if it wins a short benchmark at load time.
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/crc32.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+/* below this, the table code is faster than saving the NEON state */
+#define CRC32C_NEON_MIN		256
+
+asmlinkage void crc32_neon_fold(u64 x[], const u8 *src, int blocks,
+				const u64 k[]);
+
+/* x^160 mod P and x^96 mod P, bit reflected, for the CRC32c polynomial */
+static const u64 crc32c_neon_k[2] = { 0x00000000f20c0dfeULL,
+				      0x000000014cd00bd6ULL };
+
+static u32 crc32c_neon_le(u32 crc, const u8 *p, size_t len)
+{
+	u64 x[2];
+	u8 rem[16];
+	int blocks;
+
+	if (len < CRC32C_NEON_MIN || !may_use_neon())
+		return __crc32c_le(crc, p, len);
+
+	blocks = len / 16 - 1;
+	x[0] = get_unaligned_le64(p) ^ crc;
+	x[1] = get_unaligned_le64(p + 8);
+
+	kernel_neon_begin();
+	crc32_neon_fold(x, p + 16, blocks, crc32c_neon_k);
+	kernel_neon_end();
+
+	/* the CRC of the remainder with no initial value reduces it */
+	put_unaligned_le64(x[0], rem);
+	put_unaligned_le64(x[1], rem + 8);
+	crc = __crc32c_le(0, rem, sizeof(rem));
+
+	return __crc32c_le(crc, p + 16 * (blocks + 1), len % 16);
+}
+
+/*
+ * Setting the seed allows arbitrary accumulators and flexible XOR policy
+ * If your algorithm starts with ~0, then XOR with ~0 before you set
+ * the seed.
+ */
+static int crc32c_neon_setkey(struct crypto_shash *hash, const u8 *key,
+			      unsigned int keylen)
+{
+	u32 *mctx = crypto_shash_ctx(hash);
+
+	if (keylen != sizeof(u32)) {
+		crypto_shash_set_flags(hash, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	*mctx = le32_to_cpup((__le32 *)key);
+	return 0;
+}
+
+static int crc32c_neon_init(struct shash_desc *desc)
+{
+	u32 *mctx = crypto_shash_ctx(desc->tfm);
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = *mctx;
+
+	return 0;
+}
+
+static int crc32c_neon_update(struct shash_desc *desc, const u8 *data,
+			      unsigned int len)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = crc32c_neon_le(*crcp, data, len);
+	return 0;
+}
+
+static int __crc32c_neon_finup(u32 *crcp, const u8 *data, unsigned int len,
+			       u8 *out)
+{
+	*(__le32 *)out = ~cpu_to_le32(crc32c_neon_le(*crcp, data, len));
+	return 0;
+}
+
+static int crc32c_neon_finup(struct shash_desc *desc, const u8 *data,
+			     unsigned int len, u8 *out)
+{
+	return __crc32c_neon_finup(shash_desc_ctx(desc), data, len, out);
+}
+
+static int crc32c_neon_final(struct shash_desc *desc, u8 *out)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32p(crcp);
+	return 0;
+}
+
+static int crc32c_neon_digest(struct shash_desc *desc, const u8 *data,
+			      unsigned int len, u8 *out)
+{
+	return __crc32c_neon_finup(crypto_shash_ctx(desc->tfm), data, len,
+				   out);
+}
+
+static int crc32c_neon_cra_init(struct crypto_tfm *tfm)
+{
+	u32 *key = crypto_tfm_ctx(tfm);
+
+	*key = ~0;
+
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.setkey			=	crc32c_neon_setkey,
+	.init			=	crc32c_neon_init,
+	.update			=	crc32c_neon_update,
+	.final			=	crc32c_neon_final,
+	.finup			=	crc32c_neon_finup,
+	.digest			=	crc32c_neon_digest,
+	.descsize		=	sizeof(u32),
+	.digestsize		=	CHKSUM_DIGEST_SIZE,
+	.base			=	{
+		.cra_name		=	"crc32c",
+		.cra_driver_name	=	"crc32c-neon",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		=	sizeof(u32),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32c_neon_cra_init,
+	}
+};
+
+#define BENCH_LEN	4096
+#define BENCH_LOOPS	32
+
+static s64 __init crc32c_neon_bench(const u8 *buf,
+				    u32 (*fn)(u32, const u8 *, size_t))
+{
+	ktime_t start;
+	u32 crc = ~0;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; i++)
+		crc = fn(crc, buf, BENCH_LEN);
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int __init crc32c_neon_mod_init(void)
+{
+	s64 table, neon;
+	u8 *buf;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	buf = kzalloc(BENCH_LEN, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	crc32c_neon_bench(buf, __crc32c_le);
+	table = crc32c_neon_bench(buf, __crc32c_le);
+	neon = crc32c_neon_bench(buf, crc32c_neon_le);
+	kfree(buf);
+
+	printk(KERN_INFO "crc32c-neon: table %lld ns, neon %lld ns per %d KiB\n",
+	       table, neon, BENCH_LEN * BENCH_LOOPS / 1024);
+	if (neon >= table)
+		return -ENODEV;
+
+	return crypto_register_shash(&alg);
+}
+
+static void __exit crc32c_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(crc32c_neon_mod_init);
+module_exit(crc32c_neon_mod_fini);
+
+MODULE_DESCRIPTION("CRC32c (Castagnoli), NEON accelerated");
+MODULE_LICENSE("GPL");
+
+MODULE_ALIAS("crc32c");
+MODULE_ALIAS("crc32c-neon");
@@ -0,0 +1,214 @@
+/*
+ * GHASH: digest algorithm for GCM (Galois/Counter Mode), NEON version.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/gf128mul.h>
+#include <crypto/internal/hash.h>
+#include <linux/crypto.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+
+#define GHASH_BLOCK_SIZE	16
+#define GHASH_DIGEST_SIZE	16
+
+struct ghash_key {
+	u64 h[2];			/* twisted hash key for the NEON code */
+	struct gf128mul_4k *gf128;	/* for use in interrupt context */
+};
+
+struct ghash_desc_ctx {
+	u64 digest[2];
+	u8 buf[GHASH_BLOCK_SIZE];
+	u32 count;
+};
+
+asmlinkage void ghash_neon_update(int blocks, u64 dg[], const u8 *src,
+				  const u64 key[]);
+
+static int ghash_init(struct shash_desc *desc)
+{
+	struct ghash_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*ctx = (struct ghash_desc_ctx){};
+	return 0;
+}
+
+/*
+ * NEON can't be used in interrupt context (IPsec runs from softirq) or
+ * inside another kernel_neon_begin() section, so do those blocks with the same 4k table multiply as ghash-generic.  The
+ * digest is kept as a 128 bit integer in GHASH bit order, low half first.
+ */
+static void ghash_blocks_generic(int blocks, u64 dg[], const u8 *src,
+				 struct ghash_key *key)
+{
+	be128 y = { cpu_to_be64(dg[1]), cpu_to_be64(dg[0]) };
+
+	while (blocks--) {
+		crypto_xor((u8 *)&y, src, GHASH_BLOCK_SIZE);
+		gf128mul_4k_lle(&y, key->gf128);
+		src += GHASH_BLOCK_SIZE;
+	}
+
+	dg[1] = be64_to_cpu(y.a);
+	dg[0] = be64_to_cpu(y.b);
+}
+
+static void ghash_do_update(int blocks, u64 dg[], const u8 *src,
+			    struct ghash_key *key, const u8 *head)
+{
+	if (!may_use_neon()) {
+		if (head)
+			ghash_blocks_generic(1, dg, head, key);
+		ghash_blocks_generic(blocks, dg, src, key);
+		return;
+	}
+
+	kernel_neon_begin();
+	if (head)
+		ghash_neon_update(1, dg, head, key->h);
+	if (blocks)
+		ghash_neon_update(blocks, dg, src, key->h);
+	kernel_neon_end();
+}
+
+static int ghash_update(struct shash_desc *desc, const u8 *src,
+			unsigned int len)
+{
+	struct ghash_desc_ctx *ctx = shash_desc_ctx(desc);
+	struct ghash_key *key = crypto_shash_ctx(desc->tfm);
+	unsigned int partial = ctx->count % GHASH_BLOCK_SIZE;
+
+	if (!key->gf128)
+		return -ENOKEY;
+
+	ctx->count += len;
+
+	if (partial + len >= GHASH_BLOCK_SIZE) {
+		int blocks;
+
+		if (partial) {
+			int p = GHASH_BLOCK_SIZE - partial;
+
+			memcpy(ctx->buf + partial, src, p);
+			src += p;
+			len -= p;
+		}
+
+		blocks = len / GHASH_BLOCK_SIZE;
+		len %= GHASH_BLOCK_SIZE;
+
+		ghash_do_update(blocks, ctx->digest, src, key,
+				partial ? ctx->buf : NULL);
+		src += blocks * GHASH_BLOCK_SIZE;
+		partial = 0;
+	}
+	if (len)
+		memcpy(ctx->buf + partial, src, len);
+	return 0;
+}
+
+static int ghash_final(struct shash_desc *desc, u8 *dst)
+{
+	struct ghash_desc_ctx *ctx = shash_desc_ctx(desc);
+	struct ghash_key *key = crypto_shash_ctx(desc->tfm);
+	unsigned int partial = ctx->count % GHASH_BLOCK_SIZE;
+
+	if (!key->gf128)
+		return -ENOKEY;
+
+	if (partial) {
+		memset(ctx->buf + partial, 0, GHASH_BLOCK_SIZE - partial);
+		ghash_do_update(1, ctx->digest, ctx->buf, key, NULL);
+	}
+	put_unaligned_be64(ctx->digest[1], dst);
+	put_unaligned_be64(ctx->digest[0], dst + 8);
+
+	*ctx = (struct ghash_desc_ctx){};
+	return 0;
+}
+
+static int ghash_setkey(struct crypto_shash *tfm,
+			const u8 *inkey, unsigned int keylen)
+{
+	struct ghash_key *key = crypto_shash_ctx(tfm);
+	u64 a, b;
+
+	if (keylen != GHASH_BLOCK_SIZE) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+
+	if (key->gf128)
+		gf128mul_free_4k(key->gf128);
+	key->gf128 = gf128mul_init_4k_lle((be128 *)inkey);
+	if (!key->gf128)
+		return -ENOMEM;
+
+	/* perform multiplication by 'x' in GF(2^128) */
+	a = get_unaligned_be64(inkey);
+	b = get_unaligned_be64(inkey + 8);
+
+	key->h[0] = (b << 1) | (a >> 63);
+	key->h[1] = (a << 1) | (b >> 63);
+
+	if (a >> 63)
+		key->h[1] ^= 0xc200000000000000ULL;
+
+	return 0;
+}
+
+static void ghash_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct ghash_key *key = crypto_tfm_ctx(tfm);
+
+	if (key->gf128)
+		gf128mul_free_4k(key->gf128);
+}
+
+static struct shash_alg ghash_alg = {
+	.digestsize	= GHASH_DIGEST_SIZE,
+	.init		= ghash_init,
+	.update		= ghash_update,
+	.final		= ghash_final,
+	.setkey		= ghash_setkey,
+	.descsize	= sizeof(struct ghash_desc_ctx),
+	.base		= {
+		.cra_name		= "ghash",
+		.cra_driver_name	= "ghash-neon",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= GHASH_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(struct ghash_key),
+		.cra_module		= THIS_MODULE,
+		.cra_list		= LIST_HEAD_INIT(ghash_alg.base.cra_list),
+		.cra_exit		= ghash_exit_tfm,
+	},
+};
+
+static int __init ghash_neon_mod_init(void)
+{
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	return crypto_register_shash(&ghash_alg);
+}
+
+static void __exit ghash_neon_mod_exit(void)
+{
+	crypto_unregister_shash(&ghash_alg);
+}
+
+module_init(ghash_neon_mod_init);
+module_exit(ghash_neon_mod_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("GHASH Message Digest Algorithm, NEON accelerated");
+MODULE_ALIAS("ghash");
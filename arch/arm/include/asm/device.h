@@ -10,6 +10,9 @@ struct dev_archdata {
 #ifdef CONFIG_DMABOUNCE
 	struct dmabounce_device_info *dmabounce;
 #endif
+#ifdef CONFIG_DMA_CACHE_STATS
+	struct dma_cache_stats *dma_stats;
+#endif
 };
 
 struct pdev_archdata {
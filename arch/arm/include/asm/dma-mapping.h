@@ -115,6 +115,38 @@ static inline void __dma_page_dev_to_cpu(struct page *page, unsigned long off,
 		___dma_page_dev_to_cpu(page, off, size, dir);
 }
 
+/*
+ * Per device accounting of the cache maintenance done for streaming DMA,
+ * see CONFIG_DMA_CACHE_STATS.
+ */
+#ifdef CONFIG_DMA_CACHE_STATS
+extern void dma_cache_stats_add(struct device *dev, size_t cleaned,
+	size_t invalidated);
+#else
+static inline void dma_cache_stats_add(struct device *dev, size_t cleaned,
+	size_t invalidated)
+{
+}
+#endif
+
+static inline void dma_cache_stat_cpu_to_dev(struct device *dev, size_t size,
+	enum dma_data_direction dir)
+{
+	if (arch_is_coherent())
+		return;
+	if (dir == DMA_FROM_DEVICE)
+		dma_cache_stats_add(dev, 0, size);
+	else
+		dma_cache_stats_add(dev, size, 0);
+}
+
+static inline void dma_cache_stat_dev_to_cpu(struct device *dev, size_t size,
+	enum dma_data_direction dir)
+{
+	if (!arch_is_coherent() && dir != DMA_TO_DEVICE)
+		dma_cache_stats_add(dev, 0, size);
+}
+
 /*
  * Return whether the given device DMA address mask can be supported
  * properly.  For example, if your device can only drive the low 24-bits
@@ -331,6 +363,7 @@ static inline int dmabounce_sync_for_device(struct device *d, dma_addr_t addr,
 static inline dma_addr_t __dma_map_single(struct device *dev, void *cpu_addr,
 		size_t size, enum dma_data_direction dir)
 {
+	dma_cache_stat_cpu_to_dev(dev, size, dir);
 	__dma_single_cpu_to_dev(cpu_addr, size, dir);
 	return virt_to_dma(dev, cpu_addr);
 }
@@ -338,6 +371,7 @@ static inline dma_addr_t __dma_map_single(struct device *dev, void *cpu_addr,
 static inline dma_addr_t __dma_map_page(struct device *dev, struct page *page,
 	     unsigned long offset, size_t size, enum dma_data_direction dir)
 {
+	dma_cache_stat_cpu_to_dev(dev, size, dir);
 	__dma_page_cpu_to_dev(page, offset, size, dir);
 	return pfn_to_dma(dev, page_to_pfn(page)) + offset;
 }
@@ -345,12 +379,14 @@ static inline dma_addr_t __dma_map_page(struct device *dev, struct page *page,
 static inline void __dma_unmap_single(struct device *dev, dma_addr_t handle,
 		size_t size, enum dma_data_direction dir)
 {
+	dma_cache_stat_dev_to_cpu(dev, size, dir);
 	__dma_single_dev_to_cpu(dma_to_virt(dev, handle), size, dir);
 }
 
 static inline void __dma_unmap_page(struct device *dev, dma_addr_t handle,
 		size_t size, enum dma_data_direction dir)
 {
+	dma_cache_stat_dev_to_cpu(dev, size, dir);
 	__dma_page_dev_to_cpu(pfn_to_page(dma_to_pfn(dev, handle)),
 		handle & ~PAGE_MASK, size, dir);
 }
@@ -483,6 +519,7 @@ static inline void dma_sync_single_range_for_cpu(struct device *dev,
 	if (!dmabounce_sync_for_cpu(dev, handle, offset, size, dir))
 		return;
 
+	dma_cache_stat_dev_to_cpu(dev, size, dir);
 	__dma_single_dev_to_cpu(dma_to_virt(dev, handle) + offset, size, dir);
 }
 
@@ -497,6 +534,7 @@ static inline void dma_sync_single_range_for_device(struct device *dev,
 	if (!dmabounce_sync_for_device(dev, handle, offset, size, dir))
 		return;
 
+	dma_cache_stat_cpu_to_dev(dev, size, dir);
 	__dma_single_cpu_to_dev(dma_to_virt(dev, handle) + offset, size, dir);
 }
 
@@ -16,4 +16,9 @@ static inline int fb_is_primary_device(struct fb_info *info)
 	return 0;
 }
 
+#ifdef CONFIG_ARM_USER_LARGE_PAGES
+#define HAVE_ARCH_FB_UNMAPPED_AREA
+#define get_fb_unmapped_area	arm_large_get_unmapped_area
+#endif
+
 #endif /* _ASM_FB_H_ */
@@ -0,0 +1,41 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <linux/hardirq.h>
+#include <linux/percpu.h>
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON (and VFP) registers may be used by the kernel only between
+ * kernel_neon_begin() and kernel_neon_end().  The section runs with
+ * preemption disabled and must not sleep; it is not allowed in interrupt
+ * context, where callers have to fall back to integer code.
+ *
+ * The compiler must not be allowed to generate NEON code by itself, so
+ * NEON code lives in separate assembler files, or in C files built with
+ * -mfpu=neon that include no kernel headers (see lib/raid6/neon.uc).
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+DECLARE_PER_CPU(int, kernel_neon_busy);
+
+/*
+ * Sections don't nest, so code that may be reached from inside one
+ * (memcpy() for instance) must check this before kernel_neon_begin().
+ */
+static inline int may_use_neon(void)
+{
+	return !in_interrupt() && !this_cpu_read(kernel_neon_busy);
+}
+
+#endif /* __ASM_ARM_NEON_H */
@@ -148,7 +148,12 @@ extern void __cpu_copy_user_highpage(struct page *to, struct page *from,
 #define copy_user_highpage(to,from,vaddr,vma)	\
 	__cpu_copy_user_highpage(to, from, vaddr, vma)
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+extern void clear_page_neon(void *page);
+#define clear_page(page)	clear_page_neon((void *)(page))
+#else
 #define clear_page(page)	memset((void *)(page), 0, PAGE_SIZE)
+#endif
 extern void copy_page(void *to, const void *from);
 
 typedef unsigned long pteval_t;
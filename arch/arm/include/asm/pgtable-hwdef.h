@@ -78,6 +78,12 @@
 #define PTE_EXT_SHARED		(1 << 10)	/* v6 */
 #define PTE_EXT_NG		(1 << 11)	/* v6 */
 
+/*
+ *   - extended large page (bits 2-5 and 9-11 as for small pages)
+ */
+#define PTE_LARGE_TEX(x)	((x) << 12)	/* v6 */
+#define PTE_LARGE_XN		(1 << 15)	/* v6 */
+
 /*
  *   - small page
  */
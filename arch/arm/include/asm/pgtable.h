@@ -358,7 +358,30 @@ static inline pte_t *pmd_page_vaddr(pmd_t pmd)
 #define mk_pte(page,prot)	pfn_pte(page_to_pfn(page), prot)
 
 #define set_pte_ext(ptep,pte,ext) cpu_set_pte_ext(ptep,pte,ext)
-#define pte_clear(mm,addr,ptep)	set_pte_ext(ptep, __pte(0), 0)
+
+/*
+ * User mappings set up by io_remap_pfn_range() may use large pages in
+ * the hardware table; a pte in such a block must not be changed on its
+ * own, so the block goes back to small pages first.
+ */
+#ifdef CONFIG_ARM_USER_LARGE_PAGES
+extern void __pte_split_large(struct mm_struct *mm, pte_t *ptep);
+
+#define pte_split_large(mm,ptep)					\
+	do {								\
+		if ((pte_val((ptep)[PTE_HWTABLE_PTRS]) & PTE_TYPE_MASK) == \
+		    PTE_TYPE_LARGE)					\
+			__pte_split_large(mm, ptep);			\
+	} while (0)
+#else
+#define pte_split_large(mm,ptep)	do { } while (0)
+#endif
+
+#define pte_clear(mm,addr,ptep)				\
+	do {						\
+		pte_split_large(mm, ptep);		\
+		set_pte_ext(ptep, __pte(0), 0);		\
+	} while (0)
 
 #if __LINUX_ARM_ARCH__ < 6
 static inline void __sync_icache_dcache(pte_t pteval)
@@ -374,6 +397,7 @@ static inline void set_pte_at(struct mm_struct *mm, unsigned long addr,
 	if (addr >= TASK_SIZE)
 		set_pte_ext(ptep, pteval, 0);
 	else {
+		pte_split_large(mm, ptep);
 		__sync_icache_dcache(pteval);
 		set_pte_ext(ptep, pteval, PTE_EXT_NG);
 	}
@@ -469,8 +493,25 @@ static inline pte_t pte_modify(pte_t pte, pgprot_t newprot)
  * remap a physical page `pfn' of size `size' with page protection `prot'
  * into virtual address `from'
  */
+#ifdef CONFIG_ARM_USER_LARGE_PAGES
+struct vm_area_struct;
+extern int io_remap_pfn_range(struct vm_area_struct *vma, unsigned long from,
+			      unsigned long pfn, unsigned long size,
+			      pgprot_t prot);
+
+/*
+ * Drivers using io_remap_pfn_range() opt in to addresses that allow
+ * large pages by setting this as their get_unmapped_area method.
+ */
+struct file;
+extern unsigned long arm_large_get_unmapped_area(struct file *filp,
+	unsigned long addr, unsigned long len, unsigned long pgoff,
+	unsigned long flags);
+#else
 #define io_remap_pfn_range(vma,from,pfn,size,prot) \
 		remap_pfn_range(vma, from, pfn, size, prot)
+#define arm_large_get_unmapped_area NULL
+#endif
 
 #define pgtable_cache_init() do { } while (0)
 
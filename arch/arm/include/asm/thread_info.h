@@ -62,6 +62,12 @@ struct thread_info {
 	struct crunch_state	crunchstate;
 	union fp_state		fpstate __attribute__((aligned(8)));
 	union vfp_state		vfpstate;
+#ifdef CONFIG_VFP
+	unsigned long		vfp_traps;	/* VFP state restored on use */
+	unsigned long		vfp_eager;	/* VFP state restored at switch */
+	__u8			vfp_used;	/* VFP used in this timeslice */
+	__u8			vfp_slices;	/* in this many slices in a row */
+#endif
 #ifdef CONFIG_ARM_THUMBEE
 	unsigned long		thumbee_state;	/* ThumbEE Handler Base register */
 #endif
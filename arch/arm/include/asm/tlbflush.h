@@ -542,11 +542,27 @@ static inline void clean_pmd_entry(pmd_t *pmd)
 #undef always_tlb_flags
 #undef possible_tlb_flags
 
+/*
+ * The range flush goes one page at a time.  The purge of lazily unmapped
+ * vmalloc areas passes the span of all of them at once, which can cover
+ * most of the vmalloc space; flushing the whole TLB and refilling the few
+ * entries still needed is much cheaper than that.
+ */
+#define TLB_FLUSH_KERNEL_RANGE_MAX	512
+
+static inline void local_flush_tlb_kernel_range(unsigned long start,
+	unsigned long end)
+{
+	if ((end - start) >> PAGE_SHIFT > TLB_FLUSH_KERNEL_RANGE_MAX)
+		local_flush_tlb_all();
+	else
+		__cpu_flush_kern_tlb_range(start, end);
+}
+
 /*
  * Convert calls to our calling convention.
  */
 #define local_flush_tlb_range(vma,start,end)	__cpu_flush_user_tlb_range(start,end,vma)
-#define local_flush_tlb_kernel_range(s,e)	__cpu_flush_kern_tlb_range(s,e)
 
 #ifndef CONFIG_SMP
 #define flush_tlb_all		local_flush_tlb_all
@@ -49,6 +49,11 @@ extern void __aeabi_ulcmp(void);
 
 extern void fpundefinstr(void);
 
+extern void xor_neon_2(void);
+extern void xor_neon_3(void);
+extern void xor_neon_4(void);
+extern void xor_neon_5(void);
+
 
 EXPORT_SYMBOL(__backtrace);
 
@@ -62,6 +67,14 @@ EXPORT_SYMBOL(csum_partial_copy_from_user);
 EXPORT_SYMBOL(csum_partial_copy_nocheck);
 EXPORT_SYMBOL(__csum_ipv6_magic);
 
+#ifdef CONFIG_KERNEL_MODE_NEON
+	/* RAID-5 xor, for crypto/xor.c */
+EXPORT_SYMBOL(xor_neon_2);
+EXPORT_SYMBOL(xor_neon_3);
+EXPORT_SYMBOL(xor_neon_4);
+EXPORT_SYMBOL(xor_neon_5);
+#endif
+
 	/* io */
 #ifndef __raw_readsb
 EXPORT_SYMBOL(__raw_readsb);
@@ -97,6 +110,9 @@ EXPORT_SYMBOL(__strncpy_from_user);
 
 #ifdef CONFIG_MMU
 EXPORT_SYMBOL(copy_page);
+#ifdef CONFIG_KERNEL_MODE_NEON
+EXPORT_SYMBOL(clear_page_neon);
+#endif
 
 EXPORT_SYMBOL(__copy_from_user);
 EXPORT_SYMBOL(__copy_to_user);
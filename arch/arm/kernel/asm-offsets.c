@@ -59,6 +59,10 @@ int main(void)
   DEFINE(TI_TP_VALUE,		offsetof(struct thread_info, tp_value));
   DEFINE(TI_FPSTATE,		offsetof(struct thread_info, fpstate));
   DEFINE(TI_VFPSTATE,		offsetof(struct thread_info, vfpstate));
+#ifdef CONFIG_VFP
+  DEFINE(TI_VFP_TRAPS,		offsetof(struct thread_info, vfp_traps));
+  DEFINE(TI_VFP_USED,		offsetof(struct thread_info, vfp_used));
+#endif
 #ifdef CONFIG_ARM_THUMBEE
   DEFINE(TI_THUMBEE_STATE,	offsetof(struct thread_info, thumbee_state));
 #endif
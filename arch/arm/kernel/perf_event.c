@@ -740,6 +740,15 @@ perf_callchain_user(struct perf_callchain_entry *entry, struct pt_regs *regs)
 {
 	struct frame_tail __user *tail;
 
+	perf_callchain_store(entry, regs->ARM_pc);
+
+	/*
+	 * Only ARM code built with APCS frames keeps a frame_tail under
+	 * r11; Thumb-2 code uses r7 for its frame pointer, if at all, and
+	 * r11 is just another register there.
+	 */
+	if (thumb_mode(regs))
+		return;
 
 	tail = (struct frame_tail __user *)regs->ARM_fp - 1;
 
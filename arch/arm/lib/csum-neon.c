@@ -0,0 +1,88 @@
+/*
+ *  linux/arch/arm/lib/csum-neon.c
+ *
+ *  Use NEON for the bulk of long csum_partial() calls
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * csum_partial() in csumpartial.S branches here for buffers of 256 bytes
+ * or more.  NEON can't be used in interrupt context, which includes the
+ * softirq receive path, so it only helps callers in process context such
+ * as UDP/TCP receive checksumming done from recvmsg().  Whether it is
+ * used at all is decided by timing both versions once at boot.
+ */
+#include <linux/gfp.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+
+__wsum csum_partial_arm(const void *buff, int len, __wsum sum);
+u32 csum_partial_neon_bulk(const void *buff, int len);
+__wsum csum_partial_neon(const void *buff, int len, __wsum sum);
+
+static int csum_use_neon __read_mostly;
+
+__wsum csum_partial_neon(const void *buff, int len, __wsum sum)
+{
+	int bulk = len & ~63;
+
+	if (!csum_use_neon || !may_use_neon())
+		return csum_partial_arm(buff, len, sum);
+
+	kernel_neon_begin();
+	sum = csum_add(sum, (__force __wsum)csum_partial_neon_bulk(buff, bulk));
+	kernel_neon_end();
+
+	return csum_partial_arm(buff + bulk, len - bulk, sum);
+}
+
+#define CSUM_BENCH_LOOPS	64
+
+static s64 __init csum_bench(void *buf, int neon)
+{
+	ktime_t start;
+	__wsum sum = 0;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < CSUM_BENCH_LOOPS; i++) {
+		if (neon) {
+			kernel_neon_begin();
+			sum = csum_add(sum, (__force __wsum)
+				       csum_partial_neon_bulk(buf, PAGE_SIZE));
+			kernel_neon_end();
+		} else {
+			sum = csum_partial_arm(buf, PAGE_SIZE, sum);
+		}
+	}
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int __init csum_neon_init(void)
+{
+	void *buf;
+	s64 arm, neon;
+
+	if (!cpu_has_neon())
+		return 0;
+
+	buf = (void *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* first pass warms up the caches */
+	csum_bench(buf, 0);
+	arm = csum_bench(buf, 0);
+	neon = csum_bench(buf, 1);
+	free_page((unsigned long)buf);
+
+	csum_use_neon = neon < arm;
+	printk(KERN_INFO "csum_partial: arm %lld ns, neon %lld ns, using %s\n",
+	       arm, neon, csum_use_neon ? "neon" : "arm");
+	return 0;
+}
+late_initcall(csum_neon_init);
@@ -0,0 +1,205 @@
+/*
+ *  linux/arch/arm/lib/memcpy-neon.c
+ *
+ *  Use NEON for long memcpy() calls and for copy_page()/clear_page()
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * memcpy() in memcpy.S branches here for copies of 256 bytes or more and
+ * copy_page() always does.  Copies from interrupt context or from inside
+ * another kernel mode NEON section stay with the LDM/STM code, and so does
+ * everything until the boot time benchmark below has picked the sizes for
+ * which NEON is faster on this core.  The user copies get here through
+ * memcpy() when CONFIG_UACCESS_WITH_MEMCPY is set.
+ */
+#include <linux/gfp.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/cputype.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+void *memcpy_arm(void *dest, const void *src, size_t n);
+void copy_page_arm(void *to, const void *from);
+void memcpy_neon_bulk(void *dest, const void *src, size_t n, unsigned int pld);
+void memzero_neon_bulk(void *dest, size_t n);
+void *memcpy_neon(void *dest, const void *src, size_t n);
+void copy_page_neon(void *to, const void *from);
+
+/*
+ * Bytes per kernel_neon_begin()/kernel_neon_end() pair, which bounds the
+ * time a long copy runs with preemption disabled.
+ */
+#define MEMCPY_NEON_CHUNK	16384
+
+/* memcpy() calls shorter than this don't use NEON; ~0 turns it off */
+static size_t memcpy_neon_min __read_mostly = ~0;
+static int copy_page_use_neon __read_mostly;
+static int clear_page_use_neon __read_mostly;
+static unsigned int memcpy_neon_pld __read_mostly;
+
+void *memcpy_neon(void *dest, const void *src, size_t n)
+{
+	void *d = dest;
+	size_t head, chunk;
+
+	if (n < memcpy_neon_min || !may_use_neon())
+		return memcpy_arm(dest, src, n);
+
+	/* align the destination for the NEON stores */
+	head = -(unsigned long)d & 15;
+	memcpy_arm(d, src, head);
+	d += head;
+	src += head;
+	n -= head;
+
+	while (n >= 64) {
+		chunk = min_t(size_t, n & ~63, MEMCPY_NEON_CHUNK);
+		kernel_neon_begin();
+		memcpy_neon_bulk(d, src, chunk, memcpy_neon_pld);
+		kernel_neon_end();
+		d += chunk;
+		src += chunk;
+		n -= chunk;
+	}
+
+	memcpy_arm(d, src, n);
+	return dest;
+}
+
+#ifdef CONFIG_MMU
+void copy_page_neon(void *to, const void *from)
+{
+	if (!copy_page_use_neon || !may_use_neon()) {
+		copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	memcpy_neon_bulk(to, from, PAGE_SIZE, memcpy_neon_pld);
+	kernel_neon_end();
+}
+
+void clear_page_neon(void *page)
+{
+	if (!clear_page_use_neon || !may_use_neon()) {
+		memset(page, 0, PAGE_SIZE);
+		return;
+	}
+
+	kernel_neon_begin();
+	memzero_neon_bulk(page, PAGE_SIZE);
+	kernel_neon_end();
+}
+#endif
+
+/*
+ * How far ahead of the loads to preload.  The Cortex-A8 has a long L2
+ * and memory latency and no automatic prefetch into L1; on the A9 the
+ * L1 prefetcher and the PL310 already cover part of it.
+ */
+static unsigned int __init memcpy_neon_pld_distance(void)
+{
+	switch (read_cpuid_id() & 0xff00fff0) {
+	case 0x4100c080:		/* Cortex-A8 */
+		return 320;
+	case 0x4100c090:		/* Cortex-A9 */
+		return 192;
+	default:
+		return 256;
+	}
+}
+
+#define MEMCPY_BENCH_ORDER	2
+#define MEMCPY_BENCH_BYTES	(256 * 1024)
+
+enum { BENCH_ARM, BENCH_NEON, BENCH_MEMSET, BENCH_MEMZERO_NEON };
+
+static s64 __init memcpy_bench(void *dst, const void *src, size_t len,
+			       int how)
+{
+	ktime_t start;
+	int i, loops = MEMCPY_BENCH_BYTES / len;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		switch (how) {
+		case BENCH_ARM:
+			memcpy_arm(dst, src, len);
+			break;
+		case BENCH_NEON:
+			kernel_neon_begin();
+			memcpy_neon_bulk(dst, src, len, memcpy_neon_pld);
+			kernel_neon_end();
+			break;
+		case BENCH_MEMSET:
+			memset(dst, 0, len);
+			break;
+		case BENCH_MEMZERO_NEON:
+			kernel_neon_begin();
+			memzero_neon_bulk(dst, len);
+			kernel_neon_end();
+			break;
+		}
+	}
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int __init memcpy_neon_init(void)
+{
+	static const size_t sizes[] __initconst = {
+		16384, 4096, 1024, 512, 256,
+	};
+	void *src, *dst;
+	s64 arm, neon;
+	size_t min = ~0;
+	int i;
+
+	if (!cpu_has_neon())
+		return 0;
+
+	src = (void *)__get_free_pages(GFP_KERNEL, MEMCPY_BENCH_ORDER);
+	dst = (void *)__get_free_pages(GFP_KERNEL, MEMCPY_BENCH_ORDER);
+	if (!src || !dst)
+		goto out;
+	memcpy_neon_pld = memcpy_neon_pld_distance();
+
+	/*
+	 * Use NEON for memcpy() down to the smallest size at which it still
+	 * wins; the first pass warms up the caches.
+	 */
+	memcpy_bench(dst, src, sizes[0], BENCH_ARM);
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		arm = memcpy_bench(dst, src, sizes[i], BENCH_ARM);
+		neon = memcpy_bench(dst, src, sizes[i], BENCH_NEON);
+		pr_debug("memcpy: %5zu bytes: arm %lld ns, neon %lld ns\n",
+			 sizes[i], arm, neon);
+		if (neon >= arm)
+			break;
+		min = sizes[i];
+	}
+
+	arm = memcpy_bench(dst, src, PAGE_SIZE, BENCH_MEMSET);
+	neon = memcpy_bench(dst, src, PAGE_SIZE, BENCH_MEMZERO_NEON);
+	clear_page_use_neon = neon < arm;
+
+	copy_page_use_neon = min <= PAGE_SIZE;
+	memcpy_neon_min = min;
+
+	if (min != ~0)
+		printk(KERN_INFO "memcpy: neon from %zu bytes, preload %u "
+		       "bytes ahead; clear_page: %s\n", min, memcpy_neon_pld,
+		       clear_page_use_neon ? "neon" : "arm");
+	else
+		printk(KERN_INFO "memcpy: arm; clear_page: %s\n",
+		       clear_page_use_neon ? "neon" : "arm");
+out:
+	free_pages((unsigned long)src, MEMCPY_BENCH_ORDER);
+	free_pages((unsigned long)dst, MEMCPY_BENCH_ORDER);
+	return 0;
+}
+late_initcall(memcpy_neon_init);
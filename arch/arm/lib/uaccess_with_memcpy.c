@@ -55,6 +55,41 @@ pin_page_for_write(const void __user *_addr, pte_t **ptep, spinlock_t **ptlp)
 	return 1;
 }
 
+static int
+pin_page_for_read(const void __user *_addr, pte_t **ptep, spinlock_t **ptlp)
+{
+	unsigned long addr = (unsigned long)_addr;
+	pgd_t *pgd;
+	pmd_t *pmd;
+	pte_t *pte;
+	pud_t *pud;
+	spinlock_t *ptl;
+
+	pgd = pgd_offset(current->mm, addr);
+	if (unlikely(pgd_none(*pgd) || pgd_bad(*pgd)))
+		return 0;
+
+	pud = pud_offset(pgd, addr);
+	if (unlikely(pud_none(*pud) || pud_bad(*pud)))
+		return 0;
+
+	pmd = pmd_offset(pud, addr);
+	if (unlikely(pmd_none(*pmd) || pmd_bad(*pmd)))
+		return 0;
+
+	/* an old pte has no hardware mapping, see pgtable.h */
+	pte = pte_offset_map_lock(current->mm, pmd, addr, &ptl);
+	if (unlikely(!pte_present_user(*pte) || !pte_young(*pte))) {
+		pte_unmap_unlock(pte, ptl);
+		return 0;
+	}
+
+	*ptep = pte;
+	*ptlp = ptl;
+
+	return 1;
+}
+
 static unsigned long noinline
 __copy_to_user_memcpy(void __user *to, const void *from, unsigned long n)
 {
@@ -117,6 +152,71 @@ __copy_to_user(void __user *to, const void *from, unsigned long n)
 	return __copy_to_user_memcpy(to, from, n);
 }
 	
+static unsigned long noinline
+__copy_from_user_memcpy(void *to, const void __user *from, unsigned long n)
+{
+	int atomic;
+
+	if (unlikely(segment_eq(get_fs(), KERNEL_DS))) {
+		memcpy(to, (const void *)from, n);
+		return 0;
+	}
+
+	/* the mmap semaphore is taken only if not in an atomic context */
+	atomic = in_atomic();
+
+	if (!atomic)
+		down_read(&current->mm->mmap_sem);
+	while (n) {
+		pte_t *pte;
+		spinlock_t *ptl;
+		int tocopy;
+		char c;
+
+		while (!pin_page_for_read(from, &pte, &ptl)) {
+			if (!atomic)
+				up_read(&current->mm->mmap_sem);
+			if (__get_user(c, (const char __user *)from))
+				goto out;
+			if (!atomic)
+				down_read(&current->mm->mmap_sem);
+		}
+
+		tocopy = (~(unsigned long)from & ~PAGE_MASK) + 1;
+		if (tocopy > n)
+			tocopy = n;
+
+		memcpy(to, (const void *)from, tocopy);
+		to += tocopy;
+		from += tocopy;
+		n -= tocopy;
+
+		pte_unmap_unlock(pte, ptl);
+	}
+	if (!atomic)
+		up_read(&current->mm->mmap_sem);
+
+out:
+	/* like __copy_from_user_std(), zero what could not be copied */
+	if (n)
+		memset(to, 0, n);
+	return n;
+}
+
+unsigned long
+__copy_from_user(void *to, const void __user *from, unsigned long n)
+{
+	/*
+	 * See rational for this in __copy_to_user() above.  Callers such as
+	 * fault handlers may already hold mmap_sem, and taking it again
+	 * deadlocks against a queued writer, so leave those and kernel
+	 * threads to the assembly version, which needs no lock.
+	 */
+	if (n < 64 || !current->mm || rwsem_is_locked(&current->mm->mmap_sem))
+		return __copy_from_user_std(to, from, n);
+	return __copy_from_user_memcpy(to, from, n);
+}
+
 static unsigned long noinline
 __clear_user_memset(void __user *addr, unsigned long n)
 {
@@ -18,6 +18,10 @@
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/rculist.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 
 #include <asm/memory.h>
 #include <asm/highmem.h>
@@ -625,6 +629,7 @@ void dma_sync_sg_for_cpu(struct device *dev, struct scatterlist *sg,
 					    sg_dma_len(s), dir))
 			continue;
 
+		dma_cache_stat_dev_to_cpu(dev, s->length, dir);
 		__dma_page_dev_to_cpu(sg_page(s), s->offset,
 				      s->length, dir);
 	}
@@ -651,6 +656,7 @@ void dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 					sg_dma_len(s), dir))
 			continue;
 
+		dma_cache_stat_cpu_to_dev(dev, s->length, dir);
 		__dma_page_cpu_to_dev(sg_page(s), s->offset,
 				      s->length, dir);
 	}
@@ -659,6 +665,105 @@ void dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 }
 EXPORT_SYMBOL(dma_sync_sg_for_device);
 
+#ifdef CONFIG_DMA_CACHE_STATS
+/*
+ * Bytes cleaned and invalidated for streaming DMA per device.  Entries
+ * are keyed by device name and never freed, so a device that goes away and
+ * comes back keeps its counts; struct device only caches the pointer.
+ */
+struct dma_cache_stats {
+	struct list_head	node;
+	atomic64_t		ops;
+	atomic64_t		cleaned;
+	atomic64_t		invalidated;
+	char			name[0];
+};
+
+static LIST_HEAD(dma_cache_stats_list);
+static DEFINE_SPINLOCK(dma_cache_stats_lock);
+
+static struct dma_cache_stats *dma_cache_stats_get(struct device *dev)
+{
+	const char *name = dev ? dev_name(dev) : "(none)";
+	struct dma_cache_stats *st;
+	unsigned long flags;
+
+	if (dev && likely(dev->archdata.dma_stats))
+		return dev->archdata.dma_stats;
+
+	spin_lock_irqsave(&dma_cache_stats_lock, flags);
+	list_for_each_entry(st, &dma_cache_stats_list, node)
+		if (!strcmp(st->name, name))
+			goto found;
+
+	st = kzalloc(sizeof(*st) + strlen(name) + 1, GFP_ATOMIC);
+	if (!st)
+		goto out;
+	strcpy(st->name, name);
+	list_add_tail_rcu(&st->node, &dma_cache_stats_list);
+found:
+	if (dev)
+		dev->archdata.dma_stats = st;
+out:
+	spin_unlock_irqrestore(&dma_cache_stats_lock, flags);
+	return st;
+}
+
+void dma_cache_stats_add(struct device *dev, size_t cleaned,
+	size_t invalidated)
+{
+	struct dma_cache_stats *st = dma_cache_stats_get(dev);
+
+	if (!st)
+		return;
+
+	atomic64_inc(&st->ops);
+	if (cleaned)
+		atomic64_add(cleaned, &st->cleaned);
+	if (invalidated)
+		atomic64_add(invalidated, &st->invalidated);
+}
+EXPORT_SYMBOL(dma_cache_stats_add);
+
+static int dma_cache_stats_show(struct seq_file *m, void *v)
+{
+	struct dma_cache_stats *st;
+
+	seq_printf(m, "%-24s %12s %16s %16s\n", "device", "ops",
+		   "cleaned", "invalidated");
+
+	/* entries are only ever added */
+	rcu_read_lock();
+	list_for_each_entry_rcu(st, &dma_cache_stats_list, node)
+		seq_printf(m, "%-24s %12lld %16lld %16lld\n", st->name,
+			   (long long)atomic64_read(&st->ops),
+			   (long long)atomic64_read(&st->cleaned),
+			   (long long)atomic64_read(&st->invalidated));
+	rcu_read_unlock();
+	return 0;
+}
+
+static int dma_cache_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dma_cache_stats_show, NULL);
+}
+
+static const struct file_operations dma_cache_stats_fops = {
+	.open		= dma_cache_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dma_cache_stats_init(void)
+{
+	debugfs_create_file("dma_cache_stats", S_IRUGO, NULL, NULL,
+			    &dma_cache_stats_fops);
+	return 0;
+}
+late_initcall(dma_cache_stats_init);
+#endif /* CONFIG_DMA_CACHE_STATS */
+
 #define PREALLOC_DMA_DEBUG_ENTRIES	4096
 
 static int __init dma_debug_do_init(void)
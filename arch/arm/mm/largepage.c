@@ -0,0 +1,152 @@
+/*
+ *  linux/arch/arm/mm/largepage.c
+ *
+ *  64K large pages for user mappings of physically contiguous memory
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * io_remap_pfn_range() maps memory the way remap_pfn_range() does, and
+ * then rewrites each naturally aligned 64K block of the range that is
+ * backed by 64K aligned contiguous memory as a large page, so that it
+ * takes one TLB entry instead of sixteen.  The Linux ptes still describe
+ * 4K pages, and anything that modifies one of them through set_pte_at()
+ * or pte_clear() first splits its block back into small pages.
+ *
+ * That includes the young and dirty updates of the fault path: a clean
+ * pte is read-only in the hardware table, so the first write to each
+ * page would fault and split the block.  The ptes of shared writable
+ * mappings are therefore made young and dirty before their block is
+ * promoted; nothing looks at the dirty bit of a PFN mapping.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+
+#include <asm/cacheflush.h>
+#include <asm/pgtable.h>
+#include <asm/tlbflush.h>
+
+#define LARGE_PAGE_SIZE		(1UL << 16)
+#define LARGE_PAGE_MASK		(~(LARGE_PAGE_SIZE - 1))
+#define LARGE_PAGE_PTES		(LARGE_PAGE_SIZE >> PAGE_SHIFT)
+
+/* bits at the same place in small and large page descriptors */
+#define PTE_SMALL_LARGE_SAME	(PTE_BUFFERABLE | PTE_CACHEABLE | \
+				 PTE_EXT_AP_MASK | PTE_EXT_APX | \
+				 PTE_EXT_SHARED | PTE_EXT_NG)
+
+static int user_large_pages __read_mostly = 1;
+
+static int __init early_nolargepages(char *__unused)
+{
+	user_large_pages = 0;
+	return 0;
+}
+early_param("nolargepages", early_nolargepages);
+
+/*
+ * Called with the page table lock held for the ptes of a block whose
+ * hardware entries are large page descriptors.  The entries are
+ * cleared and the TLB flushed before the small pages go in, so that
+ * the TLB never holds both sizes for the same address.
+ */
+void __pte_split_large(struct mm_struct *mm, pte_t *ptep)
+{
+	pte_t *pte = (pte_t *)((unsigned long)ptep &
+			       ~(LARGE_PAGE_PTES * sizeof(pte_t) - 1));
+	u32 *hw = (u32 *)(pte + PTE_HWTABLE_PTRS);
+	u32 ext = hw[0] & PTE_EXT_NG;
+	int i;
+
+	memset(hw, 0, LARGE_PAGE_PTES * sizeof(u32));
+	clean_dcache_area(hw, LARGE_PAGE_PTES * sizeof(u32));
+	flush_tlb_mm(mm);
+
+	for (i = 0; i < LARGE_PAGE_PTES; i++)
+		set_pte_ext(pte + i, pte[i], ext);
+}
+
+/*
+ * Turn the small page entries of one aligned block into large page
+ * entries, if they map contiguous memory starting at a 64K boundary
+ * with the same attributes.
+ */
+static int pte_make_large(struct vm_area_struct *vma, unsigned long addr,
+			  pte_t *pte)
+{
+	u32 *hw = (u32 *)(pte + PTE_HWTABLE_PTRS);
+	u32 small = hw[0], large;
+	int i;
+
+	if (!(small & PTE_TYPE_SMALL) || (small & ~LARGE_PAGE_MASK & PAGE_MASK))
+		return 0;
+	for (i = 1; i < LARGE_PAGE_PTES; i++)
+		if (hw[i] != small + (i << PAGE_SHIFT))
+			return 0;
+
+	if ((vma->vm_flags & (VM_SHARED | VM_WRITE)) ==
+	    (VM_SHARED | VM_WRITE)) {
+		for (i = 0; i < LARGE_PAGE_PTES; i++)
+			set_pte_ext(pte + i, pte_mkyoung(pte_mkdirty(pte[i])),
+				    PTE_EXT_NG);
+		small = hw[0];
+	}
+
+	large = (small & LARGE_PAGE_MASK) | (small & PTE_SMALL_LARGE_SAME) |
+		PTE_LARGE_TEX((small & PTE_EXT_TEX(7)) >> 6) |
+		(small & PTE_EXT_XN ? PTE_LARGE_XN : 0) | PTE_TYPE_LARGE;
+
+	memset(hw, 0, LARGE_PAGE_PTES * sizeof(u32));
+	clean_dcache_area(hw, LARGE_PAGE_PTES * sizeof(u32));
+	flush_tlb_range(vma, addr, addr + LARGE_PAGE_SIZE);
+
+	for (i = 0; i < LARGE_PAGE_PTES; i++)
+		hw[i] = large;
+	clean_dcache_area(hw, LARGE_PAGE_PTES * sizeof(u32));
+	return 1;
+}
+
+static void remap_large_pages(struct vm_area_struct *vma, unsigned long addr,
+			      unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	spinlock_t *ptl;
+	pgd_t *pgd;
+	pmd_t *pmd;
+	pte_t *pte;
+
+	addr = (addr + LARGE_PAGE_SIZE - 1) & LARGE_PAGE_MASK;
+	end &= LARGE_PAGE_MASK;
+
+	for (; addr < end; addr += LARGE_PAGE_SIZE) {
+		pgd = pgd_offset(mm, addr);
+		pmd = pmd_offset(pgd, addr);
+		if (pmd_none(*pmd) || pmd_bad(*pmd))
+			continue;
+
+		pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+		pte_make_large(vma, addr, pte);
+		pte_unmap_unlock(pte, ptl);
+	}
+}
+
+/**
+ * io_remap_pfn_range - map contiguous memory or I/O into user space
+ *
+ * As remap_pfn_range(), but using 64K pages where the alignment of
+ * both the virtual and the physical addresses allows it.
+ */
+int io_remap_pfn_range(struct vm_area_struct *vma, unsigned long addr,
+		       unsigned long pfn, unsigned long size, pgprot_t prot)
+{
+	int ret;
+
+	ret = remap_pfn_range(vma, addr, pfn, size, prot);
+	if (!ret && user_large_pages)
+		remap_large_pages(vma, addr, addr + PAGE_ALIGN(size));
+	return ret;
+}
+EXPORT_SYMBOL(io_remap_pfn_range);
@@ -4,18 +4,24 @@
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/mman.h>
+#include <linux/module.h>
 #include <linux/shm.h>
 #include <linux/sched.h>
 #include <linux/io.h>
 #include <linux/personality.h>
 #include <linux/random.h>
 #include <asm/cputype.h>
+#include <asm/sizes.h>
 #include <asm/system.h>
 
 #define COLOUR_ALIGN(addr,pgoff)		\
 	((((addr)+SHMLBA-1)&~(SHMLBA-1)) +	\
 	 (((pgoff)<<PAGE_SHIFT) & (SHMLBA-1)))
 
+#define LARGE_ALIGN(addr,pgoff)			\
+	((((addr)+SZ_64K-1)&~(SZ_64K-1)) +	\
+	 (((pgoff)<<PAGE_SHIFT) & (SZ_64K-1)))
+
 /*
  * We need to ensure that shared mappings are correctly aligned to
  * avoid aliasing issues with VIPT caches.  We need to ensure that
@@ -24,10 +30,14 @@
  *
  * We unconditionally provide this function for all cases, however
  * in the VIVT case, we optimise out the alignment rules.
+ *
+ * With large_align, the address is instead congruent to the offset
+ * modulo 64K, which also satisfies the colour alignment.
  */
-unsigned long
-arch_get_unmapped_area(struct file *filp, unsigned long addr,
-		unsigned long len, unsigned long pgoff, unsigned long flags)
+static unsigned long
+__arch_get_unmapped_area(struct file *filp, unsigned long addr,
+		unsigned long len, unsigned long pgoff, unsigned long flags,
+		int large_align)
 {
 	struct mm_struct *mm = current->mm;
 	struct vm_area_struct *vma;
@@ -66,7 +76,9 @@ arch_get_unmapped_area(struct file *filp, unsigned long addr,
 		return -ENOMEM;
 
 	if (addr) {
-		if (do_align)
+		if (large_align)
+			addr = LARGE_ALIGN(addr, pgoff);
+		else if (do_align)
 			addr = COLOUR_ALIGN(addr, pgoff);
 		else
 			addr = PAGE_ALIGN(addr);
@@ -88,7 +100,9 @@ arch_get_unmapped_area(struct file *filp, unsigned long addr,
 		addr += (get_random_int() % (1 << 8)) << PAGE_SHIFT;
 
 full_search:
-	if (do_align)
+	if (large_align)
+		addr = LARGE_ALIGN(addr, pgoff);
+	else if (do_align)
 		addr = COLOUR_ALIGN(addr, pgoff);
 	else
 		addr = PAGE_ALIGN(addr);
@@ -117,11 +131,36 @@ full_search:
 		if (addr + mm->cached_hole_size < vma->vm_start)
 		        mm->cached_hole_size = vma->vm_start - addr;
 		addr = vma->vm_end;
-		if (do_align)
+		if (large_align)
+			addr = LARGE_ALIGN(addr, pgoff);
+		else if (do_align)
 			addr = COLOUR_ALIGN(addr, pgoff);
 	}
 }
 
+unsigned long
+arch_get_unmapped_area(struct file *filp, unsigned long addr,
+		unsigned long len, unsigned long pgoff, unsigned long flags)
+{
+	return __arch_get_unmapped_area(filp, addr, len, pgoff, flags, 0);
+}
+
+#ifdef CONFIG_ARM_USER_LARGE_PAGES
+/*
+ * get_unmapped_area method for drivers whose mmap() hands 64K aligned
+ * contiguous memory to io_remap_pfn_range(): mappings of 64K or more
+ * are placed so that it can use large pages for them.
+ */
+unsigned long
+arm_large_get_unmapped_area(struct file *filp, unsigned long addr,
+		unsigned long len, unsigned long pgoff, unsigned long flags)
+{
+	return __arch_get_unmapped_area(filp, addr, len, pgoff, flags,
+					len >= SZ_64K);
+}
+EXPORT_SYMBOL(arm_large_get_unmapped_area);
+#endif
+
 
 /*
  * You really shouldn't be using read() or write() on /dev/mem.  This
@@ -0,0 +1,855 @@
+/*
+ * Just-In-Time compiler for BPF filters on 32bit ARM
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; version 2 of the License.
+ */
+
+#include <linux/bitops.h>
+#include <linux/compiler.h>
+#include <linux/errno.h>
+#include <linux/filter.h>
+#include <linux/log2.h>
+#include <linux/moduleloader.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <asm/cacheflush.h>
+#include <asm/thread_info.h>
+
+#include "bpf_jit_32.h"
+
+/*
+ * ABI:
+ *
+ * r0	scratch register, skb on entry, return value on exit
+ * r1	scratch register, offset of the packet load in progress
+ * r2	scratch register
+ * r3	scratch register, address of the helper being called
+ * r4	BPF register A
+ * r5	BPF register X
+ * r6	pointer to the skb
+ * r7	skb->data
+ * r8	skb headlen (skb->len - skb->data_len)
+ *
+ * The code is always ARM (not Thumb) and only clobbers r0-r3 and
+ * registers it saves itself, so it can be called like any other C
+ * function from both ARM and Thumb-2 kernels.  mem[] lives on the stack.
+ */
+
+#define r_scratch	ARM_R0
+#define r_off		ARM_R1
+#define r_tmp		ARM_R2
+#define r_addr		ARM_R3
+#define r_A		ARM_R4
+#define r_X		ARM_R5
+#define r_skb		ARM_R6
+#define r_skb_data	ARM_R7
+#define r_skb_hl	ARM_R8
+
+#define SEEN_A		(1 << 0)	/* A is used */
+#define SEEN_X		(1 << 1)	/* X is used */
+#define SEEN_SKB	(1 << 2)	/* the skb pointer is used */
+#define SEEN_DATA	(1 << 3)	/* skb->data and headlen are used */
+#define SEEN_CALL	(1 << 4)	/* a C helper is called */
+#define SEEN_MEM	(1 << 5)	/* mem[] is used */
+
+struct jit_ctx {
+	const struct sk_filter *skf;
+	unsigned idx;
+	u32 seen;
+	/* word index of each BPF instruction, the last entry is the epilogue */
+	u32 *offsets;
+	u32 *target;
+};
+
+int bpf_jit_enable __read_mostly;
+
+/*
+ * Slow path of the packet loads, for offsets outside the linear data,
+ * including the negative SKF_NET_OFF/SKF_LL_OFF ones.  The value is
+ * returned in r0 and an error, which makes the filter return 0, in r1.
+ */
+static int jit_load(struct sk_buff *skb, int offset, void *to, int len)
+{
+	void *ptr;
+
+	if (offset >= 0)
+		return skb_copy_bits(skb, offset, to, len);
+
+	ptr = bpf_internal_load_pointer_neg_helper(skb, offset, len);
+	if (!ptr)
+		return -EFAULT;
+	memcpy(to, ptr, len);
+	return 0;
+}
+
+static u64 jit_get_skb_b(struct sk_buff *skb, int offset)
+{
+	u8 ret = 0;
+	int err;
+
+	err = jit_load(skb, offset, &ret, 1);
+	return (u64)err << 32 | ret;
+}
+
+static u64 jit_get_skb_h(struct sk_buff *skb, int offset)
+{
+	__be16 ret = 0;
+	int err;
+
+	err = jit_load(skb, offset, &ret, 2);
+	return (u64)err << 32 | ntohs(ret);
+}
+
+static u64 jit_get_skb_w(struct sk_buff *skb, int offset)
+{
+	__be32 ret = 0;
+	int err;
+
+	err = jit_load(skb, offset, &ret, 4);
+	return (u64)err << 32 | ntohl(ret);
+}
+
+/* no hardware divide instruction before the Cortex-A15 */
+static u32 jit_udiv(u32 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline void _emit(int cond, u32 inst, struct jit_ctx *ctx)
+{
+	if (ctx->target != NULL)
+		ctx->target[ctx->idx] = inst | (cond << 28);
+
+	ctx->idx++;
+}
+
+/*
+ * Emit an instruction that will be executed unconditionally.
+ */
+static inline void emit(u32 inst, struct jit_ctx *ctx)
+{
+	_emit(ARM_COND_AL, inst, ctx);
+}
+
+/*
+ * Encode x as an ARM "modified immediate": an 8 bit value rotated right
+ * by an even amount.  Returns -1 if that is not possible.
+ */
+static int imm8m(u32 x)
+{
+	u32 rot;
+
+	for (rot = 0; rot < 16; rot++)
+		if ((x & ~ror32(0xff, 2 * rot)) == 0)
+			return rol32(x, 2 * rot) | (rot << 8);
+
+	return -1;
+}
+
+/* branch offset, in words, from the current instruction to BPF insn bpf_to */
+static inline int b_imm(unsigned bpf_to, struct jit_ctx *ctx)
+{
+	if (ctx->target == NULL)
+		return 0;
+
+	return ctx->offsets[bpf_to] - (ctx->idx + 2);
+}
+
+static void emit_mov_i_no8m(int rd, u32 val, struct jit_ctx *ctx)
+{
+#if __LINUX_ARM_ARCH__ < 7
+	/* load it from behind a branch over the constant */
+	emit(ARM_LDR_I(rd, ARM_PC, 0), ctx);
+	emit(ARM_B(0), ctx);
+	if (ctx->target != NULL)
+		ctx->target[ctx->idx] = val;
+	ctx->idx++;
+#else
+	emit(ARM_MOVW(rd, val & 0xffff), ctx);
+	if (val > 0xffff)
+		emit(ARM_MOVT(rd, val >> 16), ctx);
+#endif
+}
+
+static void emit_mov_i(int rd, u32 val, struct jit_ctx *ctx)
+{
+	int imm12 = imm8m(val);
+
+	if (imm12 >= 0) {
+		emit(ARM_MOV_I(rd, imm12), ctx);
+		return;
+	}
+
+	imm12 = imm8m(~val);
+	if (imm12 >= 0)
+		emit(ARM_MVN_I(rd, imm12), ctx);
+	else
+		emit_mov_i_no8m(rd, val, ctx);
+}
+
+/* rd = rn op imm_val, going through r_scratch for awkward constants */
+#define OP_IMM3(op, rd, rn, imm_val, ctx)				\
+	do {								\
+		int imm12 = imm8m(imm_val);				\
+		if (imm12 < 0) {					\
+			emit_mov_i_no8m(r_scratch, imm_val, ctx);	\
+			emit(op ## _R((rd), (rn), r_scratch), ctx);	\
+		} else {						\
+			emit(op ## _I((rd), (rn), imm12), ctx);		\
+		}							\
+	} while (0)
+
+static void emit_blx_r(u8 tgt_reg, struct jit_ctx *ctx)
+{
+#if __LINUX_ARM_ARCH__ < 5
+	emit(ARM_MOV_R(ARM_LR, ARM_PC), ctx);
+	emit(ARM_MOV_R(ARM_PC, tgt_reg), ctx);
+#else
+	emit(ARM_BLX_R(tgt_reg), ctx);
+#endif
+}
+
+/* return 0 from the filter if cond holds */
+static void emit_err_ret(u8 cond, struct jit_ctx *ctx)
+{
+	_emit(cond, ARM_MOV_I(ARM_R0, 0), ctx);
+	_emit(cond, ARM_B(b_imm(ctx->skf->len, ctx)), ctx);
+}
+
+/* rd = *(size bytes at rn + off), zero extended */
+static void emit_ldr_field(unsigned size, u8 rd, u8 rn, u32 off,
+			   struct jit_ctx *ctx)
+{
+	if (off < (size == 2 ? 256 : 4096)) {
+		switch (size) {
+		case 1:
+			emit(ARM_LDRB_I(rd, rn, off), ctx);
+			break;
+		case 2:
+			emit(ARM_LDRH_I(rd, rn, off), ctx);
+			break;
+		default:
+			emit(ARM_LDR_I(rd, rn, off), ctx);
+			break;
+		}
+		return;
+	}
+
+	emit_mov_i(r_tmp, off, ctx);
+	switch (size) {
+	case 1:
+		emit(ARM_LDRB_R(rd, rn, r_tmp), ctx);
+		break;
+	case 2:
+		emit(ARM_LDRH_R(rd, rn, r_tmp), ctx);
+		break;
+	default:
+		emit(ARM_LDR_R(rd, rn, r_tmp), ctx);
+		break;
+	}
+}
+
+#define EMIT_LDR_FIELD(rd, rn, type, field, ctx)			\
+	emit_ldr_field(FIELD_SIZEOF(type, field), rd, rn,		\
+		       offsetof(type, field), ctx)
+
+/* swap the bytes of the zero extended 16 bit value in rd */
+static void emit_swap16(u8 rd, struct jit_ctx *ctx)
+{
+#if __LINUX_ARM_ARCH__ < 6
+	emit(ARM_AND_I(r_tmp, rd, 0xff), ctx);
+	emit(ARM_LSR_I(rd, rd, 8), ctx);
+	emit(ARM_ORR_S(rd, rd, r_tmp, SRTYPE_LSL, 8), ctx);
+#else
+	emit(ARM_REV16(rd, rd), ctx);
+#endif
+}
+
+/*
+ * rd = the big endian value of 1 << order bytes at skb->data + r_off,
+ * executed only if cond holds.
+ */
+static void emit_load_be(u8 cond, unsigned order, u8 rd, struct jit_ctx *ctx)
+{
+#if __LINUX_ARM_ARCH__ < 6
+	unsigned i;
+
+	if (order == 0) {
+		_emit(cond, ARM_LDRB_R(rd, r_skb_data, r_off), ctx);
+		return;
+	}
+	/* no unaligned accesses, so assemble it a byte at a time */
+	_emit(cond, ARM_ADD_R(r_addr, r_skb_data, r_off), ctx);
+	_emit(cond, ARM_LDRB_I(rd, r_addr, 0), ctx);
+	for (i = 1; i < 1 << order; i++) {
+		_emit(cond, ARM_LDRB_I(r_tmp, r_addr, i), ctx);
+		_emit(cond, ARM_ORR_S(rd, r_tmp, rd, SRTYPE_LSL, 8), ctx);
+	}
+#else
+	switch (order) {
+	case 0:
+		_emit(cond, ARM_LDRB_R(rd, r_skb_data, r_off), ctx);
+		break;
+	case 1:
+		_emit(cond, ARM_LDRH_R(rd, r_skb_data, r_off), ctx);
+		_emit(cond, ARM_REV16(rd, rd), ctx);
+		break;
+	default:
+		_emit(cond, ARM_LDR_R(rd, r_skb_data, r_off), ctx);
+		_emit(cond, ARM_REV(rd, rd), ctx);
+		break;
+	}
+#endif
+}
+
+/*
+ * Load 1 << order bytes of packet data at offset r_off into rd.  If
+ * inline_ok, data in the linear part of the skb is read directly;
+ * everything else goes through the jit_get_skb_*() helpers.
+ */
+static void emit_load_skb(unsigned order, u8 rd, bool inline_ok,
+			  struct jit_ctx *ctx)
+{
+	static u64 (* const load_func[])(struct sk_buff *, int) = {
+		jit_get_skb_b,
+		jit_get_skb_h,
+		jit_get_skb_w,
+	};
+	unsigned br = 0;
+
+	ctx->seen |= SEEN_SKB | SEEN_DATA | SEEN_CALL;
+
+	if (inline_ok) {
+		/*
+		 * r_off <= headlen - size, unsigned, which also rejects
+		 * negative offsets; skip the compare if headlen < size.
+		 */
+		emit(ARM_SUBS_I(r_addr, r_skb_hl, 1 << order), ctx);
+		_emit(ARM_COND_HS, ARM_CMP_R(r_addr, r_off), ctx);
+		emit_load_be(ARM_COND_HS, order, rd, ctx);
+		/* branch over the slow path, patched below */
+		br = ctx->idx;
+		_emit(ARM_COND_HS, ARM_B(0), ctx);
+	}
+
+	emit(ARM_MOV_R(ARM_R0, r_skb), ctx);
+	/* the offset is already in r1 */
+	emit_mov_i(r_addr, (u32)load_func[order], ctx);
+	emit_blx_r(r_addr, ctx);
+	emit(ARM_CMP_I(ARM_R1, 0), ctx);
+	emit_err_ret(ARM_COND_NE, ctx);
+	emit(ARM_MOV_R(rd, ARM_R0), ctx);
+
+	if (inline_ok && ctx->target != NULL)
+		ctx->target[br] = ARM_B(ctx->idx - (br + 2)) |
+				  ARM_COND_HS << 28;
+}
+
+static u16 saved_regs(struct jit_ctx *ctx)
+{
+	u16 ret = 0;
+
+	if (ctx->seen & SEEN_A)
+		ret |= 1 << r_A;
+	if (ctx->seen & SEEN_X)
+		ret |= 1 << r_X;
+	if (ctx->seen & SEEN_SKB)
+		ret |= 1 << r_skb;
+	if (ctx->seen & SEEN_DATA)
+		ret |= (1 << r_skb_data) | (1 << r_skb_hl);
+	if (ctx->seen & SEEN_CALL) {
+		ret |= 1 << ARM_LR;
+		/* the helpers expect an 8 byte aligned stack */
+		if (hweight16(ret) & 1)
+			ret |= 1 << ARM_R9;
+	}
+
+	return ret;
+}
+
+/* does the first instruction set A, so it needn't be cleared? */
+static inline bool first_insn_sets_a(u16 code)
+{
+	switch (code) {
+	case BPF_S_LD_W_ABS:
+	case BPF_S_LD_H_ABS:
+	case BPF_S_LD_B_ABS:
+	case BPF_S_LD_W_LEN:
+	case BPF_S_LD_IMM:
+	case BPF_S_ANC_PROTOCOL:
+	case BPF_S_ANC_IFINDEX:
+	case BPF_S_ANC_MARK:
+	case BPF_S_ANC_QUEUE:
+	case BPF_S_ANC_HATYPE:
+	case BPF_S_ANC_RXHASH:
+	case BPF_S_ANC_CPU:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void build_prologue(struct jit_ctx *ctx)
+{
+	u16 reg_set = saved_regs(ctx);
+
+	if (reg_set)
+		emit(ARM_PUSH(reg_set), ctx);
+
+	if (ctx->seen & SEEN_MEM)
+		emit(ARM_SUB_I(ARM_SP, ARM_SP, imm8m(BPF_MEMWORDS * 4)), ctx);
+
+	if (ctx->seen & SEEN_SKB)
+		emit(ARM_MOV_R(r_skb, ARM_R0), ctx);
+
+	if (ctx->seen & SEEN_DATA) {
+		EMIT_LDR_FIELD(r_skb_data, r_skb, struct sk_buff, data, ctx);
+		EMIT_LDR_FIELD(r_skb_hl, r_skb, struct sk_buff, len, ctx);
+		EMIT_LDR_FIELD(r_scratch, r_skb, struct sk_buff, data_len, ctx);
+		emit(ARM_SUB_R(r_skb_hl, r_skb_hl, r_scratch), ctx);
+	}
+
+	/* make sure we don't leak kernel information to user space */
+	if (ctx->seen & SEEN_X)
+		emit(ARM_MOV_I(r_X, 0), ctx);
+	if ((ctx->seen & SEEN_A) && !first_insn_sets_a(ctx->skf->insns[0].code))
+		emit(ARM_MOV_I(r_A, 0), ctx);
+}
+
+static void build_epilogue(struct jit_ctx *ctx)
+{
+	u16 reg_set = saved_regs(ctx);
+
+	if (ctx->seen & SEEN_MEM)
+		emit(ARM_ADD_I(ARM_SP, ARM_SP, imm8m(BPF_MEMWORDS * 4)), ctx);
+
+	if (reg_set & (1 << ARM_LR)) {
+		reg_set &= ~(1 << ARM_LR);
+		emit(ARM_POP(reg_set | 1 << ARM_PC), ctx);
+		return;
+	}
+
+	if (reg_set)
+		emit(ARM_POP(reg_set), ctx);
+#if __LINUX_ARM_ARCH__ < 5
+	emit(ARM_MOV_R(ARM_PC, ARM_LR), ctx);
+#else
+	emit(ARM_BX(ARM_LR), ctx);
+#endif
+}
+
+static int build_body(struct jit_ctx *ctx)
+{
+	const struct sk_filter *prog = ctx->skf;
+	const struct sock_filter *inst;
+	unsigned i, load_order;
+	int imm12;
+	u8 condt;
+	u32 k;
+
+	for (i = 0; i < prog->len; i++) {
+		inst = &(prog->insns[i]);
+		k = inst->k;
+
+		/* body offsets, the prologue size is added by the caller */
+		if (ctx->target == NULL)
+			ctx->offsets[i] = ctx->idx;
+
+		switch (inst->code) {
+		case BPF_S_RET_K:
+		case BPF_S_JMP_JA:
+		case BPF_S_LDX_IMM:
+		case BPF_S_LDX_MEM:
+		case BPF_S_LDX_W_LEN:
+		case BPF_S_LDX_B_MSH:
+		case BPF_S_STX:
+			break;
+		default:
+			ctx->seen |= SEEN_A;
+		}
+
+		switch (inst->code) {
+		case BPF_S_LD_IMM:
+			emit_mov_i(r_A, k, ctx);
+			break;
+		case BPF_S_LD_W_LEN:
+			ctx->seen |= SEEN_SKB;
+			EMIT_LDR_FIELD(r_A, r_skb, struct sk_buff, len, ctx);
+			break;
+		case BPF_S_LD_MEM:
+			/* A = scratch[k] */
+			ctx->seen |= SEEN_MEM;
+			emit(ARM_LDR_I(r_A, ARM_SP, 4 * k), ctx);
+			break;
+		case BPF_S_LD_W_ABS:
+			load_order = 2;
+			goto load_abs;
+		case BPF_S_LD_H_ABS:
+			load_order = 1;
+			goto load_abs;
+		case BPF_S_LD_B_ABS:
+			load_order = 0;
+load_abs:
+			emit_mov_i(r_off, k, ctx);
+			emit_load_skb(load_order, r_A, (int)k >= 0, ctx);
+			break;
+		case BPF_S_LD_W_IND:
+			load_order = 2;
+			goto load_ind;
+		case BPF_S_LD_H_IND:
+			load_order = 1;
+			goto load_ind;
+		case BPF_S_LD_B_IND:
+			load_order = 0;
+load_ind:
+			ctx->seen |= SEEN_X;
+			OP_IMM3(ARM_ADD, r_off, r_X, k, ctx);
+			emit_load_skb(load_order, r_A, true, ctx);
+			break;
+		case BPF_S_LDX_IMM:
+			ctx->seen |= SEEN_X;
+			emit_mov_i(r_X, k, ctx);
+			break;
+		case BPF_S_LDX_W_LEN:
+			ctx->seen |= SEEN_X | SEEN_SKB;
+			EMIT_LDR_FIELD(r_X, r_skb, struct sk_buff, len, ctx);
+			break;
+		case BPF_S_LDX_MEM:
+			ctx->seen |= SEEN_X | SEEN_MEM;
+			emit(ARM_LDR_I(r_X, ARM_SP, 4 * k), ctx);
+			break;
+		case BPF_S_LDX_B_MSH:
+			/* x = ((*(frame + k)) & 0xf) << 2; */
+			ctx->seen |= SEEN_X;
+			emit_mov_i(r_off, k, ctx);
+			emit_load_skb(0, r_X, (int)k >= 0, ctx);
+			emit(ARM_AND_I(r_X, r_X, 0x0f), ctx);
+			emit(ARM_LSL_I(r_X, r_X, 2), ctx);
+			break;
+		case BPF_S_ST:
+			ctx->seen |= SEEN_MEM;
+			emit(ARM_STR_I(r_A, ARM_SP, 4 * k), ctx);
+			break;
+		case BPF_S_STX:
+			ctx->seen |= SEEN_X | SEEN_MEM;
+			emit(ARM_STR_I(r_X, ARM_SP, 4 * k), ctx);
+			break;
+		case BPF_S_ALU_ADD_K:
+			/* A += K */
+			OP_IMM3(ARM_ADD, r_A, r_A, k, ctx);
+			break;
+		case BPF_S_ALU_ADD_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_ADD_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_SUB_K:
+			/* A -= K */
+			OP_IMM3(ARM_SUB, r_A, r_A, k, ctx);
+			break;
+		case BPF_S_ALU_SUB_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_SUB_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_MUL_K:
+			/* A *= K */
+			emit_mov_i(r_scratch, k, ctx);
+			emit(ARM_MUL(r_A, r_scratch, r_A), ctx);
+			break;
+		case BPF_S_ALU_MUL_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_MUL(r_A, r_X, r_A), ctx);
+			break;
+		case BPF_S_ALU_DIV_K:
+			/*
+			 * sk_chk_filter() replaced K by its reciprocal, so
+			 * this is reciprocal_divide(): A = (A * K) >> 32.
+			 */
+			emit_mov_i(r_scratch, k, ctx);
+			emit(ARM_UMULL(r_tmp, r_A, r_scratch, r_A), ctx);
+			break;
+		case BPF_S_ALU_DIV_X:
+			ctx->seen |= SEEN_X | SEEN_CALL;
+			emit(ARM_CMP_I(r_X, 0), ctx);
+			emit_err_ret(ARM_COND_EQ, ctx);
+			emit(ARM_MOV_R(ARM_R0, r_A), ctx);
+			emit(ARM_MOV_R(ARM_R1, r_X), ctx);
+			emit_mov_i(r_addr, (u32)jit_udiv, ctx);
+			emit_blx_r(r_addr, ctx);
+			emit(ARM_MOV_R(r_A, ARM_R0), ctx);
+			break;
+		case BPF_S_ALU_OR_K:
+			/* A |= K */
+			OP_IMM3(ARM_ORR, r_A, r_A, k, ctx);
+			break;
+		case BPF_S_ALU_OR_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_ORR_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_AND_K:
+			/* A &= K */
+			OP_IMM3(ARM_AND, r_A, r_A, k, ctx);
+			break;
+		case BPF_S_ALU_AND_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_AND_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_LSH_K:
+			/*
+			 * An immediate shift only reaches 31; bigger ones go
+			 * through a register, like the interpreter's do.
+			 */
+			if (k == 0)
+				break;
+			if (k < 32) {
+				emit(ARM_LSL_I(r_A, r_A, k), ctx);
+			} else {
+				emit_mov_i(r_scratch, k, ctx);
+				emit(ARM_LSL_R(r_A, r_A, r_scratch), ctx);
+			}
+			break;
+		case BPF_S_ALU_LSH_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_LSL_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_RSH_K:
+			/* an immediate of 0 would mean lsr #32 */
+			if (k == 0)
+				break;
+			if (k < 32) {
+				emit(ARM_LSR_I(r_A, r_A, k), ctx);
+			} else {
+				emit_mov_i(r_scratch, k, ctx);
+				emit(ARM_LSR_R(r_A, r_A, r_scratch), ctx);
+			}
+			break;
+		case BPF_S_ALU_RSH_X:
+			ctx->seen |= SEEN_X;
+			emit(ARM_LSR_R(r_A, r_A, r_X), ctx);
+			break;
+		case BPF_S_ALU_NEG:
+			/* A = -A */
+			emit(ARM_RSB_I(r_A, r_A, 0), ctx);
+			break;
+		case BPF_S_JMP_JA:
+			/* pc += K */
+			if (k)
+				emit(ARM_B(b_imm(i + k + 1, ctx)), ctx);
+			break;
+		case BPF_S_JMP_JEQ_K:
+			/* pc += (A == K) ? pc->jt : pc->jf */
+			condt = ARM_COND_EQ;
+			goto cmp_imm;
+		case BPF_S_JMP_JGT_K:
+			/* pc += (A > K) ? pc->jt : pc->jf */
+			condt = ARM_COND_HI;
+			goto cmp_imm;
+		case BPF_S_JMP_JGE_K:
+			/* pc += (A >= K) ? pc->jt : pc->jf */
+			condt = ARM_COND_HS;
+cmp_imm:
+			imm12 = imm8m(k);
+			if (imm12 < 0) {
+				emit_mov_i_no8m(r_scratch, k, ctx);
+				emit(ARM_CMP_R(r_A, r_scratch), ctx);
+			} else {
+				emit(ARM_CMP_I(r_A, imm12), ctx);
+			}
+cond_jump:
+			/* inverting the low bit of the condition negates it */
+			if (inst->jt)
+				_emit(condt, ARM_B(b_imm(i + inst->jt + 1,
+						   ctx)), ctx);
+			if (inst->jf)
+				_emit(condt ^ 1, ARM_B(b_imm(i + inst->jf + 1,
+						       ctx)), ctx);
+			break;
+		case BPF_S_JMP_JEQ_X:
+			/* pc += (A == X) ? pc->jt : pc->jf */
+			condt = ARM_COND_EQ;
+			goto cmp_x;
+		case BPF_S_JMP_JGT_X:
+			/* pc += (A > X) ? pc->jt : pc->jf */
+			condt = ARM_COND_HI;
+			goto cmp_x;
+		case BPF_S_JMP_JGE_X:
+			/* pc += (A >= X) ? pc->jt : pc->jf */
+			condt = ARM_COND_HS;
+cmp_x:
+			ctx->seen |= SEEN_X;
+			emit(ARM_CMP_R(r_A, r_X), ctx);
+			goto cond_jump;
+		case BPF_S_JMP_JSET_K:
+			/* pc += (A & K) ? pc->jt : pc->jf */
+			condt = ARM_COND_NE;
+			imm12 = imm8m(k);
+			if (imm12 < 0) {
+				emit_mov_i_no8m(r_scratch, k, ctx);
+				emit(ARM_TST_R(r_A, r_scratch), ctx);
+			} else {
+				emit(ARM_TST_I(r_A, imm12), ctx);
+			}
+			goto cond_jump;
+		case BPF_S_JMP_JSET_X:
+			/* pc += (A & X) ? pc->jt : pc->jf */
+			ctx->seen |= SEEN_X;
+			condt = ARM_COND_NE;
+			emit(ARM_TST_R(r_A, r_X), ctx);
+			goto cond_jump;
+		case BPF_S_RET_A:
+			emit(ARM_MOV_R(ARM_R0, r_A), ctx);
+			goto b_epilogue;
+		case BPF_S_RET_K:
+			emit_mov_i(ARM_R0, k, ctx);
+b_epilogue:
+			if (i != prog->len - 1)
+				emit(ARM_B(b_imm(prog->len, ctx)), ctx);
+			break;
+		case BPF_S_MISC_TAX:
+			/* X = A */
+			ctx->seen |= SEEN_X;
+			emit(ARM_MOV_R(r_X, r_A), ctx);
+			break;
+		case BPF_S_MISC_TXA:
+			/* A = X */
+			ctx->seen |= SEEN_X;
+			emit(ARM_MOV_R(r_A, r_X), ctx);
+			break;
+		case BPF_S_ANC_PROTOCOL:
+			/* A = ntohs(skb->protocol) */
+			ctx->seen |= SEEN_SKB;
+			EMIT_LDR_FIELD(r_A, r_skb, struct sk_buff, protocol, ctx);
+			emit_swap16(r_A, ctx);
+			break;
+		case BPF_S_ANC_CPU:
+			/* A = current_thread_info()->cpu */
+#ifdef CONFIG_SMP
+			emit(ARM_MOV_R(r_scratch, ARM_SP), ctx);
+			emit(ARM_LSR_I(r_scratch, r_scratch, ilog2(THREAD_SIZE)),
+			     ctx);
+			emit(ARM_LSL_I(r_scratch, r_scratch, ilog2(THREAD_SIZE)),
+			     ctx);
+			EMIT_LDR_FIELD(r_A, r_scratch, struct thread_info, cpu, ctx);
+#else
+			emit(ARM_MOV_I(r_A, 0), ctx);
+#endif
+			break;
+		case BPF_S_ANC_IFINDEX:
+		case BPF_S_ANC_HATYPE:
+			/* return 0 if skb->dev is NULL */
+			ctx->seen |= SEEN_SKB;
+			EMIT_LDR_FIELD(r_addr, r_skb, struct sk_buff, dev, ctx);
+			emit(ARM_CMP_I(r_addr, 0), ctx);
+			emit_err_ret(ARM_COND_EQ, ctx);
+			if (inst->code == BPF_S_ANC_IFINDEX)
+				EMIT_LDR_FIELD(r_A, r_addr, struct net_device,
+					       ifindex, ctx);
+			else
+				EMIT_LDR_FIELD(r_A, r_addr, struct net_device,
+					       type, ctx);
+			break;
+		case BPF_S_ANC_MARK:
+			ctx->seen |= SEEN_SKB;
+			EMIT_LDR_FIELD(r_A, r_skb, struct sk_buff, mark, ctx);
+			break;
+		case BPF_S_ANC_RXHASH:
+			ctx->seen |= SEEN_SKB;
+			EMIT_LDR_FIELD(r_A, r_skb, struct sk_buff, rxhash, ctx);
+			break;
+		case BPF_S_ANC_QUEUE:
+			ctx->seen |= SEEN_SKB;
+			EMIT_LDR_FIELD(r_A, r_skb, struct sk_buff, queue_mapping,
+				       ctx);
+			break;
+		default:
+			/* pkt_type is a bitfield and the nlattr ones call
+			 * into the netlink code: leave those filters to
+			 * the interpreter */
+			return -1;
+		}
+	}
+
+	/* the epilogue follows the last instruction, which is a RET */
+	if (ctx->target == NULL)
+		ctx->offsets[i] = ctx->idx;
+
+	return 0;
+}
+
+void bpf_jit_compile(struct sk_filter *fp)
+{
+	struct jit_ctx ctx;
+	unsigned prologue_len, alloc_size;
+	unsigned i;
+
+	if (!bpf_jit_enable)
+		return;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.skf = fp;
+
+	ctx.offsets = kzalloc(sizeof(*ctx.offsets) * (fp->len + 1),
+			      GFP_KERNEL);
+	if (ctx.offsets == NULL)
+		return;
+
+	/* sizing pass, which also fills in ctx.seen */
+	if (build_body(&ctx))
+		goto out;
+
+	ctx.idx = 0;
+	build_prologue(&ctx);
+	prologue_len = ctx.idx;
+	for (i = 0; i <= fp->len; i++)
+		ctx.offsets[i] += prologue_len;
+
+	ctx.idx = ctx.offsets[fp->len];
+	build_epilogue(&ctx);
+
+	/* the image is reused as a work_struct to free it, see below */
+	alloc_size = max_t(unsigned, 4 * ctx.idx, sizeof(struct work_struct));
+	ctx.target = module_alloc(alloc_size);
+	if (ctx.target == NULL)
+		goto out;
+
+	ctx.idx = 0;
+	build_prologue(&ctx);
+	build_body(&ctx);
+	build_epilogue(&ctx);
+
+	flush_icache_range((u32)ctx.target, (u32)(ctx.target + ctx.idx));
+
+	if (bpf_jit_enable > 1) {
+		pr_err("flen=%d proglen=%u image=%p\n",
+		       fp->len, 4 * ctx.idx, ctx.target);
+		print_hex_dump(KERN_ERR, "JIT code: ", DUMP_PREFIX_ADDRESS,
+			       16, 4, ctx.target, 4 * ctx.idx, false);
+	}
+
+	fp->bpf_func = (void *)ctx.target;
+out:
+	kfree(ctx.offsets);
+}
+
+static void bpf_jit_free_worker(struct work_struct *work)
+{
+	module_free(NULL, work);
+}
+
+/* run from softirq, we must use a work_struct to call
+ * module_free() from process context
+ */
+void bpf_jit_free(struct sk_filter *fp)
+{
+	struct work_struct *work;
+
+	if (fp->bpf_func != sk_run_filter) {
+		work = (struct work_struct *)fp->bpf_func;
+
+		INIT_WORK(work, bpf_jit_free_worker);
+		schedule_work(work);
+	}
+}
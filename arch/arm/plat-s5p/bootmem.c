@@ -15,6 +15,7 @@
 #include <linux/mm.h>
 #include <linux/swap.h>
 #include <asm/setup.h>
+#include <asm/sizes.h>
 #include <linux/io.h>
 #include <mach/memory.h>
 #include <plat/media.h>
@@ -91,11 +92,45 @@ dma_addr_t s5p_get_media_membase_bank(int bank)
 }
 EXPORT_SYMBOL(s5p_get_media_membase_bank);
 
+/*
+ * The kernel never maps the media carve-outs, so end a memory bank below
+ * those at its top.  For the last lowmem bank that moves high_memory and
+ * with it VMALLOC_START down: the vmalloc area grows by the size of the
+ * carve-outs instead of that address space going unused, which leaves
+ * less reason to raise it with vmalloc= at the cost of truncating RAM.
+ */
+static void s5p_trim_bank(struct membank *bank)
+{
+	struct s5p_media_device *mdev;
+	phys_addr_t end = bank->start + bank->size;
+	int i;
+
+again:
+	for (i = 0; i < nr_media_devs; i++) {
+		mdev = &media_devs[i];
+		if (mdev->memsize <= 0 || mdev->paddr + mdev->memsize != end ||
+		    mdev->paddr <= bank->start || memblock_is_memory(mdev->paddr))
+			continue;
+
+		end = mdev->paddr;
+		goto again;
+	}
+
+	if (end != bank->start + bank->size) {
+		printk(KERN_INFO "s5p: bank at 0x%08llx ends at 0x%08llx below "
+			"media memory, %lu bytes of address space freed\n",
+			(unsigned long long)bank->start, (unsigned long long)end,
+			(unsigned long)(bank->start + bank->size - end));
+		bank->size = end - bank->start;
+	}
+}
+
 void s5p_reserve_bootmem(struct s5p_media_device *mdevs,
 			 int nr_mdevs, size_t boundary)
 {
 	struct s5p_media_device *mdev;
 	u64 start, end;
+	size_t align;
 	int i, ret;
 
 	media_devs = mdevs;
@@ -116,8 +151,19 @@ void s5p_reserve_bootmem(struct s5p_media_device *mdevs,
 			if (boundary && (boundary < end - start))
 				start = end - boundary;
 
+			align = PAGE_SIZE;
+#ifdef CONFIG_ARM_USER_LARGE_PAGES
+			/*
+			 * Keep the carve-outs 64K aligned so that user space
+			 * mappings of them can use large pages.
+			 */
+			if (mdev->memsize >= SZ_64K) {
+				mdev->memsize = ALIGN(mdev->memsize, SZ_64K);
+				align = SZ_64K;
+			}
+#endif
 			mdev->paddr = memblock_find_in_range(start, end,
-						mdev->memsize, PAGE_SIZE);
+						mdev->memsize, align);
 		}
 
 		ret = memblock_remove(mdev->paddr, mdev->memsize);
@@ -133,6 +179,9 @@ void s5p_reserve_bootmem(struct s5p_media_device *mdevs,
 			(unsigned long) mdev->memsize, mdev->name, mdev->paddr,
 			mdev->bank, media_base[mdev->bank]);
 	}
+
+	for (i = 0; i < meminfo.nr_banks; i++)
+		s5p_trim_bank(&meminfo.bank[i]);
 }
 
 /* FIXME: temporary implementation to avoid compile error */
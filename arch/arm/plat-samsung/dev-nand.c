@@ -14,6 +14,7 @@
 #include <linux/mtd/partitions.h>
 
 #include <mach/map.h>
+#include <mach/irqs.h>
 #include <plat/devs.h>
 #include <plat/nand.h>
 
@@ -22,7 +23,14 @@ static struct resource s3c_nand_resource[] = {
 		.start = S3C_PA_NAND,
 		.end   = S3C_PA_NAND + SZ_1M,
 		.flags = IORESOURCE_MEM,
-	}
+	},
+#ifdef IRQ_NFC
+	[1] = {
+		.start = IRQ_NFC,
+		.end   = IRQ_NFC,
+		.flags = IORESOURCE_IRQ,
+	},
+#endif
 };
 
 struct platform_device s3c_device_nand = {
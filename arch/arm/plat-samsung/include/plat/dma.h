@@ -21,6 +21,7 @@ enum s3c2410_dmasrc {
 	S3C2410_DMASRC_MEM,		/* source is hardware */
 	S3C_DMA_MEM2MEM,
 	S3C_DMA_MEM2MEM_SET,
+	S3C_DMA_MEM2MEM_FIFO,		/* destination is a fixed address */
 };
 
 /* enum s3c2410_chan_op
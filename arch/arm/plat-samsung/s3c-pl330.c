@@ -696,7 +696,8 @@ int s3c2410_dma_enqueue(enum dma_ch id, void *token,
 	xfer->px.next = NULL; /* Single request */
 
 	/* For S3C DMA API, direction is always fixed for all xfers */
-	if (ch->req[0].rqtype == MEMTODEV) {
+	if (ch->req[0].rqtype == MEMTODEV ||
+	    (ch->req[0].rqtype == MEMTOMEM && !ch->rqcfg.dst_inc)) {
 		xfer->px.src_addr = addr;
 		xfer->px.dst_addr = ch->sdaddr;
 	} else {
@@ -1001,6 +1002,12 @@ int s3c2410_dma_devconfig(enum dma_ch id, enum s3c2410_dmasrc source,
 		ch->rqcfg.src_inc = 0;
 		ch->rqcfg.dst_inc = 1;
 		break;
+	case S3C_DMA_MEM2MEM_FIFO:
+		ch->req[0].rqtype = MEMTOMEM;
+		ch->req[1].rqtype = MEMTOMEM;
+		ch->rqcfg.src_inc = 1;
+		ch->rqcfg.dst_inc = 0;
+		break;
 	default:
 		ret = -EINVAL;
 		goto devcfg_exit;
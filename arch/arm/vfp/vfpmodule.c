@@ -11,14 +11,18 @@
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/cpu.h>
+#include <linux/hardirq.h>
 #include <linux/kernel.h>
 #include <linux/notifier.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/init.h>
 
 #include <asm/cputype.h>
+#include <asm/neon.h>
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
 
@@ -61,6 +65,10 @@ static void vfp_thread_flush(struct thread_info *thread)
 	vfp->hard.fpexc = FPEXC_EN;
 	vfp->hard.fpscr = FPSCR_ROUND_NEAREST;
 
+	/* a new program starts with lazy restores */
+	thread->vfp_used = 0;
+	thread->vfp_slices = 0;
+
 	/*
 	 * Disable VFP to ensure we initialize it first.  We must ensure
 	 * that the modification of vfp_current_hw_state[] and hardware disable
@@ -90,6 +98,51 @@ static void vfp_thread_copy(struct thread_info *thread)
 
 	vfp_sync_hwstate(parent);
 	thread->vfpstate = parent->vfpstate;
+
+	thread->vfp_traps = 0;
+	thread->vfp_eager = 0;
+	thread->vfp_used = 0;
+	thread->vfp_slices = 0;
+}
+
+/*
+ * Threads that used the VFP in more than VFP_EAGER_SLICES timeslices in
+ * a row get their state loaded at the switch, saving them the undefined
+ * instruction trap of their first VFP instruction in every timeslice.
+ * As with the x86 fpu_counter the count is 8 bits wide: when it wraps, the
+ * thread goes back to lazy restores for a few timeslices, which is how a
+ * thread that stopped using the VFP loses its eager restores.
+ */
+#define VFP_EAGER_SLICES	5
+
+static void vfp_eager_restore(struct thread_info *thread, unsigned int cpu,
+			      u32 fpexc)
+{
+	union vfp_state *vfp = &thread->vfpstate;
+	union vfp_state *owner = vfp_current_hw_state[cpu];
+
+	if (owner == vfp) {
+		/* leave a pending exception to the support code */
+		if (fpexc & FPEXC_EX)
+			return;
+		fmxr(FPEXC, fpexc | FPEXC_EN);
+	} else {
+		if (vfp->hard.fpexc & FPEXC_EX)
+			return;
+
+		fmxr(FPEXC, (fpexc | FPEXC_EN) & ~FPEXC_EX);
+#ifndef CONFIG_SMP
+		/* the old owner's state is only in the registers */
+		if (owner)
+			vfp_save_state(owner, fpexc | FPEXC_EN);
+#endif
+		fpexc = vfp_load_state(vfp);
+		vfp_current_hw_state[cpu] = vfp;
+		fmxr(FPEXC, fpexc | FPEXC_EN);
+	}
+
+	thread->vfp_eager++;
+	thread->vfp_used = 1;
 }
 
 /*
@@ -118,18 +171,21 @@ static void vfp_thread_copy(struct thread_info *thread)
 static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 {
 	struct thread_info *thread = v;
-	u32 fpexc;
-#ifdef CONFIG_SMP
+	struct thread_info *prev;
 	unsigned int cpu;
-#endif
+	u32 fpexc;
 
 	switch (cmd) {
 	case THREAD_NOTIFY_SWITCH:
 		fpexc = fmrx(FPEXC);
-
-#ifdef CONFIG_SMP
 		cpu = thread->cpu;
 
+		/* we are still on the stack of the previous thread */
+		prev = current_thread_info();
+		prev->vfp_slices = prev->vfp_used ? prev->vfp_slices + 1 : 0;
+		prev->vfp_used = 0;
+
+#ifdef CONFIG_SMP
 		/*
 		 * On SMP, if VFP is enabled, save the old state in
 		 * case the thread migrates to a different CPU. The
@@ -153,6 +209,9 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 		 * old state.
 		 */
 		fmxr(FPEXC, fpexc & ~FPEXC_EN);
+
+		if (thread->vfp_slices > VFP_EAGER_SLICES)
+			vfp_eager_restore(thread, cpu, fpexc & ~FPEXC_EN);
 		break;
 
 	case THREAD_NOTIFY_FLUSH:
@@ -510,6 +569,81 @@ void vfp_flush_hwstate(struct thread_info *thread)
 	put_cpu();
 }
 
+#ifdef CONFIG_PROC_FS
+/*
+ * VFP_traps counts the undefined instruction traps that enabled the VFP
+ * for the task, VFP_eager the switches that restored its state up front.
+ */
+void arch_proc_pid_status(struct seq_file *m, struct task_struct *task)
+{
+	struct thread_info *thread = task_thread_info(task);
+
+	if (!(elf_hwcap & HWCAP_VFP))
+		return;
+
+	seq_printf(m, "VFP_traps:\t%lu\n", thread->vfp_traps);
+	seq_printf(m, "VFP_eager:\t%lu\n", thread->vfp_eager);
+}
+#endif
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/*
+ * Kernel-side NEON support functions
+ */
+DEFINE_PER_CPU(int, kernel_neon_busy);
+EXPORT_PER_CPU_SYMBOL(kernel_neon_busy);
+
+void kernel_neon_begin(void)
+{
+	struct thread_info *thread = current_thread_info();
+	unsigned int cpu;
+	u32 fpexc;
+
+	/*
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * with preemption disabled.  This makes sure that the kernel mode
+	 * NEON register contents never need to be preserved.
+	 */
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+	BUG_ON(per_cpu(kernel_neon_busy, cpu));
+	per_cpu(kernel_neon_busy, cpu) = 1;
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	/*
+	 * Save the userland NEON/VFP state.  Under UP, the owner could be
+	 * a task other than 'current'.
+	 */
+	if (vfp_current_hw_state[cpu] == &thread->vfpstate
+#ifdef CONFIG_SMP
+	    && thread->vfpstate.hard.cpu == cpu
+#endif
+	    )
+		vfp_save_state(&thread->vfpstate, fpexc);
+#ifndef CONFIG_SMP
+	else if (vfp_current_hw_state[cpu] != NULL)
+		vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+#endif
+
+	/* the owner reloads its state on its next VFP instruction */
+	vfp_current_hw_state[cpu] = NULL;
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/* Disable the NEON/VFP unit. */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	__get_cpu_var(kernel_neon_busy) = 0;
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
 /*
  * VFP hardware can lose all context when a CPU goes offline.
  * As we will be running in SMP mode with CPU hotplug, we will save the
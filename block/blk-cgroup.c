@@ -180,6 +180,23 @@ static inline void blkio_update_group_iops(struct blkio_group *blkg,
 	}
 }
 
+static inline void blkio_update_group_latency_target(struct blkio_group *blkg,
+			unsigned int lat_target)
+{
+	struct blkio_policy_type *blkiop;
+
+	list_for_each_entry(blkiop, &blkio_list, list) {
+
+		/* If this policy does not own the blkg, do not send updates */
+		if (blkiop->plid != blkg->plid)
+			continue;
+
+		if (blkiop->ops.blkio_update_group_latency_target_fn)
+			blkiop->ops.blkio_update_group_latency_target_fn(
+						blkg->key, blkg, lat_target);
+	}
+}
+
 /*
  * Add to the appropriate stat variable depending on the request type.
  * This should be called with the blkg->stats_lock held.
@@ -866,6 +883,14 @@ static int blkio_policy_parse_and_set(char *buf,
 			newpn->fileid = fileid;
 			newpn->val.iops = (unsigned int)temp;
 			break;
+		case BLKIO_THROTL_latency_target_device:
+			if (temp > UINT_MAX)
+				return -EINVAL;
+
+			newpn->plid = plid;
+			newpn->fileid = fileid;
+			newpn->val.lat_target = (unsigned int)temp;
+			break;
 		}
 		break;
 	default:
@@ -935,6 +960,17 @@ unsigned int blkcg_get_write_iops(struct blkio_cgroup *blkcg, dev_t dev)
 		return -1;
 }
 
+unsigned int blkcg_get_latency_target(struct blkio_cgroup *blkcg, dev_t dev)
+{
+	struct blkio_policy_node *pn;
+	pn = blkio_policy_search_node(blkcg, dev, BLKIO_POLICY_THROTL,
+				BLKIO_THROTL_latency_target_device);
+	if (pn)
+		return pn->val.lat_target;
+	else
+		return 0;
+}
+
 /* Checks whether user asked for deleting a policy rule */
 static bool blkio_delete_rule_command(struct blkio_policy_node *pn)
 {
@@ -954,6 +990,10 @@ static bool blkio_delete_rule_command(struct blkio_policy_node *pn)
 		case BLKIO_THROTL_write_iops_device:
 			if (pn->val.iops == 0)
 				return 1;
+			break;
+		case BLKIO_THROTL_latency_target_device:
+			if (pn->val.lat_target == 0)
+				return 1;
 		}
 		break;
 	default:
@@ -979,6 +1019,9 @@ static void blkio_update_policy_rule(struct blkio_policy_node *oldpn,
 		case BLKIO_THROTL_read_iops_device:
 		case BLKIO_THROTL_write_iops_device:
 			oldpn->val.iops = newpn->val.iops;
+			break;
+		case BLKIO_THROTL_latency_target_device:
+			oldpn->val.lat_target = newpn->val.lat_target;
 		}
 		break;
 	default:
@@ -1014,6 +1057,10 @@ static void blkio_update_blkg_policy(struct blkio_cgroup *blkcg,
 			iops = pn->val.iops ? pn->val.iops : (-1);
 			blkio_update_group_iops(blkg, iops, pn->fileid);
 			break;
+		case BLKIO_THROTL_latency_target_device:
+			blkio_update_group_latency_target(blkg,
+						pn->val.lat_target);
+			break;
 		}
 		break;
 	default:
@@ -1124,6 +1171,10 @@ blkio_print_policy_node(struct seq_file *m, struct blkio_policy_node *pn)
 				seq_printf(m, "%u:%u\t%u\n", MAJOR(pn->dev),
 					MINOR(pn->dev), pn->val.iops);
 				break;
+			case BLKIO_THROTL_latency_target_device:
+				seq_printf(m, "%u:%u\t%u\n", MAJOR(pn->dev),
+					MINOR(pn->dev), pn->val.lat_target);
+				break;
 			}
 			break;
 		default:
@@ -1173,6 +1224,7 @@ static int blkiocg_file_read(struct cgroup *cgrp, struct cftype *cft,
 		case BLKIO_THROTL_write_bps_device:
 		case BLKIO_THROTL_read_iops_device:
 		case BLKIO_THROTL_write_iops_device:
+		case BLKIO_THROTL_latency_target_device:
 			blkio_read_policy_node_files(cft, blkcg, m);
 			return 0;
 		default:
@@ -1469,6 +1521,15 @@ struct cftype blkio_files[] = {
 		.write_string = blkiocg_file_write,
 		.max_write_len = 256,
 	},
+
+	{
+		.name = "throttle.latency_target_device",
+		.private = BLKIOFILE_PRIVATE(BLKIO_POLICY_THROTL,
+				BLKIO_THROTL_latency_target_device),
+		.read_seq_string = blkiocg_file_read,
+		.write_string = blkiocg_file_write,
+		.max_write_len = 256,
+	},
 	{
 		.name = "throttle.io_service_bytes",
 		.private = BLKIOFILE_PRIVATE(BLKIO_POLICY_THROTL,
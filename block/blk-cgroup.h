@@ -107,6 +107,7 @@ enum blkcg_file_name_throtl {
 	BLKIO_THROTL_write_bps_device,
 	BLKIO_THROTL_read_iops_device,
 	BLKIO_THROTL_write_iops_device,
+	BLKIO_THROTL_latency_target_device,
 	BLKIO_THROTL_io_service_bytes,
 	BLKIO_THROTL_io_serviced,
 };
@@ -194,6 +195,8 @@ struct blkio_policy_node {
 		 */
 		u64 bps;
 		unsigned int iops;
+		/* read completion latency target in usecs */
+		unsigned int lat_target;
 	} val;
 };
 
@@ -207,6 +210,8 @@ extern unsigned int blkcg_get_read_iops(struct blkio_cgroup *blkcg,
 				     dev_t dev);
 extern unsigned int blkcg_get_write_iops(struct blkio_cgroup *blkcg,
 				     dev_t dev);
+extern unsigned int blkcg_get_latency_target(struct blkio_cgroup *blkcg,
+				     dev_t dev);
 
 typedef void (blkio_unlink_group_fn) (void *key, struct blkio_group *blkg);
 
@@ -220,6 +225,8 @@ typedef void (blkio_update_group_read_iops_fn) (void *key,
 			struct blkio_group *blkg, unsigned int read_iops);
 typedef void (blkio_update_group_write_iops_fn) (void *key,
 			struct blkio_group *blkg, unsigned int write_iops);
+typedef void (blkio_update_group_latency_target_fn) (void *key,
+			struct blkio_group *blkg, unsigned int lat_target);
 
 struct blkio_policy_ops {
 	blkio_unlink_group_fn *blkio_unlink_group_fn;
@@ -228,6 +235,7 @@ struct blkio_policy_ops {
 	blkio_update_group_write_bps_fn *blkio_update_group_write_bps_fn;
 	blkio_update_group_read_iops_fn *blkio_update_group_read_iops_fn;
 	blkio_update_group_write_iops_fn *blkio_update_group_write_iops_fn;
+	blkio_update_group_latency_target_fn *blkio_update_group_latency_target_fn;
 };
 
 struct blkio_policy_type {
@@ -2204,6 +2204,8 @@ static void blk_finish_request(struct request *req, int error)
 	if (req->cmd_flags & REQ_DONTPREP)
 		blk_unprep_request(req);
 
+	if (req->cmd_type == REQ_TYPE_FS)
+		blk_throtl_rq_done(req->q, req);
 
 	blk_account_io_done(req);
 
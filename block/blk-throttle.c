@@ -20,6 +20,17 @@ static int throtl_quantum = 32;
 /* Throttling is performed over 100ms slice and after that slice is renewed */
 static unsigned long throtl_slice = HZ/10;	/* 100 ms */
 
+/*
+ * Read latency of groups with a latency target is checked once per window.
+ * If the target was missed, groups without a target get an iops limit which
+ * is halved on every further miss and doubled on every window the target is
+ * met, until it grows past throtl_bg_iops_max and is dropped again.
+ */
+static unsigned long throtl_lat_window = HZ/10;	/* 100 ms */
+static unsigned int throtl_bg_iops_start = 256;
+static unsigned int throtl_bg_iops_min = 8;
+static unsigned int throtl_bg_iops_max = 2048;
+
 /* A workqueue to queue throttle related work */
 static struct workqueue_struct *kthrotld_workqueue;
 static void throtl_schedule_delayed_work(struct throtl_data *td,
@@ -67,6 +78,9 @@ struct throtl_grp {
 	/* IOPS limits */
 	unsigned int iops[2];
 
+	/* read completion latency target in usecs, 0 if none */
+	unsigned int lat_target;
+
 	/* Number of bytes disptached in current slice */
 	uint64_t bytes_disp[2];
 	/* Number of bio's dispatched in current slice */
@@ -105,6 +119,19 @@ struct throtl_data
 	struct delayed_work throtl_work;
 
 	int limits_changed;
+
+	/*
+	 * Latency target accounting. Completions of reads issued by groups
+	 * with a target are summed up over a window and compared against
+	 * the tightest target on the queue.
+	 */
+	unsigned int lat_target;
+	unsigned long lat_window_end;
+	unsigned int lat_nr;
+	u64 lat_sum_ns;
+
+	/* iops limit imposed on groups without a target, 0 if none */
+	unsigned int bg_iops;
 };
 
 enum tg_state_flags {
@@ -147,6 +174,23 @@ static inline int total_nr_queued(struct throtl_data *td)
 	return (td->nr_queued[0] + td->nr_queued[1]);
 }
 
+/* Is tg held back to let the groups with a latency target meet it? */
+static inline bool tg_lat_throttled(struct throtl_data *td,
+				    struct throtl_grp *tg)
+{
+	return td->bg_iops && !tg->lat_target && tg != td->root_tg;
+}
+
+/* Effective iops limit of tg, including the latency target throttling */
+static inline unsigned int tg_iops(struct throtl_data *td,
+				   struct throtl_grp *tg, bool rw)
+{
+	if (tg_lat_throttled(td, tg) && td->bg_iops < tg->iops[rw])
+		return td->bg_iops;
+
+	return tg->iops[rw];
+}
+
 static inline struct throtl_grp *throtl_ref_get_tg(struct throtl_grp *tg)
 {
 	atomic_inc(&tg->ref);
@@ -258,6 +302,10 @@ static void throtl_init_add_tg_lists(struct throtl_data *td,
 	tg->bps[WRITE] = blkcg_get_write_bps(blkcg, tg->blkg.dev);
 	tg->iops[READ] = blkcg_get_read_iops(blkcg, tg->blkg.dev);
 	tg->iops[WRITE] = blkcg_get_write_iops(blkcg, tg->blkg.dev);
+	tg->lat_target = blkcg_get_latency_target(blkcg, tg->blkg.dev);
+	if (tg->lat_target &&
+	    (!td->lat_target || tg->lat_target < td->lat_target))
+		td->lat_target = tg->lat_target;
 
 	throtl_add_group_to_td_list(td, tg);
 }
@@ -567,7 +615,7 @@ throtl_trim_slice(struct throtl_data *td, struct throtl_grp *tg, bool rw)
 	do_div(tmp, HZ);
 	bytes_trim = tmp;
 
-	io_trim = (tg->iops[rw] * throtl_slice * nr_slices)/HZ;
+	io_trim = (tg_iops(td, tg, rw) * throtl_slice * nr_slices)/HZ;
 
 	if (!bytes_trim && !io_trim)
 		return;
@@ -594,7 +642,7 @@ static bool tg_with_in_iops_limit(struct throtl_data *td, struct throtl_grp *tg,
 		struct bio *bio, unsigned long *wait)
 {
 	bool rw = bio_data_dir(bio);
-	unsigned int io_allowed;
+	unsigned int io_allowed, iops = tg_iops(td, tg, rw);
 	unsigned long jiffy_elapsed, jiffy_wait, jiffy_elapsed_rnd;
 	u64 tmp;
 
@@ -613,7 +661,7 @@ static bool tg_with_in_iops_limit(struct throtl_data *td, struct throtl_grp *tg,
 	 * have been trimmed.
 	 */
 
-	tmp = (u64)tg->iops[rw] * jiffy_elapsed_rnd;
+	tmp = (u64)iops * jiffy_elapsed_rnd;
 	do_div(tmp, HZ);
 
 	if (tmp > UINT_MAX)
@@ -628,7 +676,7 @@ static bool tg_with_in_iops_limit(struct throtl_data *td, struct throtl_grp *tg,
 	}
 
 	/* Calc approx time to dispatch */
-	jiffy_wait = ((tg->io_disp[rw] + 1) * HZ)/tg->iops[rw] + 1;
+	jiffy_wait = ((tg->io_disp[rw] + 1) * HZ)/iops + 1;
 
 	if (jiffy_wait > jiffy_elapsed)
 		jiffy_wait = jiffy_wait - jiffy_elapsed;
@@ -682,8 +730,9 @@ static bool tg_with_in_bps_limit(struct throtl_data *td, struct throtl_grp *tg,
 	return 0;
 }
 
-static bool tg_no_rule_group(struct throtl_grp *tg, bool rw) {
-	if (tg->bps[rw] == -1 && tg->iops[rw] == -1)
+static bool tg_no_rule_group(struct throtl_data *td, struct throtl_grp *tg,
+			     bool rw) {
+	if (tg->bps[rw] == -1 && tg_iops(td, tg, rw) == -1)
 		return 1;
 	return 0;
 }
@@ -707,7 +756,7 @@ static bool tg_may_dispatch(struct throtl_data *td, struct throtl_grp *tg,
 	BUG_ON(tg->nr_queued[rw] && bio != bio_list_peek(&tg->bio_lists[rw]));
 
 	/* If tg->bps = -1, then BW is unlimited */
-	if (tg->bps[rw] == -1 && tg->iops[rw] == -1) {
+	if (tg_no_rule_group(td, tg, rw)) {
 		if (wait)
 			*wait = 0;
 		return 1;
@@ -872,6 +921,24 @@ static int throtl_select_dispatch(struct throtl_data *td, struct bio_list *bl)
 	return nr_disp;
 }
 
+/* Recompute the tightest latency target on the queue. Call with queue lock */
+static void throtl_update_lat_target(struct throtl_data *td)
+{
+	struct throtl_grp *tg;
+	struct hlist_node *pos;
+	unsigned int lat_target = 0;
+
+	hlist_for_each_entry(tg, pos, &td->tg_list, tg_node) {
+		if (tg->lat_target &&
+		    (!lat_target || tg->lat_target < lat_target))
+			lat_target = tg->lat_target;
+	}
+
+	td->lat_target = lat_target;
+	if (!lat_target)
+		td->bg_iops = 0;
+}
+
 static void throtl_process_limit_change(struct throtl_data *td)
 {
 	struct throtl_grp *tg;
@@ -884,6 +951,8 @@ static void throtl_process_limit_change(struct throtl_data *td)
 
 	throtl_log(td, "limits changed");
 
+	throtl_update_lat_target(td);
+
 	hlist_for_each_entry_safe(tg, pos, n, &td->tg_list, tg_node) {
 		if (!tg->limits_changed)
 			continue;
@@ -892,8 +961,9 @@ static void throtl_process_limit_change(struct throtl_data *td)
 			continue;
 
 		throtl_log_tg(td, tg, "limit change rbps=%llu wbps=%llu"
-			" riops=%u wiops=%u", tg->bps[READ], tg->bps[WRITE],
-			tg->iops[READ], tg->iops[WRITE]);
+			" riops=%u wiops=%u lat=%u", tg->bps[READ],
+			tg->bps[WRITE], tg->iops[READ], tg->iops[WRITE],
+			tg->lat_target);
 
 		/*
 		 * Restart the slices for both READ and WRITES. It
@@ -990,6 +1060,9 @@ throtl_destroy_tg(struct throtl_data *td, struct throtl_grp *tg)
 
 	hlist_del_init(&tg->tg_node);
 
+	if (tg->lat_target)
+		throtl_update_lat_target(td);
+
 	/*
 	 * Put the reference taken at the time of creation so that when all
 	 * queues are gone, group can be destroyed.
@@ -1101,6 +1174,16 @@ static void throtl_update_blkio_group_write_iops(void *key,
 	throtl_update_blkio_group_common(td, tg);
 }
 
+static void throtl_update_blkio_group_latency_target(void *key,
+			struct blkio_group *blkg, unsigned int lat_target)
+{
+	struct throtl_data *td = key;
+	struct throtl_grp *tg = tg_of_blkg(blkg);
+
+	tg->lat_target = lat_target;
+	throtl_update_blkio_group_common(td, tg);
+}
+
 static void throtl_shutdown_wq(struct request_queue *q)
 {
 	struct throtl_data *td = q->td;
@@ -1119,6 +1202,8 @@ static struct blkio_policy_type blkio_policy_throtl = {
 					throtl_update_blkio_group_read_iops,
 		.blkio_update_group_write_iops_fn =
 					throtl_update_blkio_group_write_iops,
+		.blkio_update_group_latency_target_fn =
+				throtl_update_blkio_group_latency_target,
 	},
 	.plid = BLKIO_POLICY_THROTL,
 };
@@ -1148,7 +1233,11 @@ int blk_throtl_bio(struct request_queue *q, struct bio **biop)
 	if (tg) {
 		throtl_tg_fill_dev_details(td, tg);
 
-		if (tg_no_rule_group(tg, rw)) {
+		/* have blk_throtl_rq_done() account the read's latency */
+		if (tg->lat_target && rw == READ)
+			bio->bi_rw |= REQ_LAT_TARGET;
+
+		if (tg_no_rule_group(td, tg, rw)) {
 			blkiocg_update_dispatch_stats(&tg->blkg, bio->bi_size,
 					rw, bio->bi_rw & REQ_SYNC);
 			rcu_read_unlock();
@@ -1174,6 +1263,9 @@ int blk_throtl_bio(struct request_queue *q, struct bio **biop)
 		}
 	}
 
+	if (tg->lat_target && rw == READ)
+		bio->bi_rw |= REQ_LAT_TARGET;
+
 	if (tg->nr_queued[rw]) {
 		/*
 		 * There is already another bio queued in same dir. No
@@ -1224,6 +1316,88 @@ out:
 	return 0;
 }
 
+/*
+ * Background groups changed between throttled and unthrottled, or their
+ * limit moved. Restart their slices so already dispatched IO is not charged
+ * at the new rate, and requeue the ones with bios waiting.
+ */
+static void throtl_lat_update_bg(struct throtl_data *td)
+{
+	struct throtl_grp *tg;
+	struct hlist_node *pos;
+
+	throtl_log(td, "lat target=%u bg_iops=%u", td->lat_target, td->bg_iops);
+
+	hlist_for_each_entry(tg, pos, &td->tg_list, tg_node) {
+		if (tg->lat_target || tg == td->root_tg)
+			continue;
+
+		throtl_start_new_slice(td, tg, READ);
+		throtl_start_new_slice(td, tg, WRITE);
+
+		if (throtl_tg_on_rr(tg))
+			tg_update_disptime(td, tg);
+	}
+
+	throtl_schedule_next_dispatch(td);
+}
+
+/*
+ * Called with queue lock held on completion of every fs request. Accounts
+ * reads issued by groups with a latency target and, once per window,
+ * tightens or relaxes the limit on the groups without one.
+ */
+void blk_throtl_rq_done(struct request_queue *q, struct request *rq)
+{
+	struct throtl_data *td = q->td;
+	unsigned int bg_iops;
+	u64 avg_ns;
+
+	if (!td->lat_target)
+		return;
+
+	if (rq->cmd_flags & REQ_LAT_TARGET) {
+		u64 now = sched_clock();
+
+		if (now > rq->start_time_ns) {
+			td->lat_sum_ns += now - rq->start_time_ns;
+			td->lat_nr++;
+		}
+	}
+
+	if (time_before(jiffies, td->lat_window_end))
+		return;
+
+	bg_iops = td->bg_iops;
+	if (td->lat_nr) {
+		avg_ns = td->lat_sum_ns;
+		do_div(avg_ns, td->lat_nr);
+	} else
+		avg_ns = 0;
+
+	if (avg_ns > (u64)td->lat_target * NSEC_PER_USEC) {
+		/* target missed, squeeze the background harder */
+		if (!bg_iops)
+			bg_iops = throtl_bg_iops_start;
+		else
+			bg_iops = max(bg_iops / 2, throtl_bg_iops_min);
+	} else if (bg_iops) {
+		/* target met or no foreground reads, give some back */
+		bg_iops *= 2;
+		if (bg_iops > throtl_bg_iops_max)
+			bg_iops = 0;
+	}
+
+	td->lat_window_end = jiffies + throtl_lat_window;
+	td->lat_sum_ns = 0;
+	td->lat_nr = 0;
+
+	if (bg_iops != td->bg_iops) {
+		td->bg_iops = bg_iops;
+		throtl_lat_update_bg(td);
+	}
+}
+
 int blk_throtl_init(struct request_queue *q)
 {
 	struct throtl_data *td;
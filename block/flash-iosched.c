@@ -0,0 +1,583 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  A deadline variant for eMMC and NAND backed queues. Seeks are free on
+ *  flash, so the scheduler never idles and never waits for a better
+ *  request; what matters is which request goes next. Sync requests from
+ *  foreground tasks are served first, sync requests from background tasks
+ *  next, and async writes are pushed out in sector sorted batches whenever
+ *  they expire or have been starved for too long.
+ *
+ *  Based on the deadline scheduler, Copyright (C) 2002 Jens Axboe.
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+#include <linux/ktime.h>
+#include <linux/ioprio.h>
+#include <linux/iocontext.h>
+#include <linux/cgroup.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+static const int fg_expire = HZ / 8;	/* max time before a foreground sync rq is served */
+static const int bg_expire = HZ / 2;	/* ditto for background tasks */
+static const int async_expire = 5 * HZ;	/* ditto for async writes, these limits are SOFT! */
+static const int async_starved = 4;	/* max times sync rqs can starve async writes */
+static const int async_batch = 16;	/* # of async writes dispatched back to back */
+
+/* request classes, in order of preference */
+enum {
+	FLASH_SYNC_FG,
+	FLASH_SYNC_BG,
+	FLASH_ASYNC,
+	FLASH_NR_CLASSES,
+};
+
+static const char *flash_class_name[FLASH_NR_CLASSES] = {
+	"sync_fg", "sync_bg", "async",
+};
+
+/*
+ * The scheduler keeps the class and the insert and dispatch times (in
+ * microseconds, wrapping) of a request in its elevator private pointers.
+ */
+#define RQ_CLASS(rq)		((unsigned long) (rq)->elevator_private[0])
+#define RQ_ADD_TIME(rq)		((unsigned long) (rq)->elevator_private[1])
+#define RQ_DISPATCH_TIME(rq)	((unsigned long) (rq)->elevator_private[2])
+
+struct flash_lat_stats {
+	unsigned long nr;		/* completed requests */
+	u64 wait_us;			/* total time spent in the scheduler */
+	u64 total_us;			/* total time from insert to completion */
+	unsigned long max_us;		/* worst insert to completion time */
+};
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * requests are present on both sort_list and fifo_list
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[FLASH_NR_CLASSES];
+
+	/*
+	 * next async write in sort order, when running an async batch
+	 */
+	struct request *next_rq;
+	unsigned int batching;		/* number of async writes in this batch */
+	unsigned int starved;		/* times sync rqs have starved async writes */
+
+	struct flash_lat_stats stats[FLASH_NR_CLASSES];
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[FLASH_NR_CLASSES];
+	int async_batch;
+	int async_starved;
+	int front_merges;
+};
+
+static inline unsigned long flash_now_us(void)
+{
+	return (unsigned long) ktime_to_us(ktime_get());
+}
+
+/*
+ * Android moves background applications out of the root cpu cgroup, so use
+ * that to tell foreground from background. Tasks in the idle io priority
+ * class are always treated as background.
+ */
+static int flash_task_is_background(struct task_struct *tsk)
+{
+	struct io_context *ioc = tsk->io_context;
+	int bg = 0;
+
+	if (ioc && IOPRIO_PRIO_CLASS(ioc->ioprio) == IOPRIO_CLASS_IDLE)
+		return 1;
+
+#ifdef CONFIG_CGROUP_SCHED
+	rcu_read_lock();
+	bg = task_subsys_state(tsk, cpu_cgroup_subsys_id)->cgroup->parent != NULL;
+	rcu_read_unlock();
+#else
+	bg = task_nice(tsk) > 0;
+#endif
+	return bg;
+}
+
+static int flash_rq_class(struct request *rq)
+{
+	if (!rq_is_sync(rq))
+		return FLASH_ASYNC;
+
+	return flash_task_is_background(current) ? FLASH_SYNC_BG :
+						   FLASH_SYNC_FG;
+}
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[rq_data_dir(rq)];
+}
+
+/*
+ * get the request after `rq' in sector-sorted order
+ */
+static inline struct request *
+flash_latter_request(struct request *rq)
+{
+	struct rb_node *node = rb_next(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+static void flash_move_request(struct flash_data *, struct request *);
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = flash_rb_root(fd, rq);
+	struct request *__alias;
+
+	while (unlikely(__alias = elv_rb_add(root, rq)))
+		flash_move_request(fd, __alias);
+}
+
+static inline void
+flash_del_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	if (fd->next_rq == rq)
+		fd->next_rq = NULL;
+
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+/*
+ * add rq to rbtree and the fifo of its class
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int class = flash_rq_class(rq);
+
+	rq->elevator_private[0] = (void *) (unsigned long) class;
+	rq->elevator_private[1] = (void *) flash_now_us();
+
+	flash_add_rq_rb(fd, rq);
+
+	rq_set_fifo_time(rq, jiffies + fd->fifo_expire[class]);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[class]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	flash_del_rq_rb(fd, rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (fd->front_merges) {
+		sector_t sector = bio->bi_sector + bio_sectors(bio);
+
+		__rq = elv_rb_find(&fd->sort_list[bio_data_dir(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != blk_rq_pos(__rq));
+
+			if (elv_rq_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(flash_rb_root(fd, req), req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo.
+	 * A sync request absorbing an async one keeps its own class.
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist) &&
+	    RQ_CLASS(req) == RQ_CLASS(next)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+static int flash_allow_merge(struct request_queue *q, struct request *rq,
+			     struct bio *bio)
+{
+	/*
+	 * Don't let a sync bio ride on a queued async write, it would then
+	 * wait for the async write batch instead of being served first.
+	 */
+	if (bio_data_dir(bio) == WRITE && (bio->bi_rw & REQ_SYNC) &&
+	    RQ_CLASS(rq) == FLASH_ASYNC)
+		return 0;
+
+	return 1;
+}
+
+/*
+ * move an entry to dispatch queue
+ */
+static void
+flash_move_request(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	if (RQ_CLASS(rq) == FLASH_ASYNC) {
+		struct request *next = flash_latter_request(rq);
+
+		fd->next_rq = (next && RQ_CLASS(next) == FLASH_ASYNC) ?
+			next : NULL;
+	}
+
+	rq->elevator_private[2] = (void *) flash_now_us();
+
+	/*
+	 * take it off the sort and fifo list, move
+	 * to dispatch queue
+	 */
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * flash_check_fifo returns 1 if the oldest request of class has expired.
+ * Requires !list_empty(&fd->fifo_list[class])
+ */
+static inline int flash_check_fifo(struct flash_data *fd, int class)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[class].next);
+
+	return time_after(jiffies, rq_fifo_time(rq));
+}
+
+/*
+ * flash_dispatch_requests picks the next request: a running async batch
+ * first, then expired or starved async writes, then foreground sync,
+ * background sync and finally async writes. It never holds the queue idle.
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int fg = !list_empty(&fd->fifo_list[FLASH_SYNC_FG]);
+	const int bg = !list_empty(&fd->fifo_list[FLASH_SYNC_BG]);
+	const int async = !list_empty(&fd->fifo_list[FLASH_ASYNC]);
+	struct request *rq;
+	int class;
+
+	/*
+	 * keep streaming a sector sorted async batch, unless sync work
+	 * showed up and the batch is already a useful size
+	 */
+	if (fd->next_rq && fd->batching < fd->async_batch &&
+	    (!(fg || bg) || fd->batching < fd->async_batch / 2)) {
+		rq = fd->next_rq;
+		goto dispatch_async;
+	}
+
+	if (async && (flash_check_fifo(fd, FLASH_ASYNC) ||
+		      ((fg || bg) && fd->starved >= fd->async_starved)))
+		goto start_async;
+
+	if (fg) {
+		/*
+		 * background sync rqs get their turn once they expire, so
+		 * a busy foreground task cannot starve them forever
+		 */
+		if (bg && flash_check_fifo(fd, FLASH_SYNC_BG))
+			class = FLASH_SYNC_BG;
+		else
+			class = FLASH_SYNC_FG;
+		goto dispatch_sync;
+	}
+
+	if (bg) {
+		class = FLASH_SYNC_BG;
+		goto dispatch_sync;
+	}
+
+	if (async)
+		goto start_async;
+
+	return 0;
+
+dispatch_sync:
+	if (async)
+		fd->starved++;
+	fd->next_rq = NULL;
+	fd->batching = 0;
+	flash_move_request(fd, rq_entry_fifo(fd->fifo_list[class].next));
+	return 1;
+
+start_async:
+	/*
+	 * start the batch at the oldest async write and continue from
+	 * there in sector order
+	 */
+	rq = rq_entry_fifo(fd->fifo_list[FLASH_ASYNC].next);
+	fd->starved = 0;
+	fd->batching = 0;
+
+dispatch_async:
+	fd->batching++;
+	flash_move_request(fd, rq);
+	return 1;
+}
+
+static void flash_completed_request(struct request_queue *q,
+				    struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct flash_lat_stats *st = &fd->stats[RQ_CLASS(rq)];
+	unsigned long now = flash_now_us();
+	unsigned long total = now - RQ_ADD_TIME(rq);
+
+	st->nr++;
+	st->wait_us += RQ_DISPATCH_TIME(rq) - RQ_ADD_TIME(rq);
+	st->total_us += total;
+	if (total > st->max_us)
+		st->max_us = total;
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+	int i;
+
+	for (i = 0; i < FLASH_NR_CLASSES; i++)
+		BUG_ON(!list_empty(&fd->fifo_list[i]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+	int i;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	for (i = 0; i < FLASH_NR_CLASSES; i++)
+		INIT_LIST_HEAD(&fd->fifo_list[i]);
+	fd->sort_list[READ] = RB_ROOT;
+	fd->sort_list[WRITE] = RB_ROOT;
+	fd->fifo_expire[FLASH_SYNC_FG] = fg_expire;
+	fd->fifo_expire[FLASH_SYNC_BG] = bg_expire;
+	fd->fifo_expire[FLASH_ASYNC] = async_expire;
+	fd->async_starved = async_starved;
+	fd->async_batch = async_batch;
+	fd->front_merges = 1;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_fg_expire_show, fd->fifo_expire[FLASH_SYNC_FG], 1);
+SHOW_FUNCTION(flash_bg_expire_show, fd->fifo_expire[FLASH_SYNC_BG], 1);
+SHOW_FUNCTION(flash_async_expire_show, fd->fifo_expire[FLASH_ASYNC], 1);
+SHOW_FUNCTION(flash_async_starved_show, fd->async_starved, 0);
+SHOW_FUNCTION(flash_async_batch_show, fd->async_batch, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_fg_expire_store, &fd->fifo_expire[FLASH_SYNC_FG], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_bg_expire_store, &fd->fifo_expire[FLASH_SYNC_BG], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_expire_store, &fd->fifo_expire[FLASH_ASYNC], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_starved_store, &fd->async_starved, 1, INT_MAX, 0);
+STORE_FUNCTION(flash_async_batch_store, &fd->async_batch, 1, INT_MAX, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+#undef STORE_FUNCTION
+
+/*
+ * per class latency stats: completed requests, average time queued in the
+ * scheduler, average and worst time from insert to completion, in usecs
+ */
+static ssize_t flash_latency_stats_show(struct elevator_queue *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < FLASH_NR_CLASSES; i++) {
+		struct flash_lat_stats st = fd->stats[i];
+		u64 wait = st.wait_us, total = st.total_us;
+
+		if (st.nr) {
+			do_div(wait, st.nr);
+			do_div(total, st.nr);
+		}
+		len += sprintf(page + len, "%s %lu %llu %llu %lu\n",
+			       flash_class_name[i], st.nr,
+			       (unsigned long long) wait,
+			       (unsigned long long) total, st.max_us);
+	}
+	return len;
+}
+
+static ssize_t flash_latency_stats_store(struct elevator_queue *e,
+					 const char *page, size_t count)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	memset(fd->stats, 0, sizeof(fd->stats));
+	return count;
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(fg_expire),
+	FD_ATTR(bg_expire),
+	FD_ATTR(async_expire),
+	FD_ATTR(async_starved),
+	FD_ATTR(async_batch),
+	FD_ATTR(front_merges),
+	FD_ATTR(latency_stats),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_completed_req_fn =	flash_completed_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -40,8 +40,8 @@ struct hash_testvec {
 	char *key;
 	char *plaintext;
 	char *digest;
-	unsigned char tap[MAX_TAP];
-	unsigned char psize;
+	unsigned short tap[MAX_TAP];
+	unsigned short psize;
 	unsigned char np;
 	unsigned char ksize;
 };
@@ -1040,7 +1040,7 @@ static struct hash_testvec tgr128_tv_template[] = {
 	},
 };
 
-#define GHASH_TEST_VECTORS 1
+#define GHASH_TEST_VECTORS 2
 
 static struct hash_testvec ghash_tv_template[] =
 {
@@ -1052,6 +1052,16 @@ static struct hash_testvec ghash_tv_template[] =
 		.psize	= 16,
 		.digest	= "\xda\x53\xeb\x0a\xd2\xc5\x5b\xb6"
 			  "\x4f\xc4\x80\x2c\xc3\xfe\xda\x60",
+	}, {
+		.key	= "\x66\xe9\x4b\xd4\xef\x8a\x2c\x3b\x88\x4c\xfa\x59\xca\x34\x2b\x2e",
+		.ksize	= 16,
+		.plaintext = "The quick brown fox jumps over the lazy dog, "
+			     "then naps in the sun.",
+		.psize	= 66,
+		.digest	= "\x8e\x17\x6d\x4f\x46\x40\x14\x81"
+			  "\x7f\x6b\x29\x8e\xe0\x3f\x7d\x60",
+		.np	= 2,
+		.tap	= { 28, 38 },
 	},
 };
 
@@ -9883,7 +9893,7 @@ static struct hash_testvec michael_mic_tv_template[] = {
 /*
  * CRC32C test vectors
  */
-#define CRC32C_TEST_VECTORS 14
+#define CRC32C_TEST_VECTORS 16
 
 static struct hash_testvec crc32c_tv_template[] = {
 	{
@@ -10055,6 +10065,101 @@ static struct hash_testvec crc32c_tv_template[] = {
 		.np = 2,
 		.tap = { 31, 209 }
 	},
+	{
+		/*
+		 * Long enough for the NEON folding of crc32c-neon, and not
+		 * a multiple of its 16 byte blocks.
+		 */
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x71\x47\x1d\x94\xec\x89\x93\xc7"
+			     "\x44\xbc\xd8\xcf\xcb\x3c\xc5\xa6"
+			     "\x68\x19\xa8\xe6\xca\xa4\xe2\x3b"
+			     "\x69\xbd\x41\x89\x41\xda\x1e\xdc"
+			     "\x4e\xd8\x36\x13\xc6\x82\x49\x4c"
+			     "\x19\xe2\x74\x0e\xa9\x4a\x4f\x39"
+			     "\x49\x20\xc6\xae\x77\x6d\xb8\xbe"
+			     "\x59\x25\x51\x54\x7a\x34\x28\xe1"
+			     "\x41\x4d\x18\x0a\x35\x71\xde\x14"
+			     "\xf2\x41\x77\x0b\xea\x05\x37\xb5"
+			     "\xdd\x78\xa9\x3a\x16\x59\x2a\x90"
+			     "\x6b\xb2\x44\xa8\xf2\xe6\xcb\x5a"
+			     "\x83\x7e\xba\x11\xf2\xb0\xcb\x36"
+			     "\x09\xb3\xd8\x5e\x48\xc5\xf4\x32"
+			     "\x5c\xf8\x48\x22\x5f\xc0\xaf\xc9"
+			     "\xd5\x3e\x11\x1e\x62\x4a\x80\x60"
+			     "\x4d\x43\x14\xc0\xb5\x96\x87\xcb"
+			     "\x95\x0f\x8f\x9e\x79\xe2\xff\xc8"
+			     "\xfd\x78\x9c\xfd\x0a\xfb\xc0\x80"
+			     "\xd0\xa0\xb1\x4e\x83\xb7\xbe\x0b"
+			     "\xd5\x74\x1f\xae\x36\x7b\x8a\xeb"
+			     "\xce\x2d\x95\x63\x36\xb5\xcf\x8e"
+			     "\xfa\xd1\x9c\x64\xcf\x60\xd4\xce"
+			     "\x95\xb0\x1b\xd0\x0b\x85\xfe\x73"
+			     "\x54\xe9\xd2\x73\x2d\xb7\x4d\xad"
+			     "\xeb\xe5\xe1\x47\x37\x94\xdc\x9d"
+			     "\x8a\xd9\x41\xef\x66\x49\x64\xcb"
+			     "\x5a\x47\x47\x3b\xb3\x0d\xb7\xaf"
+			     "\x02\x7b\x26\xa9\x52\xa2\x47\x2b"
+			     "\x26\x10\x6c\xe0\x35\xd9\x9f\x0c"
+			     "\xe4\x6a\x82\x35\x87\x0d\xe7\x8f"
+			     "\x58\x3b\x2e\x28\x33\xa5\x62\xd8"
+			     "\x17\x01\x12\xe6\x5d\x95\xf1\x7a"
+			     "\xb6\x84\x2d\xc7\xe6\xdc\x8f\xf5"
+			     "\x42\x5b\x57\xcf\xea\x04\xd5\x31"
+			     "\xc7\x66\xc7\x2f\x43\xa7\x76\x06"
+			     "\xcb\x53\x8f\xc3\x06\xe7\xc2\xb5"
+			     "\xd2\x1b\x1c\x94",
+		.psize = 300,
+		.digest = "\x36\xe9\x2a\x68",
+	},
+	{
+		/* the same, with a first update that also ends mid block */
+		.key = "\xff\xff\xff\xff",
+		.ksize = 4,
+		.plaintext = "\x71\x47\x1d\x94\xec\x89\x93\xc7"
+			     "\x44\xbc\xd8\xcf\xcb\x3c\xc5\xa6"
+			     "\x68\x19\xa8\xe6\xca\xa4\xe2\x3b"
+			     "\x69\xbd\x41\x89\x41\xda\x1e\xdc"
+			     "\x4e\xd8\x36\x13\xc6\x82\x49\x4c"
+			     "\x19\xe2\x74\x0e\xa9\x4a\x4f\x39"
+			     "\x49\x20\xc6\xae\x77\x6d\xb8\xbe"
+			     "\x59\x25\x51\x54\x7a\x34\x28\xe1"
+			     "\x41\x4d\x18\x0a\x35\x71\xde\x14"
+			     "\xf2\x41\x77\x0b\xea\x05\x37\xb5"
+			     "\xdd\x78\xa9\x3a\x16\x59\x2a\x90"
+			     "\x6b\xb2\x44\xa8\xf2\xe6\xcb\x5a"
+			     "\x83\x7e\xba\x11\xf2\xb0\xcb\x36"
+			     "\x09\xb3\xd8\x5e\x48\xc5\xf4\x32"
+			     "\x5c\xf8\x48\x22\x5f\xc0\xaf\xc9"
+			     "\xd5\x3e\x11\x1e\x62\x4a\x80\x60"
+			     "\x4d\x43\x14\xc0\xb5\x96\x87\xcb"
+			     "\x95\x0f\x8f\x9e\x79\xe2\xff\xc8"
+			     "\xfd\x78\x9c\xfd\x0a\xfb\xc0\x80"
+			     "\xd0\xa0\xb1\x4e\x83\xb7\xbe\x0b"
+			     "\xd5\x74\x1f\xae\x36\x7b\x8a\xeb"
+			     "\xce\x2d\x95\x63\x36\xb5\xcf\x8e"
+			     "\xfa\xd1\x9c\x64\xcf\x60\xd4\xce"
+			     "\x95\xb0\x1b\xd0\x0b\x85\xfe\x73"
+			     "\x54\xe9\xd2\x73\x2d\xb7\x4d\xad"
+			     "\xeb\xe5\xe1\x47\x37\x94\xdc\x9d"
+			     "\x8a\xd9\x41\xef\x66\x49\x64\xcb"
+			     "\x5a\x47\x47\x3b\xb3\x0d\xb7\xaf"
+			     "\x02\x7b\x26\xa9\x52\xa2\x47\x2b"
+			     "\x26\x10\x6c\xe0\x35\xd9\x9f\x0c"
+			     "\xe4\x6a\x82\x35\x87\x0d\xe7\x8f"
+			     "\x58\x3b\x2e\x28\x33\xa5\x62\xd8"
+			     "\x17\x01\x12\xe6\x5d\x95\xf1\x7a"
+			     "\xb6\x84\x2d\xc7\xe6\xdc\x8f\xf5"
+			     "\x42\x5b\x57\xcf\xea\x04\xd5\x31"
+			     "\xc7\x66\xc7\x2f\x43\xa7\x76\x06"
+			     "\xcb\x53\x8f\xc3\x06\xe7\xc2\xb5"
+			     "\xd2\x1b\x1c\x94",
+		.psize = 300,
+		.digest = "\x36\xe9\x2a\x68",
+		.np = 2,
+		.tap = { 271, 29 }
+	},
 };
 
 #endif	/* _CRYPTO_TESTMGR_H */
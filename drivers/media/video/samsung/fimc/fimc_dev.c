@@ -606,7 +606,7 @@ int fimc_mmap_out_src(struct file *filp, struct vm_area_struct *vma)
 	start_phy_addr = ctx->src[idx].base[FIMC_ADDR_Y];
 	pfn = __phys_to_pfn(start_phy_addr);
 
-	if (remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot)) {
+	if (io_remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot)) {
 		fimc_err("mmap fail\n");
 		return -EINVAL;
 	}
@@ -634,7 +634,7 @@ int fimc_mmap_out_dst(struct file *filp, struct vm_area_struct *vma, u32 idx)
 	vma->vm_flags |= VM_RESERVED;
 
 	pfn = __phys_to_pfn(ctrl->out->ctx[ctx_id].dst[idx].base[0]);
-	ret = remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot);
+	ret = io_remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot);
 	if (ret != 0)
 		fimc_err("remap_pfn_range fail.\n");
 
@@ -680,7 +680,7 @@ static inline int fimc_mmap_cap(struct file *filp, struct vm_area_struct *vma)
 		return -EINVAL;
 	}
 
-	if (remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot)) {
+	if (io_remap_pfn_range(vma, vma->vm_start, pfn, size, vma->vm_page_prot)) {
 		fimc_err("%s: mmap fail\n", __func__);
 		return -EINVAL;
 	}
@@ -728,7 +728,7 @@ static int sec_g2d_mmap(struct file *filp, struct vm_area_struct *vma)
 
 	pageFrameNo = __phys_to_pfn(g_g2d_src_phys_addr);
 
-	if (remap_pfn_range(vma, vma->vm_start, pageFrameNo,
+	if (io_remap_pfn_range(vma, vma->vm_start, pageFrameNo,
 				g_g2d_reserved_size, vma->vm_page_prot)) {
 		pr_err("g2d:remap_pfn_range fail\n");
 		return -EINVAL;
@@ -891,6 +891,7 @@ static const struct file_operations sec_g2d_fops = {
 	.open		= sec_g2d_open,
 	.release	= sec_g2d_release,
 	.mmap		= sec_g2d_mmap,
+	.get_unmapped_area	= arm_large_get_unmapped_area,
 	.unlocked_ioctl		= sec_g2d_ioctl,
 	.poll		= sec_g2d_poll,
 };
@@ -358,7 +358,7 @@ int s3c_jpeg_mmap(struct file *filp, struct vm_area_struct *vma)
 	vma->vm_flags |= VM_RESERVED | VM_IO;
 	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 
-	if (remap_pfn_range(vma, vma->vm_start, page_frame_no, size,
+	if (io_remap_pfn_range(vma, vma->vm_start, page_frame_no, size,
 			    vma->vm_page_prot)) {
 		jpg_err("jpeg remap error");
 		return -EAGAIN;
@@ -376,6 +376,7 @@ static const struct file_operations jpeg_fops = {
 	.read =		s3c_jpeg_read,
 	.write =	s3c_jpeg_write,
 	.mmap =		s3c_jpeg_mmap,
+	.get_unmapped_area = arm_large_get_unmapped_area,
 	.poll =		s3c_jpeg_poll,
 };
 
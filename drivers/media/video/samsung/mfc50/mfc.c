@@ -470,7 +470,7 @@ static int mfc_mmap(struct file *filp, struct vm_area_struct *vma)
 	 * port0 mapping for stream buf & frame buf (chroma + MV)
 	 */
 	page_frame_no = __phys_to_pfn(mfc_get_port0_buff_paddr());
-	if (remap_pfn_range(vma, vma->vm_start, page_frame_no,
+	if (io_remap_pfn_range(vma, vma->vm_start, page_frame_no,
 		mfc_ctx->port0_mmap_size, vma->vm_page_prot)) {
 		mfc_err("mfc remap port0 error\n");
 		return -EAGAIN;
@@ -483,7 +483,7 @@ static int mfc_mmap(struct file *filp, struct vm_area_struct *vma)
 	 * port1 mapping for frame buf (luma)
 	 */
 	page_frame_no = __phys_to_pfn(mfc_get_port1_buff_paddr());
-	if (remap_pfn_range(vma, vma->vm_start + mfc_ctx->port0_mmap_size,
+	if (io_remap_pfn_range(vma, vma->vm_start + mfc_ctx->port0_mmap_size,
 		page_frame_no, vir_size - mfc_ctx->port0_mmap_size, vma->vm_page_prot)) {
 		mfc_err("mfc remap port1 error\n");
 		return -EAGAIN;
@@ -499,7 +499,8 @@ static const struct file_operations mfc_fops = {
 	.open       = mfc_open,
 	.release    = mfc_release,
 	.unlocked_ioctl = mfc_ioctl,
-	.mmap       = mfc_mmap
+	.mmap       = mfc_mmap,
+	.get_unmapped_area = arm_large_get_unmapped_area,
 };
 
 
@@ -23,6 +23,9 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/io.h>
+#include <linux/interrupt.h>
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/nand.h>
@@ -31,6 +34,10 @@
 
 #include <plat/nand.h>
 
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+#include <mach/dma.h>
+#endif
+
 #include "../mtdcore.h"
 #include "s3c_nand.h"
 
@@ -64,6 +71,19 @@ struct s3c_nand_info {
 	int						mtd_count;
 
 	enum s3c_cpu_type		cpu_type;
+
+	/* ECC completion interrupt, or -1 when polling */
+	int						irq;
+	struct completion		ecc_done;
+
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+	/* page data transfer through the PDMA */
+	dma_addr_t				data_phys;
+	int						dma_claimed;
+	int						dma_ok;
+	enum s3c2410_dma_buffresult	dma_res;
+	struct completion		dma_done;
+#endif
 };
 static struct s3c_nand_info s3c_nand;
 
@@ -79,6 +99,17 @@ static struct mtd_info *s3c_mtd;
 #define S3C_NAND_WAIT_TIME_MS	(80)
 #define S3C_NAND_WAIT_INTERVAL	(S3C_NAND_WAIT_TIME_MS * HZ / 1000)
 
+/* Samsung 3rd ID byte: the chip supports cache program */
+#define S3C_NAND_CI_CACHEPRG	0x80
+
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+/* memory to memory channel used for NFDATA <-> page buffer copies */
+#define S3C_NAND_DMA_CH		DMACH_MTOM_0
+
+/* shorter transfers (spare area, ecc bytes) are not worth a DMA setup */
+#define S3C_NAND_DMA_MIN	512
+#endif
+
 /* Nand flash global values */
 int cur_ecc_mode;
 int nand_type = S3C_NAND_TYPE_UNKNOWN;
@@ -218,6 +249,203 @@ static int s3c_nand_device_ready(struct mtd_info *mtd)
 	return readl(regs + S3C_NFSTAT) & S3C_NFSTAT_READY;
 }
 
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+static struct s3c2410_dma_client s3c_nand_dma_client = {
+	.name = "s3c-nand-dma",
+};
+
+static void s3c_nand_dma_done(struct s3c2410_dma_chan *chan, void *buf_id,
+			int size, enum s3c2410_dma_buffresult res)
+{
+	s3c_nand.dma_res = res;
+	complete(&s3c_nand.dma_done);
+}
+
+/*
+ * Only lowmem buffers can be mapped for DMA; vmalloc'ed buffers handed
+ * down by UBI or jffs2 and the short spare area transfers go through PIO.
+ */
+static int s3c_nand_can_dma(const void *buf, int len)
+{
+	if (!s3c_nand.dma_ok || len < S3C_NAND_DMA_MIN)
+		return 0;
+
+	if ((len & 3) || ((unsigned long)buf & 3))
+		return 0;
+
+	return virt_addr_valid(buf) && virt_addr_valid(buf + len - 1);
+}
+
+/*
+ * Move len bytes between the NFDATA register and buf with the PDMA and
+ * sleep until the transfer completes. The ECC engine sees the data on
+ * the bus exactly as it would with PIO.
+ */
+static int s3c_nand_dma_xfer(void *buf, int len, enum dma_data_direction dir)
+{
+	enum s3c2410_dmasrc src;
+	dma_addr_t addr;
+	int ret;
+
+	if (dir == DMA_FROM_DEVICE)
+		src = S3C_DMA_MEM2MEM_SET;	/* fixed source: NFDATA */
+	else
+		src = S3C_DMA_MEM2MEM_FIFO;	/* fixed destination: NFDATA */
+
+	addr = dma_map_single(s3c_nand.device, buf, len, dir);
+
+	s3c2410_dma_devconfig(S3C_NAND_DMA_CH, src, s3c_nand.data_phys);
+	INIT_COMPLETION(s3c_nand.dma_done);
+
+	ret = s3c2410_dma_enqueue(S3C_NAND_DMA_CH, &s3c_nand, addr, len);
+	if (ret)
+		goto out;
+
+	s3c2410_dma_ctrl(S3C_NAND_DMA_CH, S3C2410_DMAOP_START);
+
+	if (!wait_for_completion_timeout(&s3c_nand.dma_done,
+					S3C_NAND_WAIT_INTERVAL)) {
+		s3c2410_dma_ctrl(S3C_NAND_DMA_CH, S3C2410_DMAOP_FLUSH);
+		ret = -ETIMEDOUT;
+	} else if (s3c_nand.dma_res != S3C2410_RES_OK) {
+		ret = -EIO;
+	}
+
+out:
+	dma_unmap_single(s3c_nand.device, addr, len, dir);
+
+	/*
+	 * The caller redoes the transfer with PIO. Should part of the page
+	 * have gone through already, the ECC check or the program status
+	 * reports the page as bad rather than it being silently corrupted.
+	 */
+	if (ret) {
+		printk(KERN_ERR "s3c-nand: DMA %s of %d bytes failed (%d), "
+			"using PIO\n",
+			dir == DMA_FROM_DEVICE ? "read" : "write", len, ret);
+		s3c_nand.dma_ok = 0;
+	}
+	return ret;
+}
+
+static void s3c_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+{
+	struct nand_chip *chip = mtd->priv;
+	int i;
+
+	if (s3c_nand_can_dma(buf, len) &&
+	    !s3c_nand_dma_xfer(buf, len, DMA_FROM_DEVICE))
+		return;
+
+	if (!((len | (unsigned long)buf) & 3)) {
+		readsl(chip->IO_ADDR_R, buf, len >> 2);
+		return;
+	}
+
+	for (i = 0; i < len; i++)
+		buf[i] = readb(chip->IO_ADDR_R);
+}
+
+static void s3c_nand_write_buf(struct mtd_info *mtd, const uint8_t *buf, int len)
+{
+	struct nand_chip *chip = mtd->priv;
+	int i;
+
+	if (s3c_nand_can_dma(buf, len) &&
+	    !s3c_nand_dma_xfer((void *)buf, len, DMA_TO_DEVICE))
+		return;
+
+	if (!((len | (unsigned long)buf) & 3)) {
+		writesl(chip->IO_ADDR_W, buf, len >> 2);
+		return;
+	}
+
+	for (i = 0; i < len; i++)
+		writeb(buf[i], chip->IO_ADDR_W);
+}
+
+/*
+ * Grab a memory to memory PDMA channel for the page data. Without one
+ * the driver keeps using PIO.
+ */
+static void s3c_nand_dma_init(struct resource *res)
+{
+	init_completion(&s3c_nand.dma_done);
+	s3c_nand.data_phys = res->start + S3C_NFDATA;
+
+	if (s3c2410_dma_request(S3C_NAND_DMA_CH, &s3c_nand_dma_client, NULL) < 0) {
+		dev_warn(s3c_nand.device, "no DMA channel, using PIO\n");
+		return;
+	}
+
+	s3c2410_dma_set_buffdone_fn(S3C_NAND_DMA_CH, s3c_nand_dma_done);
+	s3c2410_dma_config(S3C_NAND_DMA_CH, 4);
+	s3c_nand.dma_claimed = 1;
+	s3c_nand.dma_ok = 1;
+}
+#endif
+
+/* Give back the DMA channel and the ECC interrupt taken in probe */
+static void s3c_nand_release_irq_dma(void)
+{
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+	if (s3c_nand.dma_claimed) {
+		s3c2410_dma_free(S3C_NAND_DMA_CH, &s3c_nand_dma_client);
+		s3c_nand.dma_claimed = 0;
+		s3c_nand.dma_ok = 0;
+	}
+#endif
+	if (s3c_nand.irq >= 0) {
+		free_irq(s3c_nand.irq, &s3c_nand);
+		s3c_nand.irq = -1;
+	}
+}
+
+/*
+ * Program one page. Unlike nand_write_page() in nand_base.c, the cache
+ * program command is used for all but the last page of a sequential
+ * write if the chip supports it, so loading the next page overlaps with
+ * programming of the current one.
+ */
+static int s3c_nand_write_page(struct mtd_info *mtd, struct nand_chip *chip,
+			   const uint8_t *buf, int page, int cached, int raw)
+{
+	int status;
+
+	chip->cmdfunc(mtd, NAND_CMD_SEQIN, 0x00, page);
+
+	if (unlikely(raw))
+		chip->ecc.write_page_raw(mtd, chip, buf);
+	else
+		chip->ecc.write_page(mtd, chip, buf);
+
+	if (!cached || !(chip->options & NAND_CACHEPRG)) {
+		chip->cmdfunc(mtd, NAND_CMD_PAGEPROG, -1, -1);
+		status = chip->waitfunc(mtd, chip);
+	} else {
+		chip->cmdfunc(mtd, NAND_CMD_CACHEDPROG, -1, -1);
+		status = chip->waitfunc(mtd, chip);
+
+		/* I/O1 reports the page programmed before this one */
+		if (status & NAND_STATUS_FAIL_N1)
+			status |= NAND_STATUS_FAIL;
+	}
+
+	if (status & NAND_STATUS_FAIL)
+		return -EIO;
+
+#ifdef CONFIG_MTD_NAND_VERIFY_WRITE
+	if (!cached || !(chip->options & NAND_CACHEPRG)) {
+		/* Send command to read back the data */
+		chip->cmdfunc(mtd, NAND_CMD_READ0, 0, page);
+
+		if (chip->verify_buf(mtd, buf, mtd->writesize))
+			return -EIO;
+	}
+#endif
+	return 0;
+}
+
 /*
  * We don't use a bad block table
  */
@@ -228,6 +456,62 @@ static int s3c_nand_scan_bbt(struct mtd_info *mtdinfo)
 
 #if defined(CONFIG_MTD_NAND_S3C_HWECC)
 
+/*
+ * ECC encoding/decoding done interrupt
+ */
+static irqreturn_t s3c_nand_irq(int irq, void *dev_id)
+{
+	void __iomem *regs = s3c_nand.regs;
+	u_long nfstat;
+
+	nfstat = readl(regs + S3C_NFSTAT);
+	nfstat &= S3C_NFSTAT_ECCENCDONE | S3C_NFSTAT_ECCDECDONE;
+	if (!nfstat)
+		return IRQ_NONE;
+
+	writel(nfstat, regs + S3C_NFSTAT);
+	complete(&s3c_nand.ecc_done);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * Clear stale done flags and unmask the ECC interrupts before the ECC
+ * engine is started. Returns the NFCONT interrupt enable bits to set.
+ */
+static u_long s3c_nand_arm_ecc_irq(void)
+{
+	void __iomem *regs = s3c_nand.regs;
+
+	if (s3c_nand.irq < 0)
+		return 0;
+
+	writel(S3C_NFSTAT_ECCENCDONE | S3C_NFSTAT_ECCDECDONE, regs + S3C_NFSTAT);
+	INIT_COMPLETION(s3c_nand.ecc_done);
+
+	return S3C_NFCONT_ENCINT | S3C_NFCONT_DECINT;
+}
+
+/*
+ * Sleep until the ECC interrupt reports that the engine has finished.
+ * Returns 0 if the caller has to fall back to polling.
+ */
+static int s3c_nand_wait_ecc_irq(u_long done)
+{
+	void __iomem *regs = s3c_nand.regs;
+
+	if (s3c_nand.irq < 0)
+		return 0;
+
+	if (!(readl(regs + S3C_NFSTAT) & done) &&
+	    !wait_for_completion_timeout(&s3c_nand.ecc_done,
+					S3C_NAND_WAIT_INTERVAL))
+		printk(KERN_ERR "s3c-nand: ECC %s timeout\n",
+			done == S3C_NFSTAT_ECCENCDONE ? "encoding" : "decoding");
+
+	return 1;
+}
+
 /*
  * Function for checking ECCEncDone in NFSTAT
  */
@@ -236,6 +520,9 @@ static void s3c_nand_wait_enc(void)
 	void __iomem *regs = s3c_nand.regs;
 	unsigned long timeo = jiffies;
 
+	if (s3c_nand_wait_ecc_irq(S3C_NFSTAT_ECCENCDONE))
+		return;
+
 	timeo += S3C_NAND_WAIT_INTERVAL;
 
 	/* Apply this short delay always to ensure that we do wait tWB in
@@ -255,6 +542,9 @@ static void s3c_nand_wait_dec(void)
 	void __iomem *regs = s3c_nand.regs;
 	unsigned long timeo = jiffies;
 
+	if (s3c_nand_wait_ecc_irq(S3C_NFSTAT_ECCDECDONE))
+		return;
+
 	timeo += S3C_NAND_WAIT_INTERVAL;
 
 	/* Apply this short delay always to ensure that we do wait tWB in
@@ -320,6 +610,8 @@ static void s3c_nand_enable_hwecc(struct mtd_info *mtd, int mode)
 	nfcont &= ~S3C_NFCONT_MECCLOCK;
 
 	if (nand_type == S3C_NAND_TYPE_MLC) {
+		nfcont |= s3c_nand_arm_ecc_irq();
+
 		if (mode == NAND_ECC_WRITE)
 			nfcont |= S3C_NFCONT_ECC_ENC;
 		else if (mode == NAND_ECC_READ)
@@ -671,8 +963,8 @@ static void s3c_nand_wait_ecc_busy_8bit(void)
 	void __iomem *regs = s3c_nand.regs;
 	unsigned int timeout;
 
-	/* Wait max 100ms */
-	timeout = 1000;
+	/* Wait max 100ms, the error search usually takes a few us */
+	timeout = 100000;
 	while (readl(regs + S3C_NF8ECCERR0) & S3C_NFECCERR0_ECCBUSY) {
 		if (timeout == 0) {
 			printk(KERN_ERR "s3c_nand : wait_ecc_busy err.\n");
@@ -680,7 +972,7 @@ static void s3c_nand_wait_ecc_busy_8bit(void)
 		}
 
 		timeout--;
-		udelay(100);
+		udelay(1);
 	}
 }
 
@@ -703,6 +995,7 @@ void s3c_nand_enable_hwecc_8bit(struct mtd_info *mtd, int mode)
 	nfcont = readl(regs + S3C_NFCONT);
 	nfcont |= S3C_NFCONT_INITECC;
 	nfcont &= ~S3C_NFCONT_MECCLOCK;
+	nfcont |= s3c_nand_arm_ecc_irq();
 
 	if (mode == NAND_ECC_WRITE)
 		nfcont |= S3C_NFCONT_ECC_ENC;
@@ -940,6 +1233,8 @@ static int s3c_nand_probe(struct platform_device *pdev, enum s3c_cpu_type cpu_ty
     set = &plat_info->sets[0];
     partition_info = set->partitions;
 
+	s3c_nand.irq = -1;
+
 	/* get the clock source and enable it */
 	s3c_nand.clk = clk_get(&pdev->dev, "nand");
 	if (IS_ERR(s3c_nand.clk)) {
@@ -974,12 +1269,29 @@ static int s3c_nand_probe(struct platform_device *pdev, enum s3c_cpu_type cpu_ty
 		goto exit_error;
 	}
 
+	init_completion(&s3c_nand.ecc_done);
+
+#if defined(CONFIG_MTD_NAND_S3C_HWECC)
+	i = platform_get_irq(pdev, 0);
+	if (i >= 0) {
+		if (request_irq(i, s3c_nand_irq, 0, pdev->name, &s3c_nand))
+			dev_warn(&pdev->dev, "cannot get irq %d, polling ECC\n", i);
+		else
+			s3c_nand.irq = i;
+	}
+#endif
+
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+	s3c_nand_dma_init(res);
+#endif
+
 	/* allocate memory for MTD device structure and private data */
 	s3c_mtd = kmalloc(sizeof(struct mtd_info) + sizeof(struct nand_chip), GFP_KERNEL);
 
 	if (!s3c_mtd) {
 		printk(KERN_ERR "Unable to allocate NAND MTD dev structure.\n");
-		return -ENOMEM;
+		ret = -ENOMEM;
+		goto exit_error;
 	}
 
 	/* Get pointer to private data */
@@ -998,7 +1310,12 @@ static int s3c_nand_probe(struct platform_device *pdev, enum s3c_cpu_type cpu_ty
 		nand->cmd_ctrl		= s3c_nand_hwcontrol;
 		nand->dev_ready		= s3c_nand_device_ready;
 		nand->scan_bbt		= s3c_nand_scan_bbt;
+		nand->write_page	= s3c_nand_write_page;
 		nand->options		= 0;
+#if defined(CONFIG_MTD_NAND_S3C_DMA)
+		nand->read_buf		= s3c_nand_read_buf;
+		nand->write_buf		= s3c_nand_write_buf;
+#endif
 
 #if defined(CONFIG_MTD_NAND_S3C_HWECC)
 		nand->ecc.mode		= NAND_ECC_HW;
@@ -1024,6 +1341,7 @@ static int s3c_nand_probe(struct platform_device *pdev, enum s3c_cpu_type cpu_ty
 
 		if (!type) {
 			printk(KERN_ERR "Unknown NAND Device.\n");
+			ret = -ENXIO;
 			goto exit_error;
 		}
 
@@ -1098,7 +1416,18 @@ static int s3c_nand_probe(struct platform_device *pdev, enum s3c_cpu_type cpu_ty
 		nand->ecc.mode = NAND_ECC_SOFT;
 		printk(KERN_INFO "S3C NAND Driver is using software ECC.\n");
 #endif
-		if (nand_scan(s3c_mtd, 1)) {
+		if (nand_scan_ident(s3c_mtd, 1, NULL)) {
+			ret = -ENXIO;
+			goto exit_error;
+		}
+
+		/* nand_scan_ident() resets the chip options from the id table */
+		if (nand->cellinfo & S3C_NAND_CI_CACHEPRG) {
+			nand->options |= NAND_CACHEPRG;
+			printk(KERN_INFO "S3C NAND Driver is using cache program.\n");
+		}
+
+		if (nand_scan_tail(s3c_mtd)) {
 			ret = -ENXIO;
 			goto exit_error;
 		}
@@ -1123,7 +1452,9 @@ static int s3c_nand_probe(struct platform_device *pdev, enum s3c_cpu_type cpu_ty
 	return 0;
 
 exit_error:
+	s3c_nand_release_irq_dma();
 	kfree(s3c_mtd);
+	s3c_mtd = NULL;
 
 	return ret;
 }
@@ -1155,6 +1486,7 @@ static int s3c_nand_resume(struct platform_device *dev)
 /* device management functions */
 static int s3c_nand_remove(struct platform_device *dev)
 {
+	s3c_nand_release_irq_dma();
 	platform_set_drvdata(dev, NULL);
 
 	return 0;
@@ -30,6 +30,8 @@
 #include <linux/file.h>
 #include <linux/device.h>
 #include <linux/miscdevice.h>
+#include <linux/pagemap.h>
+#include <linux/scatterlist.h>
 
 #include <linux/usb.h>
 #include <linux/usb_usual.h>
@@ -51,9 +53,12 @@
 
 /* number of tx and rx requests to allocate */
 #define TX_REQ_MAX 4
-#define RX_REQ_MAX 2
+#define RX_REQ_MAX 4
 #define INTR_REQ_MAX 5
 
+/* page cache pages per zero-copy tx request */
+#define TX_SG_MAX 16
+
 /* ID for Microsoft MTP OS String */
 #define MTP_OS_STRING_ID   0xEE
 
@@ -88,6 +93,9 @@ struct mtp_dev {
 	struct list_head tx_idle;
 	struct list_head intr_idle;
 
+	/* page lists for zero-copy tx requests, see mtp_fill_sg() */
+	struct scatterlist tx_sg[TX_REQ_MAX][TX_SG_MAX];
+
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 	wait_queue_head_t intr_wq;
@@ -345,10 +353,24 @@ static struct usb_request
 	return req;
 }
 
+/* drop the page cache references held by a zero-copy tx request */
+static void mtp_release_sg(struct usb_request *req)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(req->sg, sg, req->num_sgs, i)
+		page_cache_release(sg_page(sg));
+	req->num_sgs = 0;
+}
+
 static void mtp_complete_in(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
 
+	if (req->num_sgs)
+		mtp_release_sg(req);
+
 	if (req->status != 0)
 		dev->state = STATE_ERROR;
 
@@ -434,6 +456,7 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 		if (!req)
 			goto fail;
 		req->complete = mtp_complete_in;
+		req->sg = dev->tx_sg[i];
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
 	for (i = 0; i < RX_REQ_MAX; i++) {
@@ -627,6 +650,58 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/*
+ * Point a tx request at the page cache pages backing count bytes of filp
+ * at offset, so the controller sends them directly instead of copying the
+ * data into req->buf first. The references taken here are dropped in
+ * mtp_complete_in(). Returns the number of bytes covered by the request.
+ */
+static int mtp_fill_sg(struct file *filp, struct usb_request *req,
+		loff_t offset, int64_t count)
+{
+	struct address_space *mapping = filp->f_mapping;
+	pgoff_t index = offset >> PAGE_CACHE_SHIFT;
+	pgoff_t last = (offset + count - 1) >> PAGE_CACHE_SHIFT;
+	unsigned int poff = offset & ~PAGE_CACHE_MASK;
+	struct page *page;
+	int n = 0, len = 0, seg;
+
+	sg_init_table(req->sg, TX_SG_MAX);
+
+	while (n < TX_SG_MAX && len < count) {
+		page = find_get_page(mapping, index);
+		if (!page) {
+			page_cache_sync_readahead(mapping, &filp->f_ra, filp,
+					index, last - index + 1);
+			page = find_get_page(mapping, index);
+		}
+		if (page && PageReadahead(page))
+			page_cache_async_readahead(mapping, &filp->f_ra, filp,
+					page, index, last - index + 1);
+		if (!page || !PageUptodate(page)) {
+			if (page)
+				page_cache_release(page);
+			page = read_mapping_page(mapping, index, filp);
+			if (IS_ERR(page)) {
+				req->num_sgs = n;
+				mtp_release_sg(req);
+				return PTR_ERR(page);
+			}
+		}
+		mark_page_accessed(page);
+
+		seg = min_t(int64_t, PAGE_CACHE_SIZE - poff, count - len);
+		sg_set_page(&req->sg[n++], page, seg, poff);
+		len += seg;
+		poff = 0;
+		index++;
+	}
+
+	sg_mark_end(&req->sg[n - 1]);
+	req->num_sgs = n;
+	return len;
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data) {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, send_file_work);
@@ -639,6 +714,7 @@ static void send_file_work(struct work_struct *data) {
 	int xfer, ret, hdr_size;
 	int r = 0;
 	int sendZLP = 0;
+	int zero_copy;
 
 	/* read our parameters */
 	smp_rmb();
@@ -662,6 +738,15 @@ static void send_file_work(struct work_struct *data) {
 		sendZLP = 1;
 	}
 
+	/* page cache pages can only be queued as they are if every request
+	 * but the last starts on a packet boundary of the file, which rules
+	 * out the variant with the prepended header.
+	 */
+	zero_copy = cdev->gadget->sg_supported && !hdr_size &&
+		(offset & (dev->ep_in->maxpacket - 1)) == 0 &&
+		filp->f_mapping->a_ops->readpage &&
+		offset + count <= i_size_read(filp->f_mapping->host);
+
 	while (count > 0 || sendZLP) {
 		/* so we exit after sending ZLP */
 		if (count == 0)
@@ -681,6 +766,17 @@ static void send_file_work(struct work_struct *data) {
 			break;
 		}
 
+		if (zero_copy && count > 0) {
+			ret = mtp_fill_sg(filp, req, offset, count);
+			if (ret < 0) {
+				r = ret;
+				break;
+			}
+			xfer = ret;
+			offset += xfer;
+			goto queue;
+		}
+
 		if (count > MTP_BULK_BUFFER_SIZE)
 			xfer = MTP_BULK_BUFFER_SIZE;
 		else
@@ -703,10 +799,13 @@ static void send_file_work(struct work_struct *data) {
 		xfer = ret + hdr_size;
 		hdr_size = 0;
 
+queue:
 		req->length = xfer;
 		ret = usb_ep_queue(dev->ep_in, req, GFP_KERNEL);
 		if (ret < 0) {
 			DBG(cdev, "send_file_work: xfer error %d\n", ret);
+			if (req->num_sgs)
+				mtp_release_sg(req);
 			dev->state = STATE_ERROR;
 			r = -EIO;
 			break;
@@ -732,11 +831,11 @@ static void receive_file_work(struct work_struct *data)
 {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, receive_file_work);
 	struct usb_composite_dev *cdev = dev->cdev;
-	struct usb_request *read_req = NULL, *write_req = NULL;
+	struct usb_request *req;
 	struct file *filp;
 	loff_t offset;
-	int64_t count;
-	int ret, cur_buf = 0;
+	int64_t count, unqueued;
+	int ret, head = 0, tail = 0, pending = 0, depth;
 	int r = 0;
 
 	/* read our parameters */
@@ -747,62 +846,80 @@ static void receive_file_work(struct work_struct *data)
 
 	DBG(cdev, "receive_file_work(%lld)\n", count);
 
-	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
+	/* Keep several reads in flight so the host is not stalled while we
+	 * write the previous buffer to the file. If xfer_file_length is
+	 * 0xFFFFFFFF we read until we get a short packet, so only one read
+	 * may be outstanding then.
+	 */
+	depth = (count == 0xFFFFFFFF) ? 1 : RX_REQ_MAX;
+	unqueued = count;
 
-			read_req->length = (count > MTP_BULK_BUFFER_SIZE
-					? MTP_BULK_BUFFER_SIZE : count);
+	while (count > 0) {
+		while (unqueued > 0 && pending < depth) {
+			/* queue a request */
+			req = dev->rx_req[head];
+			req->length = (unqueued > MTP_BULK_BUFFER_SIZE
+					? MTP_BULK_BUFFER_SIZE : unqueued);
+			req->status = -EINPROGRESS;
 			dev->rx_done = 0;
-			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
+			ret = usb_ep_queue(dev->ep_out, req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				dev->state = STATE_ERROR;
-				break;
+				goto out;
 			}
+			if (count != 0xFFFFFFFF)
+				unqueued -= req->length;
+			head = (head + 1) % RX_REQ_MAX;
+			pending++;
 		}
 
-		if (write_req) {
-			DBG(cdev, "rx %p %d\n", write_req, write_req->actual);
-			ret = vfs_write(filp, write_req->buf, write_req->actual,
-				&offset);
-			DBG(cdev, "vfs_write %d\n", ret);
-			if (ret != write_req->actual) {
-				r = -EIO;
-				dev->state = STATE_ERROR;
-				break;
-			}
-			write_req = NULL;
+		/* wait for the oldest read to complete */
+		req = dev->rx_req[tail];
+		ret = wait_event_interruptible(dev->read_wq,
+			req->status != -EINPROGRESS || dev->state != STATE_BUSY);
+		if (dev->state == STATE_CANCELED) {
+			r = -ECANCELED;
+			break;
+		}
+		if (dev->state != STATE_BUSY) {
+			r = -EIO;
+			break;
+		}
+		if (ret < 0) {
+			r = ret;
+			break;
+		}
+		tail = (tail + 1) % RX_REQ_MAX;
+		pending--;
+
+		if (count != 0xFFFFFFFF)
+			count -= req->actual;
+		if (req->actual < req->length) {
+			/* short packet is used to signal EOF for sizes > 4 gig */
+			DBG(cdev, "got short packet\n");
+			count = 0;
 		}
 
-		if (read_req) {
-			/* wait for our last read to complete */
-			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
-			if (dev->state == STATE_CANCELED) {
-				r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			/* if xfer_file_length is 0xFFFFFFFF, then we read until
-			 * we get a zero length packet
-			 */
-			if (count != 0xFFFFFFFF)
-				count -= read_req->actual;
-			if (read_req->actual < read_req->length) {
-				/* short packet is used to signal EOF for sizes > 4 gig */
-				DBG(cdev, "got short packet\n");
-				count = 0;
-			}
-
-			write_req = read_req;
-			read_req = NULL;
+		DBG(cdev, "rx %p %d\n", req, req->actual);
+		ret = vfs_write(filp, req->buf, req->actual, &offset);
+		DBG(cdev, "vfs_write %d\n", ret);
+		if (ret != req->actual) {
+			r = -EIO;
+			dev->state = STATE_ERROR;
+			break;
 		}
 	}
 
+out:
+	/* reclaim reads still queued after an error or an early short packet */
+	while (pending-- > 0) {
+		req = dev->rx_req[tail];
+		if (req->status == -EINPROGRESS)
+			usb_ep_dequeue(dev->ep_out, req);
+		tail = (tail + 1) % RX_REQ_MAX;
+	}
+
 	DBG(cdev, "receive_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
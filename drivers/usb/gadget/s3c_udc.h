@@ -39,6 +39,7 @@
 #include <linux/mm.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
 
 #include <asm/byteorder.h>
 #include <asm/dma.h>
@@ -112,6 +113,10 @@ struct s3c_request {
 	struct usb_request req;
 	struct list_head queue;
 	unsigned char mapped;
+
+	/* scatter-gather requests: segment in flight and segments left */
+	struct scatterlist *sg;
+	unsigned sg_left;
 };
 
 struct s3c_udc {
@@ -464,7 +464,13 @@ static void done(struct s3c_ep *ep, struct s3c_request *req, int status)
 	else
 		status = req->req.status;
 
-	if (req->mapped) {
+	if (req->req.num_mapped_sgs) {
+		dma_unmap_sg(dev, req->req.sg, req->req.num_sgs,
+				(ep->bEndpointAddress & USB_DIR_IN) ?
+				DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		req->req.num_mapped_sgs = 0;
+		req->sg = NULL;
+	} else if (req->mapped) {
 		dma_unmap_single(dev, req->req.dma, req->req.length,
 				(ep->bEndpointAddress & USB_DIR_IN) ?
 				DMA_TO_DEVICE : DMA_FROM_DEVICE);
@@ -1401,6 +1407,7 @@ static int s3c_udc_probe(struct platform_device *pdev)
 	dev->gadget.dev.parent = &pdev->dev;
 
 	dev->gadget.is_dualspeed = 1;	/* Hack only*/
+	dev->gadget.sg_supported = OTG_DMA_MODE;
 	dev->gadget.is_otg = 0;
 	dev->gadget.is_a_peripheral = 0;
 	dev->gadget.b_hnp_enable = 0;
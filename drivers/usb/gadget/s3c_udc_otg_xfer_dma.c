@@ -92,20 +92,75 @@ static inline void s3c_udc_pre_setup(void)
 	writel(ep_ctrl|DEPCTL_EPENA|DEPCTL_CNAK, S3C_UDC_OTG_DOEPCTL(EP0_CON));
 }
 
+/*
+ * Scatter-gather requests are mapped once when they reach the head of the
+ * queue and then transferred one segment per DMA programming: the
+ * TRANSFER_DONE interrupt of a segment starts the next one without going
+ * through the gadget driver.
+ */
+static void s3c_udc_map_sg(struct s3c_ep *ep, struct s3c_request *req)
+{
+	struct device *dev = &the_controller->dev->dev;
+
+	if (req->req.num_mapped_sgs)
+		return;
+
+	req->req.num_mapped_sgs = dma_map_sg(dev, req->req.sg, req->req.num_sgs,
+			ep_is_in(ep) ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+	req->sg = req->req.sg;
+	req->sg_left = req->req.num_mapped_sgs;
+}
+
+/*
+ * The controller moves every segment with a single DMA programming, so
+ * all segments but the last one of an IN transfer must end on a packet
+ * boundary, OUT segments must hold whole packets, and DMA addresses have
+ * to be word aligned.
+ */
+static int s3c_udc_sg_valid(struct s3c_ep *ep, struct usb_request *_req)
+{
+	struct scatterlist *sg;
+	int i;
+
+	if (ep_index(ep) == EP0_CON)
+		return 0;
+
+	for_each_sg(_req->sg, sg, _req->num_sgs, i) {
+		if ((sg->offset & 3) || !sg->length || sg->length > 0x7fff)
+			return 0;
+
+		if ((!ep_is_in(ep) || i < _req->num_sgs - 1) &&
+		    sg->length % ep->ep.maxpacket)
+			return 0;
+	}
+
+	return 1;
+}
+
 static int setdma_rx(struct s3c_ep *ep, struct s3c_request *req)
 {
 	u32 *buf, ctrl;
 	u32 length, pktcnt;
 	u32 ep_num = ep_index(ep);
+	dma_addr_t dma;
 
 	struct device *dev = &the_controller->dev->dev;
-	buf = req->req.buf + req->req.actual;
-	prefetchw(buf);
 
-	length = req->req.length - req->req.actual;
-	req->req.dma = dma_map_single(dev, buf,
-			length, DMA_FROM_DEVICE);
-	req->mapped = 1;
+	if (req->req.num_sgs) {
+		s3c_udc_map_sg(ep, req);
+		buf = NULL;
+		dma = sg_dma_address(req->sg);
+		length = sg_dma_len(req->sg);
+	} else {
+		buf = req->req.buf + req->req.actual;
+		prefetchw(buf);
+
+		length = req->req.length - req->req.actual;
+		req->req.dma = dma_map_single(dev, buf,
+				length, DMA_FROM_DEVICE);
+		req->mapped = 1;
+		dma = virt_to_phys(buf);
+	}
 
 	if (length == 0)
 		pktcnt = 1;
@@ -114,7 +169,7 @@ static int setdma_rx(struct s3c_ep *ep, struct s3c_request *req)
 
 	ctrl =  readl(S3C_UDC_OTG_DOEPCTL(ep_num));
 
-	writel(virt_to_phys(buf), S3C_UDC_OTG_DOEPDMA(ep_num));
+	writel(dma, S3C_UDC_OTG_DOEPDMA(ep_num));
 	writel((pktcnt<<19)|(length<<0), S3C_UDC_OTG_DOEPTSIZ(ep_num));
 	writel(DEPCTL_EPENA|DEPCTL_CNAK|ctrl, S3C_UDC_OTG_DOEPCTL(ep_num));
 
@@ -134,19 +189,29 @@ static int setdma_tx(struct s3c_ep *ep, struct s3c_request *req)
 	u32 *buf, ctrl = 0;
 	u32 length, pktcnt;
 	u32 ep_num = ep_index(ep);
+	dma_addr_t dma;
 	struct device *dev = &the_controller->dev->dev;
 
-	buf = req->req.buf + req->req.actual;
-	prefetch(buf);
-	length = req->req.length - req->req.actual;
-
-	if (ep_num == EP0_CON)
-		length = min(length, (u32)ep_maxpacket(ep));
-
-	req->req.actual += length;
-	req->req.dma = dma_map_single(dev, buf,
-			length, DMA_TO_DEVICE);
-	req->mapped = 1;
+	if (req->req.num_sgs) {
+		/* actual is accounted per segment in complete_tx() */
+		s3c_udc_map_sg(ep, req);
+		buf = NULL;
+		dma = sg_dma_address(req->sg);
+		length = sg_dma_len(req->sg);
+	} else {
+		buf = req->req.buf + req->req.actual;
+		prefetch(buf);
+		length = req->req.length - req->req.actual;
+
+		if (ep_num == EP0_CON)
+			length = min(length, (u32)ep_maxpacket(ep));
+
+		req->req.actual += length;
+		req->req.dma = dma_map_single(dev, buf,
+				length, DMA_TO_DEVICE);
+		req->mapped = 1;
+		dma = virt_to_phys(buf);
+	}
 
 	if (length == 0)
 		pktcnt = 1;
@@ -161,7 +226,7 @@ static int setdma_tx(struct s3c_ep *ep, struct s3c_request *req)
 	writel(ctrl , S3C_UDC_OTG_DIEPCTL(ep_num));
 #endif
 
-	writel(virt_to_phys(buf), S3C_UDC_OTG_DIEPDMA(ep_num));
+	writel(dma, S3C_UDC_OTG_DIEPDMA(ep_num));
 	writel((pktcnt<<19)|(length<<0), S3C_UDC_OTG_DIEPTSIZ(ep_num));
 	ctrl = readl(S3C_UDC_OTG_DIEPCTL(ep_num));
 	if (ep->bmAttributes == USB_ENDPOINT_XFER_ISOC)
@@ -179,6 +244,45 @@ static int setdma_tx(struct s3c_ep *ep, struct s3c_request *req)
 	return length;
 }
 
+/*
+ * Give a finished request back to the gadget driver. If another request
+ * is already queued behind it, its DMA is programmed first so that the
+ * controller keeps moving data while the completion callback runs,
+ * instead of leaving the bus idle until the callback returns.
+ */
+static void s3c_udc_req_done(struct s3c_ep *ep, struct s3c_request *req,
+				int is_in)
+{
+	struct s3c_request *next;
+
+	if (ep_index(ep) != EP0_CON && !list_is_last(&req->queue, &ep->queue)) {
+		next = list_entry(req->queue.next, struct s3c_request, queue);
+		DEBUG("%s: %s chaining next request %p\n",
+			__func__, ep->ep.name, next);
+
+		if (is_in)
+			setdma_tx(ep, next);
+		else
+			setdma_rx(ep, next);
+
+		done(ep, req, 0);
+		return;
+	}
+
+	done(ep, req, 0);
+
+	if (!list_empty(&ep->queue)) {
+		next = list_entry(ep->queue.next, struct s3c_request, queue);
+		DEBUG("%s: Next %s request start...\n",
+			__func__, is_in ? "Tx" : "Rx");
+
+		if (is_in)
+			setdma_tx(ep, next);
+		else
+			setdma_rx(ep, next);
+	}
+}
+
 static void complete_rx(struct s3c_udc *dev, u8 ep_num)
 {
 	struct s3c_ep *ep = &dev->ep[ep_num];
@@ -202,6 +306,25 @@ static void complete_rx(struct s3c_udc *dev, u8 ep_num)
 	else
 		xfer_size = (ep_tsr & 0x7fff);
 
+	if (req->req.num_mapped_sgs) {
+		req->req.actual += sg_dma_len(req->sg) - xfer_size;
+
+		DEBUG_OUT_EP("%s: RX DMA segment done : ep = %d, rx bytes = %d/%d, "
+			"remained bytes = %d, segments left = %d\n",
+			__func__, ep_num, req->req.actual, req->req.length,
+			xfer_size, req->sg_left - 1);
+
+		/* a short packet ends the transfer early */
+		if (!xfer_size && --req->sg_left) {
+			req->sg = sg_next(req->sg);
+			setdma_rx(ep, req);
+			return;
+		}
+
+		s3c_udc_req_done(ep, req, 0);
+		return;
+	}
+
 	__dma_single_cpu_to_dev(req->req.buf, req->req.length, DMA_FROM_DEVICE);
 	xfer_length = req->req.length - xfer_size;
 	req->req.actual += min(xfer_length, req->req.length - req->req.actual);
@@ -219,13 +342,7 @@ static void complete_rx(struct s3c_udc *dev, u8 ep_num)
 			s3c_udc_ep0_zlp();
 
 		} else {
-			done(ep, req, 0);
-
-			if (!list_empty(&ep->queue)) {
-				req = list_entry(ep->queue.next, struct s3c_request, queue);
-				DEBUG_OUT_EP("%s: Next Rx request start...\n", __func__);
-				setdma_rx(ep, req);
-			}
+			s3c_udc_req_done(ep, req, 0);
 		}
 	}
 }
@@ -265,6 +382,24 @@ static void complete_tx(struct s3c_udc *dev, u8 ep_num)
 	else
 		xfer_size = (ep_tsr & 0x7fff);
 
+	if (req->req.num_mapped_sgs) {
+		req->req.actual += sg_dma_len(req->sg) - xfer_size;
+
+		DEBUG_IN_EP("%s: TX DMA segment done : ep = %d, tx bytes = %d/%d, "
+			"remained bytes = %d, segments left = %d\n",
+			__func__, ep_num, req->req.actual, req->req.length,
+			xfer_size, req->sg_left - 1);
+
+		if (!xfer_size && --req->sg_left) {
+			req->sg = sg_next(req->sg);
+			setdma_tx(ep, req);
+			return;
+		}
+
+		s3c_udc_req_done(ep, req, 1);
+		return;
+	}
+
 	req->req.actual = req->req.length - xfer_size;
 	xfer_length = req->req.length - xfer_size;
 	req->req.actual += min(xfer_length, req->req.length - req->req.actual);
@@ -275,15 +410,8 @@ static void complete_tx(struct s3c_udc *dev, u8 ep_num)
 		__func__, ep_num, req->req.actual, req->req.length,
 		is_short, ep_tsr, xfer_size);
 
-	if (req->req.actual == req->req.length) {
-		done(ep, req, 0);
-
-		if (!list_empty(&ep->queue)) {
-			req = list_entry(ep->queue.next, struct s3c_request, queue);
-			DEBUG_IN_EP("%s: Next Tx request start...\n", __func__);
-			setdma_tx(ep, req);
-		}
-	}
+	if (req->req.actual == req->req.length)
+		s3c_udc_req_done(ep, req, 1);
 }
 static inline void s3c_udc_check_tx_queue(struct s3c_udc *dev, u8 ep_num)
 {
@@ -538,7 +666,8 @@ static int s3c_queue(struct usb_ep *_ep, struct usb_request *_req,
 	u32 ep_num, gintsts;
 
 	req = container_of(_req, struct s3c_request, req);
-	if (unlikely(!_req || !_req->complete || !_req->buf || !list_empty(&req->queue))) {
+	if (unlikely(!_req || !_req->complete || (!_req->buf && !_req->num_sgs)
+			|| !list_empty(&req->queue))) {
 
 		DEBUG("%s: bad params\n", __func__);
 		return -EINVAL;
@@ -552,6 +681,12 @@ static int s3c_queue(struct usb_ep *_ep, struct usb_request *_req,
 		return -EINVAL;
 	}
 
+	if (unlikely(_req->num_sgs && !s3c_udc_sg_valid(ep, _req))) {
+
+		DEBUG("%s: %s unsupported sg list\n", __func__, ep->ep.name);
+		return -EINVAL;
+	}
+
 	ep_num = ep_index(ep);
 	dev = ep->dev;
 	if (unlikely(!dev->driver || dev->gadget.speed == USB_SPEED_UNKNOWN)) {
@@ -117,6 +117,19 @@ struct dentry_stat_t dentry_stat = {
 
 static DEFINE_PER_CPU(unsigned int, nr_dentry);
 
+/*
+ * Unused negative dentries are kept on a separate per-sb LRU.  They are
+ * reclaimed after the other unused dentries of the sb under memory pressure,
+ * and trimmed in the background once there are more than
+ * sysctl_negative_dentry_limit of them (0 means no limit).  This keeps the
+ * misses of search path probing (dlopen, class loaders, package managers)
+ * cached without letting them push positive dentries out of the dcache.
+ */
+int sysctl_negative_dentry_limit __read_mostly;
+
+static void negative_dentry_trim(struct work_struct *work);
+static DECLARE_WORK(negative_dentry_trim_work, negative_dentry_trim);
+
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 static int get_nr_dentry(void)
 {
@@ -227,25 +240,58 @@ static void dentry_unlink_inode(struct dentry * dentry)
 /*
  * dentry_lru_(add|del|move_tail) must be called with d_lock held.
  */
-static void dentry_lru_add(struct dentry *dentry)
+static void __dentry_lru_add(struct dentry *dentry)
 {
-	if (list_empty(&dentry->d_lru)) {
-		spin_lock(&dcache_lru_lock);
-		list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-		dentry->d_sb->s_nr_dentry_unused++;
-		dentry_stat.nr_unused++;
-		spin_unlock(&dcache_lru_lock);
+	struct super_block *sb = dentry->d_sb;
+
+	if (!dentry->d_inode) {
+		list_add(&dentry->d_lru, &sb->s_negative_lru);
+		dentry->d_flags |= DCACHE_NEGATIVE_LRU;
+		sb->s_nr_negative_unused++;
+		dentry_stat.nr_negative++;
+	} else {
+		list_add(&dentry->d_lru, &sb->s_dentry_lru);
 	}
+	sb->s_nr_dentry_unused++;
+	dentry_stat.nr_unused++;
 }
 
 static void __dentry_lru_del(struct dentry *dentry)
 {
 	list_del_init(&dentry->d_lru);
-	dentry->d_flags &= ~DCACHE_SHRINK_LIST;
+	if (dentry->d_flags & DCACHE_NEGATIVE_LRU) {
+		dentry->d_sb->s_nr_negative_unused--;
+		dentry_stat.nr_negative--;
+	}
+	dentry->d_flags &= ~(DCACHE_SHRINK_LIST | DCACHE_NEGATIVE_LRU);
 	dentry->d_sb->s_nr_dentry_unused--;
 	dentry_stat.nr_unused--;
 }
 
+static void dentry_lru_add(struct dentry *dentry)
+{
+	int negative = !dentry->d_inode;
+
+	if (list_empty(&dentry->d_lru)) {
+		spin_lock(&dcache_lru_lock);
+		__dentry_lru_add(dentry);
+		spin_unlock(&dcache_lru_lock);
+	} else if (negative != !!(dentry->d_flags & DCACHE_NEGATIVE_LRU) &&
+		   !(dentry->d_flags & DCACHE_SHRINK_LIST)) {
+		/* instantiated or unlinked while it sat on an LRU */
+		spin_lock(&dcache_lru_lock);
+		__dentry_lru_del(dentry);
+		__dentry_lru_add(dentry);
+		spin_unlock(&dcache_lru_lock);
+	} else {
+		return;
+	}
+
+	if (negative && sysctl_negative_dentry_limit &&
+	    dentry_stat.nr_negative > sysctl_negative_dentry_limit)
+		schedule_work(&negative_dentry_trim_work);
+}
+
 static void dentry_lru_del(struct dentry *dentry)
 {
 	if (!list_empty(&dentry->d_lru)) {
@@ -255,6 +301,10 @@ static void dentry_lru_del(struct dentry *dentry)
 	}
 }
 
+/*
+ * Negative dentries are moved to the main LRU too, that is the only one
+ * shrink_dcache_parent() looks at.
+ */
 static void dentry_lru_move_tail(struct dentry *dentry)
 {
 	spin_lock(&dcache_lru_lock);
@@ -263,6 +313,11 @@ static void dentry_lru_move_tail(struct dentry *dentry)
 		dentry->d_sb->s_nr_dentry_unused++;
 		dentry_stat.nr_unused++;
 	} else {
+		if (dentry->d_flags & DCACHE_NEGATIVE_LRU) {
+			dentry->d_flags &= ~DCACHE_NEGATIVE_LRU;
+			dentry->d_sb->s_nr_negative_unused--;
+			dentry_stat.nr_negative--;
+		}
 		list_move_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
 	}
 	spin_unlock(&dcache_lru_lock);
@@ -714,16 +769,17 @@ static void shrink_dentry_list(struct list_head *list)
 }
 
 /**
- * __shrink_dcache_sb - shrink the dentry LRU on a given superblock
+ * __shrink_dcache_lru - shrink one of the dentry LRUs of a superblock
  * @sb:		superblock to shrink dentry LRU.
+ * @lru:	&sb->s_dentry_lru or &sb->s_negative_lru
  * @count:	number of entries to prune
  * @flags:	flags to control the dentry processing
  *
  * If flags contains DCACHE_REFERENCED reference dentries will not be pruned.
  */
-static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
+static void __shrink_dcache_lru(struct super_block *sb, struct list_head *lru,
+				int *count, int flags)
 {
-	/* called from prune_dcache() and shrink_dcache_parent() */
 	struct dentry *dentry;
 	LIST_HEAD(referenced);
 	LIST_HEAD(tmp);
@@ -731,9 +787,8 @@ static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
 
 relock:
 	spin_lock(&dcache_lru_lock);
-	while (!list_empty(&sb->s_dentry_lru)) {
-		dentry = list_entry(sb->s_dentry_lru.prev,
-				struct dentry, d_lru);
+	while (!list_empty(lru)) {
+		dentry = list_entry(lru->prev, struct dentry, d_lru);
 		BUG_ON(dentry->d_sb != sb);
 
 		if (!spin_trylock(&dentry->d_lock)) {
@@ -762,7 +817,7 @@ relock:
 		cond_resched_lock(&dcache_lru_lock);
 	}
 	if (!list_empty(&referenced))
-		list_splice(&referenced, &sb->s_dentry_lru);
+		list_splice(&referenced, lru);
 	spin_unlock(&dcache_lru_lock);
 
 	shrink_dentry_list(&tmp);
@@ -770,6 +825,12 @@ relock:
 	*count = cnt;
 }
 
+/* called from prune_dcache() and shrink_dcache_parent() */
+static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
+{
+	__shrink_dcache_lru(sb, &sb->s_dentry_lru, count, flags);
+}
+
 /**
  * prune_dcache - shrink the dcache
  * @count: number of entries to try to free
@@ -823,10 +884,14 @@ static void prune_dcache(int count)
 		 * s_root isn't NULL.
 		 */
 		if (down_read_trylock(&sb->s_umount)) {
-			if ((sb->s_root != NULL) &&
-			    (!list_empty(&sb->s_dentry_lru))) {
+			if (sb->s_root != NULL) {
+				/* negative dentries are the last to go */
 				__shrink_dcache_sb(sb, &w_count,
 						DCACHE_REFERENCED);
+				if (w_count)
+					__shrink_dcache_lru(sb,
+						&sb->s_negative_lru, &w_count,
+						DCACHE_REFERENCED);
 				pruned -= w_count;
 			}
 			up_read(&sb->s_umount);
@@ -845,6 +910,48 @@ static void prune_dcache(int count)
 	spin_unlock(&sb_lock);
 }
 
+/*
+ * Bring the number of unused negative dentries back under
+ * sysctl_negative_dentry_limit, taking the same share of the excess
+ * from each superblock.  Dentries looked up since the last pass get
+ * another round on the LRU.
+ */
+static void negative_dentry_trim(struct work_struct *work)
+{
+	struct super_block *sb, *p = NULL;
+	int limit = sysctl_negative_dentry_limit;
+	int total = dentry_stat.nr_negative;
+	int ratio, count;
+
+	if (!limit || total <= limit)
+		return;
+	ratio = total / (total - limit);
+
+	spin_lock(&sb_lock);
+	list_for_each_entry(sb, &super_blocks, s_list) {
+		if (list_empty(&sb->s_instances))
+			continue;
+		if (sb->s_nr_negative_unused == 0)
+			continue;
+		sb->s_count++;
+		spin_unlock(&sb_lock);
+		count = sb->s_nr_negative_unused / ratio + 1;
+		if (down_read_trylock(&sb->s_umount)) {
+			if (sb->s_root != NULL)
+				__shrink_dcache_lru(sb, &sb->s_negative_lru,
+						&count, DCACHE_REFERENCED);
+			up_read(&sb->s_umount);
+		}
+		spin_lock(&sb_lock);
+		if (p)
+			__put_super(p);
+		p = sb;
+	}
+	if (p)
+		__put_super(p);
+	spin_unlock(&sb_lock);
+}
+
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
  * @sb: superblock
@@ -857,8 +964,10 @@ void shrink_dcache_sb(struct super_block *sb)
 	LIST_HEAD(tmp);
 
 	spin_lock(&dcache_lru_lock);
-	while (!list_empty(&sb->s_dentry_lru)) {
+	while (!list_empty(&sb->s_dentry_lru) ||
+	       !list_empty(&sb->s_negative_lru)) {
 		list_splice_init(&sb->s_dentry_lru, &tmp);
+		list_splice_init(&sb->s_negative_lru, &tmp);
 		spin_unlock(&dcache_lru_lock);
 		shrink_dentry_list(&tmp);
 		spin_lock(&dcache_lru_lock);
@@ -1874,6 +1983,23 @@ struct dentry *d_lookup(struct dentry *parent, struct qstr *name)
 }
 EXPORT_SYMBOL(d_lookup);
 
+/**
+ * d_negative_referenced - note a hit on an unused negative dentry
+ * @dentry: negative dentry found by rcu-walk
+ *
+ * rcu-walk never takes a reference, so dput() doesn't get to mark the
+ * dentry referenced and the negative LRU would age it out like one that
+ * was never looked up again.
+ */
+void d_negative_referenced(struct dentry *dentry)
+{
+	if (dentry->d_flags & DCACHE_REFERENCED)
+		return;
+	spin_lock(&dentry->d_lock);
+	dentry->d_flags |= DCACHE_REFERENCED;
+	spin_unlock(&dentry->d_lock);
+}
+
 /**
  * __d_lookup - search for a dentry (racy)
  * @parent: parent dentry
@@ -3072,6 +3198,10 @@ static void __init dcache_init(void)
 	
 	register_shrinker(&dcache_shrinker);
 
+	/* by default, keep up to 1% of memory in unused negative dentries */
+	sysctl_negative_dentry_limit = totalram_pages / 100 *
+		(PAGE_SIZE / sizeof(struct dentry));
+
 	/* Hash may have been set up in dcache_init_early */
 	if (!hashdist)
 		return;
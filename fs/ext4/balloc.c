@@ -310,6 +310,8 @@ ext4_read_block_bitmap(struct super_block *sb, ext4_group_t block_group)
 			    block_group, bitmap_blk);
 		return NULL;
 	}
+	/* allocations are redone from the extents by fast commit replay */
+	set_buffer_fc_safe(bh);
 
 	if (bitmap_uptodate(bh))
 		return bh;
@@ -108,6 +108,63 @@ int __ext4_check_dir_entry(const char *function, unsigned int line,
 	return 1;
 }
 
+/*
+ * Inline directories have no "." and ".." entries: they are returned at
+ * f_pos 0 and 1, and the real entries at their offset in the inline data,
+ * which starts past the parent inode number.
+ */
+static int ext4_read_inline_dir(struct file *filp,
+				void *dirent, filldir_t filldir,
+				int *has_inline)
+{
+	struct inode *inode = filp->f_path.dentry->d_inode;
+	struct ext4_dir_entry_2 *de;
+	unsigned int offset, rlen;
+	void *buf = NULL;
+	int size;
+
+	size = ext4_get_inline_dir_data(inode, &buf);
+	if (size <= 0) {
+		if (!size)
+			*has_inline = 0;
+		return size;
+	}
+
+	if (filp->f_pos == 0) {
+		if (filldir(dirent, ".", 1, 0, inode->i_ino, DT_DIR) < 0)
+			goto out;
+		filp->f_pos = 1;
+	}
+	if (filp->f_pos == 1) {
+		if (filldir(dirent, "..", 2, 1, le32_to_cpu(*(__le32 *)buf),
+			    DT_DIR) < 0)
+			goto out;
+		filp->f_pos = EXT4_INLINE_DOTDOT_SIZE;
+	}
+
+	for (offset = EXT4_INLINE_DOTDOT_SIZE; offset < size; offset += rlen) {
+		de = buf + offset;
+		if (ext4_check_inline_dirent(inode, de, offset, size)) {
+			/* skip the rest, as for a bad directory block */
+			filp->f_pos = size;
+			break;
+		}
+		rlen = ext4_rec_len_from_disk(de->rec_len,
+					      inode->i_sb->s_blocksize);
+		if (offset < filp->f_pos)
+			continue;
+		if (le32_to_cpu(de->inode) &&
+		    filldir(dirent, de->name, de->name_len, offset,
+			    le32_to_cpu(de->inode),
+			    get_dtype(inode->i_sb, de->file_type)) < 0)
+			break;
+		filp->f_pos = offset + rlen;
+	}
+out:
+	kfree(buf);
+	return 0;
+}
+
 static int ext4_readdir(struct file *filp,
 			 void *dirent, filldir_t filldir)
 {
@@ -123,6 +180,14 @@ static int ext4_readdir(struct file *filp,
 
 	sb = inode->i_sb;
 
+	if (ext4_has_inline_data(inode)) {
+		int has_inline = 1;
+
+		ret = ext4_read_inline_dir(filp, dirent, filldir, &has_inline);
+		if (has_inline)
+			return ret;
+	}
+
 	if (EXT4_HAS_COMPAT_FEATURE(inode->i_sb,
 				    EXT4_FEATURE_COMPAT_DIR_INDEX) &&
 	    ((ext4_test_inode_flag(inode, EXT4_INODE_INDEX)) ||
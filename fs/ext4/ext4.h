@@ -351,9 +351,10 @@ struct flex_groups {
 #define EXT4_EXTENTS_FL			0x00080000 /* Inode uses extents */
 #define EXT4_EA_INODE_FL	        0x00200000 /* Inode used for large EA */
 #define EXT4_EOFBLOCKS_FL		0x00400000 /* Blocks allocated beyond EOF */
+#define EXT4_INLINE_DATA_FL		0x10000000 /* Inode has inline data. */
 #define EXT4_RESERVED_FL		0x80000000 /* reserved for ext4 lib */
 
-#define EXT4_FL_USER_VISIBLE		0x004BDFFF /* User visible flags */
+#define EXT4_FL_USER_VISIBLE		0x104BDFFF /* User visible flags */
 #define EXT4_FL_USER_MODIFIABLE		0x004B80FF /* User modifiable flags */
 
 /* Flags that should be inherited by new inodes from their parent. */
@@ -407,6 +408,7 @@ enum {
 	EXT4_INODE_EXTENTS	= 19,	/* Inode uses extents */
 	EXT4_INODE_EA_INODE	= 21,	/* Inode used for large EA */
 	EXT4_INODE_EOFBLOCKS	= 22,	/* Blocks allocated beyond EOF */
+	EXT4_INODE_INLINE_DATA	= 28,	/* Data in inode. */
 	EXT4_INODE_RESERVED	= 31,	/* reserved for ext4 lib */
 };
 
@@ -453,6 +455,7 @@ static inline void ext4_check_flag_values(void)
 	CHECK_FLAG_VALUE(EXTENTS);
 	CHECK_FLAG_VALUE(EA_INODE);
 	CHECK_FLAG_VALUE(EOFBLOCKS);
+	CHECK_FLAG_VALUE(INLINE_DATA);
 	CHECK_FLAG_VALUE(RESERVED);
 }
 
@@ -845,6 +848,10 @@ struct ext4_inode_info {
 	/* on-disk additional length */
 	__u16 i_extra_isize;
 
+	/* Inline data: offset of the system.data xattr entry, total size */
+	u16 i_inline_off;
+	u16 i_inline_size;
+
 #ifdef CONFIG_QUOTA
 	/* quota space reservation, managed internally by quota code */
 	qsize_t i_reserved_quota;
@@ -917,6 +924,8 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_DISCARD		0x40000000 /* Issue DISCARD requests */
 #define EXT4_MOUNT_INIT_INODE_TABLE	0x80000000 /* Initialize uninitialized itables */
 
+#define EXT4_MOUNT2_FAST_COMMIT		0x00000001 /* Fast commits on fsync */
+
 #define clear_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt &= \
 						~EXT4_MOUNT_##opt
 #define set_opt(sb, opt)		EXT4_SB(sb)->s_mount_opt |= \
@@ -1092,6 +1101,7 @@ struct ext4_sb_info {
 	unsigned long s_overhead_last;  /* Last calculated overhead */
 	unsigned long s_blocks_last;    /* Last seen block count */
 	loff_t s_bitmap_maxbytes;	/* max bytes for bitmap files */
+	struct super_block *s_sb;	/* The VFS super block */
 	struct buffer_head * s_sbh;	/* Buffer containing the super block */
 	struct ext4_super_block *s_es;	/* Pointer to the super block in the buffer */
 	struct buffer_head **s_group_desc;
@@ -1156,6 +1166,11 @@ struct ext4_sb_info {
 	unsigned long extent_cache_hits;
 	unsigned long extent_cache_misses;
 
+	/* fast commits */
+	tid_t s_fc_ineligible_tid;	/* transaction fsync must fully commit */
+	unsigned long s_fc_commits;
+	unsigned long s_fc_fallbacks;
+
 	/* for buddy allocator */
 	struct ext4_group_info ***s_group_info;
 	struct inode *s_buddy_cache;
@@ -1192,6 +1207,21 @@ struct ext4_sb_info {
 	atomic_t s_mb_discarded;
 	atomic_t s_lock_busy;
 
+	/* asynchronous discard of freed blocks */
+	struct list_head s_discard_list;	/* ext4_free_data to discard */
+	spinlock_t s_discard_lock;		/* protects the list */
+	struct mutex s_discard_mutex;		/* serializes the discarding */
+	struct delayed_work s_discard_work;
+	unsigned long s_discard_last_ios;	/* disk I/Os at last look */
+	unsigned int s_discard_deferred;	/* runs deferred in a row */
+	unsigned int s_discard_async;		/* queue freed blocks */
+	unsigned int s_discard_interval;	/* idle time before, in ms */
+	unsigned int s_discard_batch;		/* max blocks per run */
+	unsigned long s_discard_pending;	/* blocks queued */
+	unsigned long s_discard_requests;	/* discards issued */
+	unsigned long s_discard_blocks;		/* blocks discarded */
+	unsigned long s_discard_merged;		/* extents merged */
+
 	/* locality groups */
 	struct ext4_locality_group __percpu *s_locality_groups;
 
@@ -1254,6 +1284,7 @@ enum {
 	EXT4_STATE_DIO_UNWRITTEN,	/* need convert on dio done*/
 	EXT4_STATE_NEWENTRY,		/* File just added to dir */
 	EXT4_STATE_DELALLOC_RESERVED,	/* blks already reserved for delalloc */
+	EXT4_STATE_MAY_INLINE_DATA,	/* may have in-inode data */
 };
 
 #define EXT4_INODE_BIT_FNS(name, field, offset)				\
@@ -1365,6 +1396,7 @@ static inline void ext4_clear_state_flags(struct ext4_inode_info *ei)
 #define EXT4_FEATURE_INCOMPAT_FLEX_BG		0x0200
 #define EXT4_FEATURE_INCOMPAT_EA_INODE		0x0400 /* EA in inode */
 #define EXT4_FEATURE_INCOMPAT_DIRDATA		0x1000 /* data in dirent */
+#define EXT4_FEATURE_INCOMPAT_INLINE_DATA	0x8000 /* data in inode */
 
 #define EXT2_FEATURE_COMPAT_SUPP	EXT4_FEATURE_COMPAT_EXT_ATTR
 #define EXT2_FEATURE_INCOMPAT_SUPP	(EXT4_FEATURE_INCOMPAT_FILETYPE| \
@@ -1388,7 +1420,8 @@ static inline void ext4_clear_state_flags(struct ext4_inode_info *ei)
 					 EXT4_FEATURE_INCOMPAT_EXTENTS| \
 					 EXT4_FEATURE_INCOMPAT_64BIT| \
 					 EXT4_FEATURE_INCOMPAT_FLEX_BG| \
-					 EXT4_FEATURE_INCOMPAT_MMP)
+					 EXT4_FEATURE_INCOMPAT_MMP | \
+					 EXT4_FEATURE_INCOMPAT_INLINE_DATA)
 #define EXT4_FEATURE_RO_COMPAT_SUPP	(EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER| \
 					 EXT4_FEATURE_RO_COMPAT_LARGE_FILE| \
 					 EXT4_FEATURE_RO_COMPAT_GDT_CSUM| \
@@ -2194,14 +2227,157 @@ extern int ext4_bio_write_page(struct ext4_io_submit *io,
 /* mmp.c */
 extern int ext4_multi_mount_protect(struct super_block *, ext4_fsblk_t);
 
+/* fast_commit.c */
+extern int ext4_fc_commit(struct inode *inode, tid_t commit_tid);
+extern void ext4_fc_replay(struct super_block *sb);
+
+/* inline.c */
+#define EXT4_MIN_INLINE_DATA_SIZE	((sizeof(__le32) * EXT4_N_BLOCKS))
+/* the parent inode number in front of the entries of an inline directory */
+#define EXT4_INLINE_DOTDOT_SIZE		4
+
+static inline int ext4_has_inline_data(struct inode *inode)
+{
+	return ext4_test_inode_flag(inode, EXT4_INODE_INLINE_DATA) &&
+	       EXT4_I(inode)->i_inline_off;
+}
+
+#ifdef CONFIG_EXT4_FS_XATTR
+extern int ext4_get_max_inline_size(struct inode *inode);
+extern int ext4_find_inline_data_nolock(struct inode *inode);
+extern int ext4_readpage_inline(struct inode *inode, struct page *page);
+extern int ext4_try_to_write_inline_data(struct address_space *mapping,
+					 struct inode *inode,
+					 loff_t pos, unsigned len,
+					 unsigned flags,
+					 struct page **pagep);
+extern int ext4_write_inline_data_end(struct inode *inode,
+				      loff_t pos, unsigned len,
+				      unsigned copied,
+				      struct page *page);
+extern int ext4_convert_inline_data(struct inode *inode);
+extern void ext4_inline_data_truncate(struct inode *inode, int *has_inline);
+extern int ext4_inline_data_fiemap(struct inode *inode,
+				   struct fiemap_extent_info *fieinfo,
+				   int *has_inline);
+extern int ext4_check_inline_dirent(struct inode *dir,
+				    struct ext4_dir_entry_2 *de,
+				    unsigned int offset, unsigned int size);
+extern int ext4_get_inline_dir_data(struct inode *dir, void **bufp);
+extern struct buffer_head *ext4_find_inline_entry(struct inode *dir,
+					const struct qstr *d_name,
+					struct ext4_dir_entry_2 **res_dir,
+					int *has_inline);
+extern int ext4_empty_inline_dir(struct inode *dir, int *has_inline);
+extern int ext4_inline_dir_parent(struct inode *dir, __u32 *ino);
+extern int ext4_inline_dir_set_parent(handle_t *handle, struct inode *dir,
+				      __u32 ino);
+extern int ext4_convert_inline_dir(struct inode *dir);
+#else
+/* without xattr support there is no way to find the data */
+static inline int ext4_find_inline_data_nolock(struct inode *inode)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int ext4_readpage_inline(struct inode *inode, struct page *page)
+{
+	return -EAGAIN;
+}
+
+static inline int ext4_try_to_write_inline_data(struct address_space *mapping,
+						struct inode *inode,
+						loff_t pos, unsigned len,
+						unsigned flags,
+						struct page **pagep)
+{
+	ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+	return 0;
+}
+
+static inline int ext4_write_inline_data_end(struct inode *inode,
+					     loff_t pos, unsigned len,
+					     unsigned copied,
+					     struct page *page)
+{
+	BUG();
+	return 0;
+}
+
+static inline int ext4_convert_inline_data(struct inode *inode)
+{
+	return 0;
+}
+
+static inline void ext4_inline_data_truncate(struct inode *inode,
+					     int *has_inline)
+{
+	*has_inline = 0;
+}
+
+static inline int ext4_inline_data_fiemap(struct inode *inode,
+					  struct fiemap_extent_info *fieinfo,
+					  int *has_inline)
+{
+	*has_inline = 0;
+	return 0;
+}
+
+static inline int ext4_check_inline_dirent(struct inode *dir,
+					   struct ext4_dir_entry_2 *de,
+					   unsigned int offset,
+					   unsigned int size)
+{
+	return 1;
+}
+
+static inline int ext4_get_inline_dir_data(struct inode *dir, void **bufp)
+{
+	return 0;
+}
+
+static inline struct buffer_head *ext4_find_inline_entry(struct inode *dir,
+					const struct qstr *d_name,
+					struct ext4_dir_entry_2 **res_dir,
+					int *has_inline)
+{
+	*has_inline = 0;
+	return NULL;
+}
+
+static inline int ext4_empty_inline_dir(struct inode *dir, int *has_inline)
+{
+	*has_inline = 0;
+	return 1;
+}
+
+static inline int ext4_inline_dir_parent(struct inode *dir, __u32 *ino)
+{
+	return 0;
+}
+
+static inline int ext4_inline_dir_set_parent(handle_t *handle,
+					     struct inode *dir, __u32 ino)
+{
+	return 0;
+}
+
+static inline int ext4_convert_inline_dir(struct inode *dir)
+{
+	return 0;
+}
+#endif
+
 /* BH_Uninit flag: blocks are allocated but uninitialized on disk */
 enum ext4_state_bits {
 	BH_Uninit	/* blocks are allocated but uninitialized on disk */
 	  = BH_JBDPrivateStart,
+	BH_FcSafe,	/* changes are redone by fast commit replay */
 };
 
 BUFFER_FNS(Uninit, uninit)
 TAS_BUFFER_FNS(Uninit, uninit)
+BUFFER_FNS(FcSafe, fc_safe)
 
 /*
  * Add new method to test wether block and inode bitmaps are properly
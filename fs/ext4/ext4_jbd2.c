@@ -53,6 +53,7 @@ int __ext4_forget(const char *where, unsigned int line, handle_t *handle,
 		bforget(bh);
 		return 0;
 	}
+	ext4_fc_mark_ineligible(inode->i_sb, handle);
 
 	/* Never use the revoke function if we are doing full data
 	 * journaling: there is no need to, and a V1 superblock won't
@@ -108,6 +109,10 @@ int __ext4_handle_dirty_metadata(const char *where, unsigned int line,
 	int err = 0;
 
 	if (ext4_handle_valid(handle)) {
+		if (!buffer_fc_safe(bh))
+			ext4_fc_mark_ineligible(
+				handle->h_transaction->t_journal->j_private,
+				handle);
 		err = jbd2_journal_dirty_metadata(handle, bh);
 		if (err)
 			ext4_journal_abort_handle(where, line, __func__,
@@ -142,6 +147,7 @@ int __ext4_handle_dirty_super(const char *where, unsigned int line,
 	int err = 0;
 
 	if (ext4_handle_valid(handle)) {
+		ext4_fc_mark_ineligible(sb, handle);
 		err = jbd2_journal_dirty_metadata(handle, bh);
 		if (err)
 			ext4_journal_abort_handle(where, line, __func__,
@@ -197,6 +197,18 @@ static inline int ext4_handle_has_enough_credits(handle_t *handle, int needed)
 	return 1;
 }
 
+/*
+ * Called for changes fast commit replay would not redo: fsync has to fully
+ * commit the running transaction from now on.
+ */
+static inline void ext4_fc_mark_ineligible(struct super_block *sb,
+					   handle_t *handle)
+{
+	if (ext4_handle_valid(handle) && test_opt2(sb, FAST_COMMIT))
+		EXT4_SB(sb)->s_fc_ineligible_tid =
+			handle->h_transaction->t_tid;
+}
+
 static inline handle_t *ext4_journal_start(struct inode *inode, int nblocks)
 {
 	return ext4_journal_start_sb(inode->i_sb, nblocks);
@@ -0,0 +1,397 @@
+/*
+ * linux/fs/ext4/fast_commit.c
+ *
+ * Fast commits for fsync
+ *
+ * fsync normally has to commit the whole running transaction, which costs
+ * a descriptor block, every metadata block the transaction touched and a
+ * commit block, plus the cache flushes in between.  Databases that fsync
+ * after every small write pay this over and over for what usually is a
+ * changed i_size, mtime and last extent of a single file.
+ *
+ * With the fast_commit mount option, such an fsync instead writes the raw
+ * on-disk inode to the fast commit area jbd2 reserves at the end of the
+ * journal, in one block and with a single flush.  After journal recovery,
+ * the records of the first transaction that did not make it to the log are
+ * replayed on top of it: the inode is written back and the blocks its
+ * extents point to are marked in the block bitmaps.
+ *
+ * That is only correct as long as the inode and the bitmaps were all the
+ * transaction changed, or all the replay of its records redoes.  Any other
+ * metadata change (directories, the inode bitmap, xattr and extent tree
+ * blocks, freed blocks, orphans, the superblock) marks the transaction
+ * ineligible, and fsync falls back to a full commit until the next one.
+ * So do files with an extent tree deeper than the inode.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/fs.h>
+#include <linux/jbd2.h>
+#include <linux/blkdev.h>
+#include <linux/crc32.h>
+
+#include "ext4_jbd2.h"
+#include "ext4.h"
+#include "ext4_extents.h"
+
+#define EXT4_FC_MAGIC		0x4643524e	/* "FCRN" */
+
+/*
+ * One record per fast commit block: the header, then the raw inode as it
+ * is in the inode table.
+ */
+struct ext4_fc_head {
+	__le32	fc_magic;
+	__le32	fc_tid;		/* transaction the record belongs to */
+	__le32	fc_ino;
+	__le16	fc_inode_len;	/* EXT4_INODE_SIZE() */
+	__le16	fc_reserved;
+	__le32	fc_crc;		/* of the header up to here and the inode */
+};
+
+/* The inode, plus bitmap and descriptor of each group an extent spans. */
+#define EXT4_FC_REPLAY_CREDITS(groups)	(1 + 2 * (groups))
+
+static u32 ext4_fc_csum(struct super_block *sb, struct ext4_fc_head *head)
+{
+	u32 crc;
+
+	crc = crc32_le(~0, EXT4_SB(sb)->s_es->s_uuid,
+		       sizeof(EXT4_SB(sb)->s_es->s_uuid));
+	crc = crc32_le(crc, (u8 *)head, offsetof(struct ext4_fc_head, fc_crc));
+	return crc32_le(crc, (u8 *)(head + 1),
+			le16_to_cpu(head->fc_inode_len));
+}
+
+/* Whether replaying @raw_inode alone redoes all of its changes. */
+static int ext4_fc_raw_inode_ok(struct ext4_inode *raw_inode)
+{
+	struct ext4_extent_header *eh = (void *)raw_inode->i_block;
+	u32 flags = le32_to_cpu(raw_inode->i_flags);
+
+	if (flags & EXT4_INLINE_DATA_FL)
+		return 1;
+	return (flags & EXT4_EXTENTS_FL) &&
+	       eh->eh_magic == EXT4_EXT_MAGIC && eh->eh_depth == 0 &&
+	       le16_to_cpu(eh->eh_entries) <= le16_to_cpu(eh->eh_max) &&
+	       le16_to_cpu(eh->eh_max) <= (sizeof(raw_inode->i_block) -
+		       sizeof(*eh)) / sizeof(struct ext4_extent);
+}
+
+static int ext4_fc_inode_ok(struct inode *inode)
+{
+	if (!S_ISREG(inode->i_mode) || !ext4_should_order_data(inode))
+		return 0;
+	if (ext4_test_inode_state(inode, EXT4_STATE_NEW) ||
+	    !list_empty(&EXT4_I(inode)->i_orphan))
+		return 0;
+	return ext4_has_inline_data(inode) ||
+	       ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS);
+}
+
+/*
+ * Fast commit @inode as of transaction @commit_tid.  Returns 0 once it is
+ * on stable storage, an error if fsync has to wait for the full commit.
+ */
+int ext4_fc_commit(struct inode *inode, tid_t commit_tid)
+{
+	struct super_block *sb = inode->i_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	journal_t *journal = sbi->s_journal;
+	int inode_len = EXT4_INODE_SIZE(sb);
+	struct ext4_inode *raw_inode;
+	struct ext4_fc_head *head;
+	struct buffer_head *bh;
+	struct ext4_iloc iloc;
+	int err;
+
+	if (!ext4_fc_inode_ok(inode) ||
+	    sizeof(*head) + inode_len > sb->s_blocksize) {
+		err = -EAGAIN;
+		goto fallback;
+	}
+
+	err = jbd2_fc_begin_commit(journal, commit_tid);
+	if (err == -EALREADY)
+		return err;	/* committed already, only the flush is left */
+	if (err)
+		goto fallback;
+
+	/* no handle may change the inode while we copy it */
+	jbd2_journal_lock_updates(journal);
+	err = -EAGAIN;
+	if (sbi->s_fc_ineligible_tid == commit_tid)
+		goto out_unlock;
+
+	err = ext4_get_inode_loc(inode, &iloc);
+	if (err)
+		goto out_unlock;
+	raw_inode = ext4_raw_inode(&iloc);
+	if (!ext4_fc_raw_inode_ok(raw_inode)) {
+		brelse(iloc.bh);
+		err = -EAGAIN;
+		goto out_unlock;
+	}
+
+	err = jbd2_fc_get_buf(journal, &bh);
+	if (err) {
+		brelse(iloc.bh);
+		goto out_unlock;
+	}
+	head = (struct ext4_fc_head *)bh->b_data;
+	head->fc_magic = cpu_to_le32(EXT4_FC_MAGIC);
+	head->fc_tid = cpu_to_le32(commit_tid);
+	head->fc_ino = cpu_to_le32(inode->i_ino);
+	head->fc_inode_len = cpu_to_le16(inode_len);
+	memcpy(head + 1, raw_inode, inode_len);
+	head->fc_crc = cpu_to_le32(ext4_fc_csum(sb, head));
+	brelse(iloc.bh);
+	jbd2_journal_unlock_updates(journal);
+
+	/*
+	 * data=ordered: writeback that allocated blocks for the copied
+	 * extents has submitted its pages, wait for them before the record
+	 * can point at the blocks.
+	 */
+	err = filemap_fdatawait(inode->i_mapping);
+	if (!err && journal->j_fs_dev != journal->j_dev &&
+	    (journal->j_flags & JBD2_BARRIER))
+		err = blkdev_issue_flush(journal->j_fs_dev, GFP_KERNEL, NULL);
+	if (!err) {
+		lock_buffer(bh);
+		clear_buffer_dirty(bh);
+		get_bh(bh);
+		bh->b_end_io = end_buffer_write_sync;
+		submit_bh(journal->j_flags & JBD2_BARRIER ?
+			  WRITE_FLUSH_FUA : WRITE_SYNC, bh);
+		wait_on_buffer(bh);
+		if (!buffer_uptodate(bh))
+			err = -EIO;
+	}
+	brelse(bh);
+	jbd2_fc_end_commit(journal);
+	if (err)
+		goto fallback;
+	sbi->s_fc_commits++;
+	return 0;
+
+out_unlock:
+	jbd2_journal_unlock_updates(journal);
+	jbd2_fc_end_commit(journal);
+fallback:
+	sbi->s_fc_fallbacks++;
+	return err;
+}
+
+/* Mark @count blocks from @block in use, as they were when committed. */
+static int ext4_fc_mark_blocks(handle_t *handle, struct super_block *sb,
+			       ext4_fsblk_t block, unsigned int count)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct buffer_head *bitmap_bh, *gdp_bh;
+	struct ext4_group_desc *gdp;
+	ext4_group_t group;
+	ext4_grpblk_t bit;
+	unsigned int i, len, set;
+	int err;
+
+	while (count) {
+		ext4_get_group_no_and_offset(sb, block, &group, &bit);
+		len = min_t(unsigned int, count,
+			    EXT4_BLOCKS_PER_GROUP(sb) - bit);
+
+		bitmap_bh = ext4_read_block_bitmap(sb, group);
+		gdp = ext4_get_group_desc(sb, group, &gdp_bh);
+		if (!bitmap_bh || !gdp) {
+			brelse(bitmap_bh);
+			return -EIO;
+		}
+		err = ext4_journal_get_write_access(handle, bitmap_bh);
+		if (!err)
+			err = ext4_journal_get_write_access(handle, gdp_bh);
+		if (err) {
+			brelse(bitmap_bh);
+			return err;
+		}
+
+		set = 0;
+		ext4_lock_group(sb, group);
+		if (gdp->bg_flags & cpu_to_le16(EXT4_BG_BLOCK_UNINIT)) {
+			gdp->bg_flags &= cpu_to_le16(~EXT4_BG_BLOCK_UNINIT);
+			ext4_free_blks_set(sb, gdp,
+				ext4_free_blocks_after_init(sb, group, gdp));
+		}
+		for (i = 0; i < len; i++)
+			if (!ext4_set_bit(bit + i, bitmap_bh->b_data))
+				set++;
+		ext4_free_blks_set(sb, gdp, ext4_free_blks_count(sb, gdp) - set);
+		gdp->bg_checksum = ext4_group_desc_csum(sbi, group, gdp);
+		/* nothing has loaded the buddy yet, it is built from the bitmap */
+		ext4_get_group_info(sb, group)->bb_free -= set;
+		ext4_unlock_group(sb, group);
+
+		percpu_counter_sub(&sbi->s_freeblocks_counter, set);
+		if (sbi->s_log_groups_per_flex)
+			atomic_sub(set, &sbi->s_flex_groups[
+					ext4_flex_group(sbi, group)].free_blocks);
+
+		err = ext4_handle_dirty_metadata(handle, NULL, bitmap_bh);
+		if (!err)
+			err = ext4_handle_dirty_metadata(handle, NULL, gdp_bh);
+		brelse(bitmap_bh);
+		if (err)
+			return err;
+
+		block += len;
+		count -= len;
+	}
+	return 0;
+}
+
+/*
+ * Check the extents of @raw_inode and count the groups they span, to size
+ * the replay handle.
+ */
+static int ext4_fc_extent_groups(struct super_block *sb,
+				 struct ext4_inode *raw_inode)
+{
+	struct ext4_extent_header *eh = (void *)raw_inode->i_block;
+	struct ext4_extent *ex = EXT_FIRST_EXTENT(eh);
+	ext4_group_t first, last;
+	ext4_grpblk_t offset;
+	ext4_fsblk_t block;
+	int i, len, groups = 0;
+
+	if (le32_to_cpu(raw_inode->i_flags) & EXT4_INLINE_DATA_FL)
+		return 0;
+	for (i = 0; i < le16_to_cpu(eh->eh_entries); i++, ex++) {
+		block = ext4_ext_pblock(ex);
+		len = ext4_ext_get_actual_len(ex);
+		if (!len || !ext4_data_block_valid(EXT4_SB(sb), block, len))
+			return -EIO;
+		ext4_get_group_no_and_offset(sb, block, &first, &offset);
+		ext4_get_group_no_and_offset(sb, block + len - 1,
+					     &last, &offset);
+		groups += last - first + 1;
+	}
+	return groups;
+}
+
+/* Replay the record in @bh.  Returns 1 if it was replayed, 0 at the end. */
+static int ext4_fc_replay_one(struct super_block *sb, struct buffer_head *bh)
+{
+	journal_t *journal = EXT4_SB(sb)->s_journal;
+	struct ext4_fc_head *head = (struct ext4_fc_head *)bh->b_data;
+	struct ext4_inode *raw_inode = (struct ext4_inode *)(head + 1);
+	struct ext4_extent_header *eh = (void *)raw_inode->i_block;
+	struct ext4_extent *ex;
+	struct ext4_iloc iloc;
+	struct inode *inode;
+	handle_t *handle;
+	unsigned long ino;
+	int i, groups, err;
+
+	if (le32_to_cpu(head->fc_magic) != EXT4_FC_MAGIC ||
+	    le32_to_cpu(head->fc_tid) != journal->j_fc_replay_tid ||
+	    le16_to_cpu(head->fc_inode_len) != EXT4_INODE_SIZE(sb) ||
+	    le32_to_cpu(head->fc_crc) != ext4_fc_csum(sb, head))
+		return 0;
+
+	ino = le32_to_cpu(head->fc_ino);
+	if (ino < EXT4_FIRST_INO(sb) ||
+	    ino > le32_to_cpu(EXT4_SB(sb)->s_es->s_inodes_count) ||
+	    !ext4_fc_raw_inode_ok(raw_inode))
+		return -EIO;
+	groups = ext4_fc_extent_groups(sb, raw_inode);
+	if (groups < 0)
+		return groups;
+
+	inode = ext4_iget(sb, ino);
+	if (IS_ERR(inode))
+		return PTR_ERR(inode);
+
+	handle = ext4_journal_start(inode, EXT4_FC_REPLAY_CREDITS(groups));
+	if (IS_ERR(handle)) {
+		err = PTR_ERR(handle);
+		goto out_iput;
+	}
+	err = ext4_get_inode_loc(inode, &iloc);
+	if (err)
+		goto out_stop;
+	err = ext4_journal_get_write_access(handle, iloc.bh);
+	if (!err) {
+		memcpy(ext4_raw_inode(&iloc), raw_inode,
+		       EXT4_INODE_SIZE(sb));
+		err = ext4_handle_dirty_metadata(handle, NULL, iloc.bh);
+	}
+	brelse(iloc.bh);
+
+	if (!(le32_to_cpu(raw_inode->i_flags) & EXT4_INLINE_DATA_FL)) {
+		ex = EXT_FIRST_EXTENT(eh);
+		for (i = 0; !err && i < le16_to_cpu(eh->eh_entries); i++, ex++)
+			err = ext4_fc_mark_blocks(handle, sb,
+					ext4_ext_pblock(ex),
+					ext4_ext_get_actual_len(ex));
+	}
+out_stop:
+	ext4_journal_stop(handle);
+out_iput:
+	/* not MS_ACTIVE yet: the stale in-core inode goes away with it */
+	iput(inode);
+	return err ? err : 1;
+}
+
+/*
+ * Replay the fast commits left behind by journal recovery.  Runs once at
+ * mount time, before orphan cleanup; the full commit at the end makes the
+ * records stale for good.
+ */
+void ext4_fc_replay(struct super_block *sb)
+{
+	journal_t *journal = EXT4_SB(sb)->s_journal;
+	unsigned int s_flags = sb->s_flags;
+	struct buffer_head *bh;
+	unsigned long off;
+	int err = 0, nr = 0;
+
+	if (!(journal->j_flags & JBD2_FC_REPLAY))
+		return;
+
+	write_lock(&journal->j_state_lock);
+	journal->j_flags &= ~JBD2_FC_REPLAY;
+	write_unlock(&journal->j_state_lock);
+
+	if (bdev_read_only(sb->s_bdev)) {
+		ext4_msg(sb, KERN_ERR, "write access unavailable, "
+			 "skipping fast commit replay");
+		return;
+	}
+
+	/* the fs may be mounted read-only, as for orphan cleanup */
+	sb->s_flags &= ~MS_RDONLY;
+	for (off = 0; ; off++) {
+		err = jbd2_fc_read_buf(journal, off, &bh);
+		if (err) {
+			if (err == -ENOENT)
+				err = 0;
+			break;
+		}
+		err = ext4_fc_replay_one(sb, bh);
+		brelse(bh);
+		if (err <= 0)
+			break;
+		nr++;
+	}
+	if (err)
+		ext4_msg(sb, KERN_ERR, "fast commit replay failed at "
+			 "block %lu: %d", off, err);
+	if (nr) {
+		ext4_msg(sb, KERN_INFO, "replayed %d fast commit%s",
+			 nr, nr == 1 ? "" : "s");
+		ext4_force_commit(sb);
+	}
+	sb->s_flags = s_flags;
+}
@@ -160,7 +160,8 @@ static int ext4_sync_parent(struct inode *inode)
  * state in the journalling system.
  *
  * What we do is just kick off a commit and wait on it.  This will snapshot the
- * inode to disk.
+ * inode to disk.  With the fast_commit option, a lone inode update is instead
+ * logged to the fast commit area, see fast_commit.c.
  *
  * i_mutex lock is held when entering and exiting this function
  */
@@ -212,6 +213,10 @@ int ext4_sync_file(struct file *file, int datasync)
 	}
 
 	commit_tid = datasync ? ei->i_datasync_tid : ei->i_sync_tid;
+	if (test_opt2(inode->i_sb, FAST_COMMIT) &&
+	    !ext4_fc_commit(inode, commit_tid))
+		goto out;
+
 	if (journal->j_flags & JBD2_BARRIER &&
 	    !jbd2_trans_will_send_data_barrier(journal, commit_tid))
 		needs_barrier = true;
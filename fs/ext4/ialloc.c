@@ -1059,6 +1059,14 @@ got:
 		}
 	}
 
+#ifdef CONFIG_EXT4_FS_XATTR
+	/* small regular files start out in the inode */
+	if (S_ISREG(mode) &&
+	    EXT4_HAS_INCOMPAT_FEATURE(sb, EXT4_FEATURE_INCOMPAT_INLINE_DATA) &&
+	    EXT4_INODE_SIZE(sb) > EXT4_GOOD_OLD_INODE_SIZE)
+		ext4_set_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+#endif
+
 	if (ext4_handle_valid(handle)) {
 		ei->i_sync_tid = handle->h_transaction->t_tid;
 		ei->i_datasync_tid = handle->h_transaction->t_tid;
@@ -0,0 +1,1175 @@
+/*
+ * linux/fs/ext4/inline.c
+ *
+ * Inline data for small files and directories
+ *
+ * A file small enough to fit in its inode keeps its data in i_block and,
+ * past the first EXT4_MIN_INLINE_DATA_SIZE bytes, in the value of the
+ * "system.data" in-inode extended attribute, instead of in a data block.
+ * This saves the block and the extra read for each of the many tiny files
+ * a typical Android /data partition holds.  Once a file outgrows the space
+ * left in its inode, the data is moved to a regular block and the inode
+ * goes back to extents (or block maps) for good.
+ *
+ * Symlinks too long for i_data and directories can be inline as well:
+ * symlinks are read through ->readpage() like regular files, inline
+ * directories are read in place and moved to a block before their first
+ * change, see below.
+ *
+ * The on-disk format is the one of the INCOMPAT_INLINE_DATA feature.
+ * Inline data is protected by xattr_sem, like the rest of the in-inode
+ * extended attributes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/fiemap.h>
+#include <linux/quotaops.h>
+#include <linux/slab.h>
+
+#include "ext4_jbd2.h"
+#include "ext4.h"
+#include "xattr.h"
+
+static struct ext4_xattr_entry *ext4_inline_entry(struct inode *inode,
+						  struct ext4_inode *raw_inode)
+{
+	return (void *)raw_inode + EXT4_I(inode)->i_inline_off;
+}
+
+static void *ext4_inline_value(struct inode *inode,
+			       struct ext4_inode *raw_inode)
+{
+	struct ext4_xattr_entry *entry = ext4_inline_entry(inode, raw_inode);
+
+	return (void *)IFIRST(IHDR(inode, raw_inode)) +
+		le16_to_cpu(entry->e_value_offs);
+}
+
+/*
+ * Bytes the system.data value could take in the in-inode EA area, counting
+ * what it takes already.  Negative if not even an empty entry fits.
+ */
+static int ext4_inline_xattr_space(struct inode *inode,
+				   struct ext4_iloc *iloc)
+{
+	struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
+	struct ext4_xattr_entry *entry;
+	int free, min_offs;
+
+	min_offs = EXT4_SB(inode->i_sb)->s_inode_size -
+		EXT4_GOOD_OLD_INODE_SIZE - EXT4_I(inode)->i_extra_isize -
+		sizeof(struct ext4_xattr_ibody_header);
+
+	entry = IFIRST(IHDR(inode, raw_inode));
+	if (ext4_test_inode_state(inode, EXT4_STATE_XATTR)) {
+		for (; !IS_LAST_ENTRY(entry); entry = EXT4_XATTR_NEXT(entry)) {
+			if (!entry->e_value_block && entry->e_value_size) {
+				int offs = le16_to_cpu(entry->e_value_offs);
+
+				if (offs < min_offs)
+					min_offs = offs;
+			}
+		}
+	}
+	/* the entries are terminated by four zero bytes */
+	free = min_offs - ((void *)entry - (void *)IFIRST(IHDR(inode,
+				raw_inode))) - sizeof(__u32);
+
+	if (EXT4_I(inode)->i_inline_off) {
+		entry = ext4_inline_entry(inode, raw_inode);
+		free += EXT4_XATTR_SIZE(le32_to_cpu(entry->e_value_size));
+	} else {
+		free -= EXT4_XATTR_LEN(strlen(EXT4_XATTR_SYSTEM_DATA));
+	}
+	return free < 0 ? free : free & ~EXT4_XATTR_ROUND;
+}
+
+static int __ext4_get_max_inline_size(struct inode *inode,
+				      struct ext4_iloc *iloc)
+{
+	int free;
+
+	if (EXT4_I(inode)->i_extra_isize == 0)
+		return 0;
+	free = ext4_inline_xattr_space(inode, iloc);
+	if (free < 0)
+		return 0;
+	return EXT4_MIN_INLINE_DATA_SIZE + free;
+}
+
+/*
+ * ext4_get_max_inline_size - largest file @inode could keep inline
+ *
+ * Returns 0 if the inode has no room for inline data at all.
+ */
+int ext4_get_max_inline_size(struct inode *inode)
+{
+	struct ext4_iloc iloc;
+	int max_size;
+
+	if (EXT4_I(inode)->i_extra_isize == 0)
+		return 0;
+	if (ext4_get_inode_loc(inode, &iloc))
+		return 0;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	max_size = __ext4_get_max_inline_size(inode, &iloc);
+	up_read(&EXT4_I(inode)->xattr_sem);
+
+	brelse(iloc.bh);
+	return max_size;
+}
+
+/*
+ * ext4_find_inline_data_nolock - look up the system.data entry of @inode
+ *
+ * Called when the inode is read in, before anybody else can see it.
+ */
+int ext4_find_inline_data_nolock(struct inode *inode)
+{
+	struct ext4_xattr_ibody_find is = {
+		.s = { .not_found = -ENODATA, },
+	};
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+	};
+	int error;
+
+	if (EXT4_I(inode)->i_extra_isize == 0)
+		return 0;
+
+	error = ext4_get_inode_loc(inode, &is.iloc);
+	if (error)
+		return error;
+
+	error = ext4_xattr_ibody_find(inode, &i, &is);
+	if (error)
+		goto out;
+
+	if (!is.s.not_found) {
+		EXT4_I(inode)->i_inline_off = (void *)is.s.here -
+			(void *)ext4_raw_inode(&is.iloc);
+		EXT4_I(inode)->i_inline_size = EXT4_MIN_INLINE_DATA_SIZE +
+			le32_to_cpu(is.s.here->e_value_size);
+		ext4_set_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+	}
+out:
+	brelse(is.iloc.bh);
+	return error;
+}
+
+/*
+ * Inline data is changed under xattr_sem, and ext4_mark_inode_dirty()
+ * must not try to expand i_extra_isize meanwhile: that takes xattr_sem
+ * itself.  See ext4_xattr_set_handle().
+ */
+static void ext4_write_lock_xattr(struct inode *inode, int *no_expand)
+{
+	down_write(&EXT4_I(inode)->xattr_sem);
+	*no_expand = ext4_test_inode_state(inode, EXT4_STATE_NO_EXPAND);
+	ext4_set_inode_state(inode, EXT4_STATE_NO_EXPAND);
+}
+
+static void ext4_write_unlock_xattr(struct inode *inode, int *no_expand)
+{
+	if (!*no_expand)
+		ext4_clear_inode_state(inode, EXT4_STATE_NO_EXPAND);
+	up_write(&EXT4_I(inode)->xattr_sem);
+}
+
+static void ext4_read_inline_data(struct inode *inode, void *buffer,
+				  unsigned int len, struct ext4_iloc *iloc)
+{
+	struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
+	unsigned int cp_len;
+
+	BUG_ON(len > EXT4_I(inode)->i_inline_size);
+
+	cp_len = min_t(unsigned int, len, EXT4_MIN_INLINE_DATA_SIZE);
+	memcpy(buffer, (void *)raw_inode->i_block, cp_len);
+	if (len > cp_len)
+		memcpy(buffer + cp_len, ext4_inline_value(inode, raw_inode),
+		       len - cp_len);
+}
+
+/* The caller has write access to iloc->bh and holds xattr_sem. */
+static void ext4_write_inline_data(struct inode *inode, struct ext4_iloc *iloc,
+				   void *buffer, loff_t pos, unsigned int len)
+{
+	struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
+	unsigned int cp_len;
+
+	BUG_ON(!EXT4_I(inode)->i_inline_off);
+	BUG_ON(pos + len > EXT4_I(inode)->i_inline_size);
+
+	if (pos < EXT4_MIN_INLINE_DATA_SIZE) {
+		cp_len = min_t(unsigned int, len,
+			       EXT4_MIN_INLINE_DATA_SIZE - pos);
+		memcpy((void *)raw_inode->i_block + pos, buffer, cp_len);
+		buffer += cp_len;
+		pos += cp_len;
+		len -= cp_len;
+	}
+	if (len)
+		memcpy(ext4_inline_value(inode, raw_inode) +
+		       pos - EXT4_MIN_INLINE_DATA_SIZE, buffer, len);
+}
+
+/*
+ * Make room for exactly @len bytes of inline data, creating the system.data
+ * entry if needed.  Bytes below @len are kept, the others are zeroed.
+ * The caller has write access to iloc->bh and holds xattr_sem for writing.
+ */
+static int ext4_set_inline_data_size(handle_t *handle, struct inode *inode,
+				     struct ext4_iloc *iloc, unsigned int len)
+{
+	struct ext4_xattr_ibody_find is = {
+		.s = { .not_found = -ENODATA, },
+		.iloc = *iloc,
+	};
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+	};
+	struct ext4_inode *raw_inode = ext4_raw_inode(iloc);
+	void *value;
+	int error;
+
+	error = ext4_xattr_ibody_find(inode, &i, &is);
+	if (error)
+		return error;
+
+	if (len > EXT4_MIN_INLINE_DATA_SIZE)
+		i.value_len = len - EXT4_MIN_INLINE_DATA_SIZE;
+	value = kzalloc(i.value_len + 1, GFP_NOFS);
+	if (!value)
+		return -ENOMEM;
+	if (!is.s.not_found)
+		memcpy(value, is.s.base + le16_to_cpu(is.s.here->e_value_offs),
+		       min_t(size_t, i.value_len,
+			     le32_to_cpu(is.s.here->e_value_size)));
+	i.value = value;
+
+	error = ext4_xattr_ibody_set(handle, inode, &i, &is);
+	if (error)
+		goto out;
+
+	if (len < EXT4_MIN_INLINE_DATA_SIZE)
+		memset((void *)raw_inode->i_block + len, 0,
+		       EXT4_MIN_INLINE_DATA_SIZE - len);
+	EXT4_I(inode)->i_inline_off = (void *)is.s.here - (void *)raw_inode;
+	EXT4_I(inode)->i_inline_size = EXT4_MIN_INLINE_DATA_SIZE + i.value_len;
+out:
+	kfree(value);
+	return error;
+}
+
+/*
+ * Make sure @inode can hold @len bytes inline, turning an empty file into
+ * an inline one.  Returns -ENOSPC if the data has to go to a block.
+ */
+static int ext4_prepare_inline_data(handle_t *handle, struct inode *inode,
+				    unsigned int len)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_iloc iloc;
+	int error, no_expand;
+
+	error = ext4_get_inode_loc(inode, &iloc);
+	if (error)
+		return error;
+
+	ext4_write_lock_xattr(inode, &no_expand);
+	if (len > __ext4_get_max_inline_size(inode, &iloc)) {
+		error = -ENOSPC;
+		goto out;
+	}
+	if (ext4_has_inline_data(inode) && len <= ei->i_inline_size)
+		goto out;
+
+	error = ext4_journal_get_write_access(handle, iloc.bh);
+	if (error)
+		goto out;
+
+	if (!ext4_has_inline_data(inode)) {
+		struct ext4_inode *raw_inode = ext4_raw_inode(&iloc);
+
+		/* see ext4_xattr_set_handle() */
+		if (ext4_test_inode_state(inode, EXT4_STATE_NEW)) {
+			memset(raw_inode, 0, EXT4_SB(inode->i_sb)->s_inode_size);
+			ext4_clear_inode_state(inode, EXT4_STATE_NEW);
+		}
+		memset((void *)raw_inode->i_block, 0,
+		       EXT4_MIN_INLINE_DATA_SIZE);
+		error = ext4_set_inline_data_size(handle, inode, &iloc, len);
+		if (error)
+			goto out;
+		memset(ei->i_data, 0, sizeof(ei->i_data));
+		ext4_clear_inode_flag(inode, EXT4_INODE_EXTENTS);
+		ext4_set_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+	} else {
+		error = ext4_set_inline_data_size(handle, inode, &iloc, len);
+		if (error)
+			goto out;
+	}
+
+	get_bh(iloc.bh);
+	error = ext4_mark_iloc_dirty(handle, inode, &iloc);
+out:
+	ext4_write_unlock_xattr(inode, &no_expand);
+	brelse(iloc.bh);
+	return error;
+}
+
+/*
+ * Drop the inline data of @inode and give it an empty extent tree (or
+ * block map) instead.  The caller holds xattr_sem for writing.
+ */
+static int ext4_destroy_inline_data_nolock(handle_t *handle,
+					   struct inode *inode)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_xattr_ibody_find is = {
+		.s = { .not_found = 0, },
+	};
+	struct ext4_xattr_info i = {
+		.name_index = EXT4_XATTR_INDEX_SYSTEM,
+		.name = EXT4_XATTR_SYSTEM_DATA,
+		.value = NULL,
+		.value_len = 0,
+	};
+	int error;
+
+	if (!ei->i_inline_off)
+		return 0;
+
+	error = ext4_get_inode_loc(inode, &is.iloc);
+	if (error)
+		return error;
+
+	error = ext4_xattr_ibody_find(inode, &i, &is);
+	if (error)
+		goto out;
+
+	error = ext4_journal_get_write_access(handle, is.iloc.bh);
+	if (error)
+		goto out;
+
+	error = ext4_xattr_ibody_set(handle, inode, &i, &is);
+	if (error)
+		goto out;
+
+	memset((void *)ext4_raw_inode(&is.iloc)->i_block, 0,
+	       EXT4_MIN_INLINE_DATA_SIZE);
+	memset(ei->i_data, 0, sizeof(ei->i_data));
+
+	if (EXT4_HAS_INCOMPAT_FEATURE(inode->i_sb,
+				      EXT4_FEATURE_INCOMPAT_EXTENTS)) {
+		ext4_set_inode_flag(inode, EXT4_INODE_EXTENTS);
+		ext4_ext_tree_init(handle, inode);
+	}
+	ext4_clear_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+
+	get_bh(is.iloc.bh);
+	error = ext4_mark_iloc_dirty(handle, inode, &is.iloc);
+
+	ei->i_inline_off = 0;
+	ei->i_inline_size = 0;
+	ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+out:
+	brelse(is.iloc.bh);
+	return error;
+}
+
+/*
+ * Put back the @len bytes of inline data in @buf after a failed attempt
+ * to move them to a block.  The caller holds xattr_sem for writing.
+ */
+static void ext4_restore_inline_data(handle_t *handle, struct inode *inode,
+				     struct ext4_iloc *iloc, void *buf,
+				     unsigned int len)
+{
+	int err;
+
+	err = ext4_journal_get_write_access(handle, iloc->bh);
+	if (!err) {
+		memset((void *)ext4_raw_inode(iloc)->i_block, 0,
+		       EXT4_MIN_INLINE_DATA_SIZE);
+		err = ext4_set_inline_data_size(handle, inode, iloc, len);
+	}
+	if (!err) {
+		memset(EXT4_I(inode)->i_data, 0, sizeof(EXT4_I(inode)->i_data));
+		ext4_clear_inode_flag(inode, EXT4_INODE_EXTENTS);
+		ext4_set_inode_flag(inode, EXT4_INODE_INLINE_DATA);
+		ext4_write_inline_data(inode, iloc, buf, 0, len);
+		ext4_set_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+		get_bh(iloc->bh);
+		err = ext4_mark_iloc_dirty(handle, inode, iloc);
+	}
+	if (err)
+		ext4_std_error(inode->i_sb, err);
+}
+
+/* Fill page 0 from the inline data.  The caller holds xattr_sem. */
+static int ext4_read_inline_page(struct inode *inode, struct page *page)
+{
+	struct ext4_iloc iloc;
+	unsigned int len;
+	void *kaddr;
+	int ret;
+
+	BUG_ON(page->index);
+
+	ret = ext4_get_inode_loc(inode, &iloc);
+	if (ret)
+		return ret;
+
+	len = min_t(loff_t, EXT4_I(inode)->i_inline_size, i_size_read(inode));
+	kaddr = kmap_atomic(page, KM_USER0);
+	ext4_read_inline_data(inode, kaddr, len, &iloc);
+	memset(kaddr + len, 0, PAGE_CACHE_SIZE - len);
+	flush_dcache_page(page);
+	kunmap_atomic(kaddr, KM_USER0);
+	SetPageUptodate(page);
+
+	brelse(iloc.bh);
+	return 0;
+}
+
+/*
+ * ext4_readpage_inline - ->readpage() for inline files
+ *
+ * Returns -EAGAIN if the inode no longer has inline data.
+ */
+int ext4_readpage_inline(struct inode *inode, struct page *page)
+{
+	int ret = 0;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	if (!ext4_has_inline_data(inode)) {
+		up_read(&EXT4_I(inode)->xattr_sem);
+		return -EAGAIN;
+	}
+
+	/* only page 0 has data, the others are past the end of it */
+	if (!page->index)
+		ret = ext4_read_inline_page(inode, page);
+	else if (!PageUptodate(page)) {
+		zero_user_segment(page, 0, PAGE_CACHE_SIZE);
+		SetPageUptodate(page);
+	}
+	up_read(&EXT4_I(inode)->xattr_sem);
+
+	unlock_page(page);
+	return ret;
+}
+
+/*
+ * Move the inline data of @inode to a newly allocated block, through page 0
+ * of @mapping.  If no block can be allocated, the data stays inline.
+ */
+static int ext4_convert_inline_data_to_extent(struct address_space *mapping,
+					      struct inode *inode,
+					      unsigned flags)
+{
+	struct ext4_iloc iloc;
+	handle_t *handle;
+	struct page *page;
+	unsigned int inline_size, to;
+	void *buf = NULL;
+	int ret, retries = 0, no_expand;
+
+	if (!ext4_has_inline_data(inode)) {
+		ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+		return 0;
+	}
+
+retry:
+	handle = ext4_journal_start(inode, ext4_writepage_trans_blocks(inode));
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	/* We cannot recurse into the filesystem as the transaction is already
+	 * started */
+	flags |= AOP_FLAG_NOFS;
+
+	page = grab_cache_page_write_begin(mapping, 0, flags);
+	if (!page) {
+		ext4_journal_stop(handle);
+		return -ENOMEM;
+	}
+
+	ext4_write_lock_xattr(inode, &no_expand);
+	/* somebody may have done it for us */
+	if (!ext4_has_inline_data(inode)) {
+		ret = 0;
+		goto out;
+	}
+
+	ret = ext4_get_inode_loc(inode, &iloc);
+	if (ret)
+		goto out;
+	inline_size = EXT4_I(inode)->i_inline_size;
+	buf = kmalloc(inline_size, GFP_NOFS);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out_brelse;
+	}
+	ext4_read_inline_data(inode, buf, inline_size, &iloc);
+
+	if (!PageUptodate(page)) {
+		ret = ext4_read_inline_page(inode, page);
+		if (ret)
+			goto out_brelse;
+	}
+
+	ret = ext4_destroy_inline_data_nolock(handle, inode);
+	if (ret)
+		goto out_brelse;
+
+	to = min_t(loff_t, inline_size, i_size_read(inode));
+	if (to) {
+		ret = __block_write_begin(page, 0, to, ext4_get_block);
+		if (ret) {
+			ext4_restore_inline_data(handle, inode, &iloc, buf,
+						 inline_size);
+			goto out_brelse;
+		}
+		block_commit_write(page, 0, to);
+		if (ext4_should_order_data(inode))
+			ret = ext4_jbd2_file_inode(handle, inode);
+	}
+
+out_brelse:
+	brelse(iloc.bh);
+out:
+	ext4_write_unlock_xattr(inode, &no_expand);
+	unlock_page(page);
+	page_cache_release(page);
+	ext4_journal_stop(handle);
+	kfree(buf);
+	buf = NULL;
+
+	if (ret == -ENOSPC && ext4_should_retry_alloc(inode->i_sb, &retries))
+		goto retry;
+	return ret;
+}
+
+/*
+ * ext4_convert_inline_data - move the data of @inode out of the inode
+ *
+ * For the paths that need real blocks: page faults, fallocate.
+ */
+int ext4_convert_inline_data(struct inode *inode)
+{
+	return ext4_convert_inline_data_to_extent(inode->i_mapping, inode, 0);
+}
+
+/*
+ * ext4_try_to_write_inline_data - ->write_begin() for inline files
+ *
+ * Returns 1 with page 0 locked in *pagep and a running handle if the
+ * write fits in the inode, 0 if the caller has to go on with a regular
+ * block write (the data has been moved out of the inode then), or a
+ * negative error.
+ */
+int ext4_try_to_write_inline_data(struct address_space *mapping,
+				  struct inode *inode,
+				  loff_t pos, unsigned len,
+				  unsigned flags,
+				  struct page **pagep)
+{
+	handle_t *handle;
+	struct page *page;
+	int ret;
+
+	/* journalled data goes through the page buffers */
+	if (ext4_should_journal_data(inode) ||
+	    pos + len > ext4_get_max_inline_size(inode))
+		goto convert;
+
+	handle = ext4_journal_start(inode, 1);
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	ret = ext4_prepare_inline_data(handle, inode, pos + len);
+	if (ret == -ENOSPC) {
+		ext4_journal_stop(handle);
+		goto convert;
+	}
+	if (ret)
+		goto out;
+
+	flags |= AOP_FLAG_NOFS;
+
+	page = grab_cache_page_write_begin(mapping, 0, flags);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	/* a page fault may have moved the data out in the meantime */
+	if (!ext4_has_inline_data(inode)) {
+		ret = 0;
+		goto out_release;
+	}
+	if (!PageUptodate(page)) {
+		ret = ext4_read_inline_page(inode, page);
+		if (ret < 0)
+			goto out_release;
+	}
+	up_read(&EXT4_I(inode)->xattr_sem);
+
+	*pagep = page;
+	return 1;
+
+out_release:
+	up_read(&EXT4_I(inode)->xattr_sem);
+	unlock_page(page);
+	page_cache_release(page);
+out:
+	ext4_journal_stop(handle);
+	return ret;
+
+convert:
+	return ext4_convert_inline_data_to_extent(mapping, inode, flags);
+}
+
+/*
+ * ext4_write_inline_data_end - copy a write set up by
+ * ext4_try_to_write_inline_data() into the inode
+ *
+ * Returns the number of bytes written.  The caller updates i_size and
+ * stops the handle.
+ */
+int ext4_write_inline_data_end(struct inode *inode, loff_t pos, unsigned len,
+			       unsigned copied, struct page *page)
+{
+	handle_t *handle = ext4_journal_current_handle();
+	struct ext4_iloc iloc;
+	void *kaddr;
+	int ret, no_expand;
+
+	if (unlikely(copied < len) && !PageUptodate(page))
+		return 0;
+
+	ret = ext4_get_inode_loc(inode, &iloc);
+	if (!ret)
+		ret = ext4_journal_get_write_access(handle, iloc.bh);
+	if (ret) {
+		brelse(iloc.bh);
+		ext4_std_error(inode->i_sb, ret);
+		return 0;
+	}
+
+	ext4_write_lock_xattr(inode, &no_expand);
+	BUG_ON(!ext4_has_inline_data(inode));
+	kaddr = kmap_atomic(page, KM_USER0);
+	ext4_write_inline_data(inode, &iloc, kaddr + pos, pos, copied);
+	kunmap_atomic(kaddr, KM_USER0);
+	SetPageUptodate(page);
+	ext4_write_unlock_xattr(inode, &no_expand);
+
+	ret = ext4_mark_iloc_dirty(handle, inode, &iloc);
+	if (ret) {
+		ext4_std_error(inode->i_sb, ret);
+		return 0;
+	}
+	return copied;
+}
+
+/*
+ * ext4_inline_data_truncate - ->truncate() for inline files
+ *
+ * Clears *has_inline if the inode turns out to have no inline data, so
+ * that ext4_truncate() goes on with the blocks.
+ */
+void ext4_inline_data_truncate(struct inode *inode, int *has_inline)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_iloc iloc;
+	handle_t *handle;
+	int err, no_expand;
+
+	handle = ext4_journal_start(inode, ext4_writepage_trans_blocks(inode));
+	if (IS_ERR(handle)) {
+		ext4_std_error(inode->i_sb, PTR_ERR(handle));
+		return;
+	}
+
+	ext4_write_lock_xattr(inode, &no_expand);
+	if (!ext4_has_inline_data(inode)) {
+		ext4_write_unlock_xattr(inode, &no_expand);
+		ext4_journal_stop(handle);
+		*has_inline = 0;
+		return;
+	}
+
+	err = ext4_get_inode_loc(inode, &iloc);
+	if (err)
+		goto out;
+	err = ext4_journal_get_write_access(handle, iloc.bh);
+	if (!err && inode->i_size < ei->i_inline_size)
+		err = ext4_set_inline_data_size(handle, inode, &iloc,
+						inode->i_size);
+	if (err) {
+		brelse(iloc.bh);
+		goto out;
+	}
+
+	ei->i_disksize = inode->i_size;
+	inode->i_mtime = inode->i_ctime = ext4_current_time(inode);
+	err = ext4_mark_iloc_dirty(handle, inode, &iloc);
+	if (IS_SYNC(inode))
+		ext4_handle_sync(handle);
+out:
+	ext4_write_unlock_xattr(inode, &no_expand);
+	if (err)
+		ext4_std_error(inode->i_sb, err);
+
+	/* see ext4_truncate() */
+	if (inode->i_nlink)
+		ext4_orphan_del(handle, inode);
+	ext4_journal_stop(handle);
+}
+
+/*
+ * ext4_inline_data_fiemap - report the inline data as one extent
+ *
+ * The physical address is the byte address of i_block on the device.
+ */
+int ext4_inline_data_fiemap(struct inode *inode,
+			    struct fiemap_extent_info *fieinfo,
+			    int *has_inline)
+{
+	__u32 flags = FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_NOT_ALIGNED |
+		      FIEMAP_EXTENT_LAST;
+	struct ext4_iloc iloc;
+	__u64 physical, length;
+	int error = 0;
+
+	down_read(&EXT4_I(inode)->xattr_sem);
+	if (!ext4_has_inline_data(inode)) {
+		*has_inline = 0;
+		goto out;
+	}
+
+	length = min_t(__u64, EXT4_I(inode)->i_inline_size,
+		       i_size_read(inode));
+	if (!length)
+		goto out;
+
+	error = ext4_get_inode_loc(inode, &iloc);
+	if (error)
+		goto out;
+	physical = (__u64)iloc.bh->b_blocknr << inode->i_sb->s_blocksize_bits;
+	physical += (char *)ext4_raw_inode(&iloc) - iloc.bh->b_data;
+	physical += offsetof(struct ext4_inode, i_block);
+	brelse(iloc.bh);
+
+	error = fiemap_fill_next_extent(fieinfo, 0, physical, length, flags);
+	if (error > 0)
+		error = 0;
+out:
+	up_read(&EXT4_I(inode)->xattr_sem);
+	return error;
+}
+
+/*
+ * Inline directories
+ *
+ * The inline data of a directory starts with the inode number of its
+ * parent, followed by the entries.  Their record lengths run up to the end
+ * of i_block, and again from there to the end of the system.data value;
+ * there are no "." and ".." entries.  This kernel reads such directories
+ * in place, and moves them to a block with the usual "." and ".." in
+ * front before the first change to them, so that namei.c only ever
+ * modifies block directories.
+ */
+
+/*
+ * ext4_check_inline_dirent - check the entry at @offset of an inline
+ * directory with @size bytes of inline data
+ *
+ * Returns 0 if the entry is sane, 1 after reporting the error.
+ */
+int ext4_check_inline_dirent(struct inode *dir, struct ext4_dir_entry_2 *de,
+			     unsigned int offset, unsigned int size)
+{
+	unsigned int end = offset < EXT4_MIN_INLINE_DATA_SIZE ?
+			   EXT4_MIN_INLINE_DATA_SIZE : size;
+	unsigned int rlen = 0;
+	const char *error_msg = NULL;
+
+	if (offset + EXT4_DIR_REC_LEN(1) > end)
+		error_msg = "entry past the end of its run";
+	else {
+		rlen = ext4_rec_len_from_disk(de->rec_len,
+					      dir->i_sb->s_blocksize);
+		if (rlen < EXT4_DIR_REC_LEN(1))
+			error_msg = "rec_len is smaller than minimal";
+		else if (rlen % 4 != 0)
+			error_msg = "rec_len % 4 != 0";
+		else if (rlen < EXT4_DIR_REC_LEN(de->name_len))
+			error_msg = "rec_len is too small for name_len";
+		else if (offset + rlen > end)
+			error_msg = "directory entry across runs";
+		else if (le32_to_cpu(de->inode) >
+			 le32_to_cpu(EXT4_SB(dir->i_sb)->s_es->s_inodes_count))
+			error_msg = "inode out of bounds";
+		else
+			return 0;
+	}
+
+	EXT4_ERROR_INODE(dir, "bad inline directory entry: %s - offset=%u, "
+			 "inode=%u, rec_len=%u, size=%u", error_msg, offset,
+			 le32_to_cpu(de->inode), rlen, size);
+	return 1;
+}
+
+/*
+ * ext4_get_inline_dir_data - copy the inline data of @dir
+ *
+ * Returns the number of bytes copied to *bufp, which the caller frees,
+ * 0 if @dir has no inline data, or a negative error.
+ */
+int ext4_get_inline_dir_data(struct inode *dir, void **bufp)
+{
+	struct ext4_iloc iloc;
+	int ret;
+
+	down_read(&EXT4_I(dir)->xattr_sem);
+	if (!ext4_has_inline_data(dir)) {
+		ret = 0;
+		goto out;
+	}
+	ret = ext4_get_inode_loc(dir, &iloc);
+	if (ret)
+		goto out;
+
+	ret = EXT4_I(dir)->i_inline_size;
+	*bufp = kmalloc(ret, GFP_NOFS);
+	if (*bufp)
+		ext4_read_inline_data(dir, *bufp, ret, &iloc);
+	else
+		ret = -ENOMEM;
+	brelse(iloc.bh);
+out:
+	up_read(&EXT4_I(dir)->xattr_sem);
+	return ret;
+}
+
+/*
+ * Look for @d_name in the entries between @offset and @end; the entry at
+ * offset x is at @base + x.  Returns 1 if found, 0 if not, -1 if the
+ * directory is corrupted.
+ */
+static int ext4_search_inline_dir(struct inode *dir, const struct qstr *d_name,
+				  void *base, unsigned int offset,
+				  unsigned int end, unsigned int size,
+				  struct ext4_dir_entry_2 **res_dir)
+{
+	struct ext4_dir_entry_2 *de;
+
+	while (offset < end) {
+		de = base + offset;
+		if (ext4_check_inline_dirent(dir, de, offset, size))
+			return -1;
+		if (de->inode && de->name_len == d_name->len &&
+		    !memcmp(de->name, d_name->name, d_name->len)) {
+			*res_dir = de;
+			return 1;
+		}
+		offset += ext4_rec_len_from_disk(de->rec_len,
+						 dir->i_sb->s_blocksize);
+	}
+	return 0;
+}
+
+/*
+ * ext4_find_inline_entry - ext4_find_entry() for inline directories
+ *
+ * Returns the buffer of the inode table block, with *res_dir pointing
+ * into it, or NULL.  *has_inline is cleared if @dir is not inline.
+ */
+struct buffer_head *ext4_find_inline_entry(struct inode *dir,
+					   const struct qstr *d_name,
+					   struct ext4_dir_entry_2 **res_dir,
+					   int *has_inline)
+{
+	struct ext4_inode_info *ei = EXT4_I(dir);
+	struct ext4_inode *raw_inode;
+	struct ext4_iloc iloc;
+	int ret;
+
+	down_read(&ei->xattr_sem);
+	if (!ext4_has_inline_data(dir)) {
+		*has_inline = 0;
+		up_read(&ei->xattr_sem);
+		return NULL;
+	}
+	if (ext4_get_inode_loc(dir, &iloc)) {
+		up_read(&ei->xattr_sem);
+		return NULL;
+	}
+
+	raw_inode = ext4_raw_inode(&iloc);
+	ret = ext4_search_inline_dir(dir, d_name, raw_inode->i_block,
+				     EXT4_INLINE_DOTDOT_SIZE,
+				     EXT4_MIN_INLINE_DATA_SIZE,
+				     ei->i_inline_size, res_dir);
+	if (!ret && ei->i_inline_size > EXT4_MIN_INLINE_DATA_SIZE)
+		ret = ext4_search_inline_dir(dir, d_name,
+				ext4_inline_value(dir, raw_inode) -
+				EXT4_MIN_INLINE_DATA_SIZE,
+				EXT4_MIN_INLINE_DATA_SIZE, ei->i_inline_size,
+				ei->i_inline_size, res_dir);
+	up_read(&ei->xattr_sem);
+
+	if (ret == 1)
+		return iloc.bh;
+	brelse(iloc.bh);
+	return NULL;
+}
+
+/*
+ * ext4_empty_inline_dir - empty_dir() for inline directories
+ *
+ * *has_inline is cleared if @dir is not inline.
+ */
+int ext4_empty_inline_dir(struct inode *dir, int *has_inline)
+{
+	struct ext4_dir_entry_2 *de;
+	unsigned int offset;
+	void *buf = NULL;
+	int size, ret = 1;
+
+	size = ext4_get_inline_dir_data(dir, &buf);
+	if (size <= 0) {
+		if (!size)
+			*has_inline = 0;
+		return 1;
+	}
+
+	for (offset = EXT4_INLINE_DOTDOT_SIZE; offset < size;
+	     offset += ext4_rec_len_from_disk(de->rec_len,
+					      dir->i_sb->s_blocksize)) {
+		de = buf + offset;
+		if (ext4_check_inline_dirent(dir, de, offset, size))
+			break;
+		if (le32_to_cpu(de->inode)) {
+			ret = 0;
+			break;
+		}
+	}
+	kfree(buf);
+	return ret;
+}
+
+/*
+ * ext4_inline_dir_parent - get the parent of inline directory @dir
+ *
+ * Returns 1 with the inode number in *ino, 0 if @dir is not inline, or a
+ * negative error.
+ */
+int ext4_inline_dir_parent(struct inode *dir, __u32 *ino)
+{
+	struct ext4_iloc iloc;
+	int ret;
+
+	down_read(&EXT4_I(dir)->xattr_sem);
+	if (!ext4_has_inline_data(dir)) {
+		ret = 0;
+		goto out;
+	}
+	ret = ext4_get_inode_loc(dir, &iloc);
+	if (ret)
+		goto out;
+	*ino = le32_to_cpu(ext4_raw_inode(&iloc)->i_block[0]);
+	brelse(iloc.bh);
+	ret = 1;
+out:
+	up_read(&EXT4_I(dir)->xattr_sem);
+	return ret;
+}
+
+/*
+ * ext4_inline_dir_set_parent - make @ino the parent of inline directory
+ * @dir, for rename
+ *
+ * The caller does not hold the i_mutex of @dir, which may have been moved
+ * to a block meanwhile: returns 1 if done, 0 if @dir is not inline (any
+ * more), or a negative error.
+ */
+int ext4_inline_dir_set_parent(handle_t *handle, struct inode *dir, __u32 ino)
+{
+	struct ext4_iloc iloc;
+	int ret, no_expand;
+
+	ext4_write_lock_xattr(dir, &no_expand);
+	if (!ext4_has_inline_data(dir)) {
+		ret = 0;
+		goto out;
+	}
+	ret = ext4_get_inode_loc(dir, &iloc);
+	if (ret)
+		goto out;
+	ret = ext4_journal_get_write_access(handle, iloc.bh);
+	if (ret) {
+		brelse(iloc.bh);
+		goto out;
+	}
+	ext4_raw_inode(&iloc)->i_block[0] = cpu_to_le32(ino);
+	ret = ext4_mark_iloc_dirty(handle, dir, &iloc);
+	if (!ret)
+		ret = 1;
+out:
+	ext4_write_unlock_xattr(dir, &no_expand);
+	return ret;
+}
+
+static void ext4_init_dirent(struct super_block *sb,
+			     struct ext4_dir_entry_2 *de, __u32 ino,
+			     const char *name, int name_len)
+{
+	de->inode = cpu_to_le32(ino);
+	de->name_len = name_len;
+	de->rec_len = ext4_rec_len_to_disk(EXT4_DIR_REC_LEN(name_len),
+					   sb->s_blocksize);
+	memcpy(de->name, name, name_len);
+	de->file_type = 0;
+	if (EXT4_HAS_INCOMPAT_FEATURE(sb, EXT4_FEATURE_INCOMPAT_FILETYPE))
+		de->file_type = EXT4_FT_DIR;
+}
+
+/*
+ * Fill the first block of @dir from the inline data in @buf: "." and
+ * "..", then the live entries packed, the last one taking up the rest
+ * of the block.
+ */
+static void ext4_fill_dir_block(struct inode *dir, void *buf,
+				unsigned int size, char *block)
+{
+	unsigned int blocksize = dir->i_sb->s_blocksize;
+	struct ext4_dir_entry_2 *de, *src;
+	unsigned int offset, len;
+
+	de = (struct ext4_dir_entry_2 *)block;
+	ext4_init_dirent(dir->i_sb, de, dir->i_ino, ".", 1);
+	de = (void *)de + EXT4_DIR_REC_LEN(1);
+	ext4_init_dirent(dir->i_sb, de, le32_to_cpu(*(__le32 *)buf), "..", 2);
+
+	for (offset = EXT4_INLINE_DOTDOT_SIZE; offset < size;
+	     offset += ext4_rec_len_from_disk(src->rec_len, blocksize)) {
+		src = buf + offset;
+		if (!src->inode)
+			continue;
+		de = (void *)de + ext4_rec_len_from_disk(de->rec_len,
+							  blocksize);
+		len = EXT4_DIR_REC_LEN(src->name_len);
+		memcpy(de, src, len);
+		de->rec_len = ext4_rec_len_to_disk(len, blocksize);
+	}
+	de->rec_len = ext4_rec_len_to_disk(block + blocksize - (char *)de,
+					   blocksize);
+}
+
+/*
+ * ext4_convert_inline_dir - move the entries of @dir to a block
+ *
+ * Called by namei.c with the i_mutex of @dir held and no transaction
+ * running, before any change to the directory.
+ */
+int ext4_convert_inline_dir(struct inode *dir)
+{
+	struct ext4_inode_info *ei = EXT4_I(dir);
+	struct buffer_head *bh;
+	struct ext4_iloc iloc;
+	unsigned int offset;
+	handle_t *handle;
+	void *buf = NULL;
+	int size, ret, retries = 0, no_expand;
+
+	if (!ext4_has_inline_data(dir))
+		return 0;
+
+	dquot_initialize(dir);
+retry:
+	handle = ext4_journal_start(dir, ext4_writepage_trans_blocks(dir));
+	if (IS_ERR(handle))
+		return PTR_ERR(handle);
+
+	ext4_write_lock_xattr(dir, &no_expand);
+	if (!ext4_has_inline_data(dir)) {
+		ret = 0;
+		goto out;
+	}
+	ret = ext4_get_inode_loc(dir, &iloc);
+	if (ret)
+		goto out;
+
+	size = ei->i_inline_size;
+	buf = kmalloc(size, GFP_NOFS);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out_brelse;
+	}
+	ext4_read_inline_data(dir, buf, size, &iloc);
+
+	/* nothing gets changed unless all of the entries can be moved */
+	for (offset = EXT4_INLINE_DOTDOT_SIZE; offset < size;
+	     offset += ext4_rec_len_from_disk(
+			((struct ext4_dir_entry_2 *)(buf + offset))->rec_len,
+			dir->i_sb->s_blocksize)) {
+		if (ext4_check_inline_dirent(dir, buf + offset, offset, size)) {
+			ret = -EIO;
+			goto out_brelse;
+		}
+	}
+
+	ret = ext4_destroy_inline_data_nolock(handle, dir);
+	if (ret)
+		goto out_brelse;
+
+	dir->i_size = ei->i_disksize = 0;
+	bh = ext4_bread(handle, dir, 0, 1, &ret);
+	if (bh) {
+		ret = ext4_journal_get_write_access(handle, bh);
+		if (ret)
+			brelse(bh);
+	} else if (!ret)
+		ret = -EIO;
+	if (ret) {
+		dir->i_size = ei->i_disksize = size;
+		ext4_restore_inline_data(handle, dir, &iloc, buf, size);
+		goto out_brelse;
+	}
+
+	ext4_fill_dir_block(dir, buf, size, bh->b_data);
+	dir->i_size = ei->i_disksize = dir->i_sb->s_blocksize;
+	ret = ext4_handle_dirty_metadata(handle, dir, bh);
+	brelse(bh);
+
+out_brelse:
+	brelse(iloc.bh);
+out:
+	ext4_write_unlock_xattr(dir, &no_expand);
+	/* may expand i_extra_isize, which takes xattr_sem */
+	if (!ret)
+		ret = ext4_mark_inode_dirty(handle, dir);
+	ext4_journal_stop(handle);
+	kfree(buf);
+	buf = NULL;
+
+	if (ret == -ENOSPC && ext4_should_retry_alloc(dir->i_sb, &retries))
+		goto retry;
+	return ret;
+}
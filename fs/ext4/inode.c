@@ -78,13 +78,16 @@ static int __ext4_journalled_writepage(struct page *page, unsigned int len);
 static int ext4_bh_delay_or_unwritten(handle_t *handle, struct buffer_head *bh);
 
 /*
- * Test whether an inode is a fast symlink.
+ * Test whether an inode is a fast symlink.  Inline symlinks have no block
+ * either, but are read through ->readpage() like slow ones.
  */
 static int ext4_inode_is_fast_symlink(struct inode *inode)
 {
 	int ea_blocks = EXT4_I(inode)->i_file_acl ?
 		(inode->i_sb->s_blocksize >> 9) : 0;
 
+	if (ext4_test_inode_flag(inode, EXT4_INODE_INLINE_DATA))
+		return 0;
 	return (S_ISLNK(inode->i_mode) && inode->i_blocks - ea_blocks == 0);
 }
 
@@ -1346,6 +1349,10 @@ int ext4_map_blocks(handle_t *handle, struct inode *inode,
 	 */
 	down_write((&EXT4_I(inode)->i_data_sem));
 
+	/* once the file has a block, it stays out of the inode */
+	if (ext4_test_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA))
+		ext4_clear_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA);
+
 	/*
 	 * if the caller is from delayed allocation writeout path
 	 * we have already reserved fs blocks for allocation
@@ -1626,6 +1633,16 @@ static int ext4_write_begin(struct file *file, struct address_space *mapping,
 	unsigned from, to;
 
 	trace_ext4_write_begin(inode, pos, len, flags);
+
+	if (ext4_test_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA)) {
+		ret = ext4_try_to_write_inline_data(mapping, inode, pos, len,
+						    flags, pagep);
+		if (ret < 0)
+			return ret;
+		if (ret == 1)
+			return 0;
+	}
+
 	/*
 	 * Reserve one block more for addition to orphan list in case
 	 * we allocate blocks but write fails for some reason
@@ -1716,7 +1733,12 @@ static int ext4_generic_write_end(struct file *file,
 	struct inode *inode = mapping->host;
 	handle_t *handle = ext4_journal_current_handle();
 
-	copied = block_write_end(file, mapping, pos, len, copied, page, fsdata);
+	if (ext4_has_inline_data(inode))
+		copied = ext4_write_inline_data_end(inode, pos, len,
+						    copied, page);
+	else
+		copied = block_write_end(file, mapping, pos, len, copied,
+					 page, fsdata);
 
 	/*
 	 * No need to use i_size_read() here, the i_size
@@ -3134,6 +3156,18 @@ static int ext4_da_write_begin(struct file *file, struct address_space *mapping,
 
 	index = pos >> PAGE_CACHE_SHIFT;
 
+	/* inline data is written through the non-delalloc write_end */
+	if (ext4_test_inode_state(inode, EXT4_STATE_MAY_INLINE_DATA)) {
+		ret = ext4_try_to_write_inline_data(mapping, inode, pos, len,
+						    flags, pagep);
+		if (ret < 0)
+			return ret;
+		if (ret == 1) {
+			*fsdata = (void *)FALL_BACK_TO_NONDELALLOC;
+			return 0;
+		}
+	}
+
 	if (ext4_nonda_switch(inode->i_sb)) {
 		*fsdata = (void *)FALL_BACK_TO_NONDELALLOC;
 		return ext4_write_begin(file, mapping, pos,
@@ -3360,6 +3394,10 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 	journal_t *journal;
 	int err;
 
+	/* inline data has no block to map */
+	if (ext4_has_inline_data(inode))
+		return 0;
+
 	if (mapping_tagged(mapping, PAGECACHE_TAG_DIRTY) &&
 			test_opt(inode->i_sb, DELALLOC)) {
 		/*
@@ -3405,7 +3443,15 @@ static sector_t ext4_bmap(struct address_space *mapping, sector_t block)
 
 static int ext4_readpage(struct file *file, struct page *page)
 {
+	struct inode *inode = page->mapping->host;
+	int ret;
+
 	trace_ext4_readpage(page);
+	if (ext4_has_inline_data(inode)) {
+		ret = ext4_readpage_inline(inode, page);
+		if (ret != -EAGAIN)
+			return ret;
+	}
 	return mpage_readpage(page, ext4_get_block);
 }
 
@@ -3413,6 +3459,9 @@ static int
 ext4_readpages(struct file *file, struct address_space *mapping,
 		struct list_head *pages, unsigned nr_pages)
 {
+	/* fall back to ->readpage() for inline data */
+	if (ext4_has_inline_data(mapping->host))
+		return 0;
 	return mpage_readpages(mapping, pages, nr_pages, ext4_get_block);
 }
 
@@ -3837,6 +3886,10 @@ static ssize_t ext4_direct_IO(int rw, struct kiocb *iocb,
 	struct inode *inode = file->f_mapping->host;
 	ssize_t ret;
 
+	/* let the caller fall back to buffered I/O */
+	if (ext4_has_inline_data(inode))
+		return 0;
+
 	trace_ext4_direct_IO_enter(inode, offset, iov_length(iov, nr_segs), rw);
 	if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))
 		ret = ext4_ext_direct_IO(rw, iocb, iov, offset, nr_segs);
@@ -4538,6 +4591,16 @@ void ext4_truncate(struct inode *inode)
 	if (inode->i_size == 0 && !test_opt(inode->i_sb, NO_AUTO_DA_ALLOC))
 		ext4_set_inode_state(inode, EXT4_STATE_DA_ALLOC_CLOSE);
 
+	if (ext4_has_inline_data(inode)) {
+		int has_inline = 1;
+
+		ext4_inline_data_truncate(inode, &has_inline);
+		if (has_inline) {
+			trace_ext4_truncate_exit(inode);
+			return;
+		}
+	}
+
 	if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)) {
 		ext4_ext_truncate(inode);
 		trace_ext4_truncate_exit(inode);
@@ -4723,6 +4786,7 @@ static int __ext4_get_inode_loc(struct inode *inode,
 				       "unable to read itable block");
 		return -EIO;
 	}
+	set_buffer_fc_safe(bh);
 	if (!buffer_uptodate(bh)) {
 		lock_buffer(bh);
 
@@ -5022,6 +5086,19 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 	} else
 		ei->i_extra_isize = 0;
 
+	if (ext4_test_inode_flag(inode, EXT4_INODE_INLINE_DATA)) {
+		if (!S_ISREG(inode->i_mode) && !S_ISDIR(inode->i_mode) &&
+		    !S_ISLNK(inode->i_mode)) {
+			EXT4_ERROR_INODE(inode, "inline data on a special "
+					 "inode (%o)", inode->i_mode);
+			ret = -EIO;
+			goto bad_inode;
+		}
+		ret = ext4_find_inline_data_nolock(inode);
+		if (ret)
+			goto bad_inode;
+	}
+
 	EXT4_INODE_GET_XTIME(i_ctime, inode, raw_inode);
 	EXT4_INODE_GET_XTIME(i_mtime, inode, raw_inode);
 	EXT4_INODE_GET_XTIME(i_atime, inode, raw_inode);
@@ -5041,6 +5118,8 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 				 ei->i_file_acl);
 		ret = -EIO;
 		goto bad_inode;
+	} else if (ext4_has_inline_data(inode)) {
+		/* i_block holds data, nothing to validate */
 	} else if (ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS)) {
 		if (S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) ||
 		    (S_ISLNK(inode->i_mode) &&
@@ -5234,9 +5313,11 @@ static int ext4_do_update_inode(handle_t *handle,
 				cpu_to_le32(new_encode_dev(inode->i_rdev));
 			raw_inode->i_block[2] = 0;
 		}
-	} else
+	} else if (!ext4_has_inline_data(inode)) {
+		/* inline data is written to i_block directly */
 		for (block = 0; block < EXT4_N_BLOCKS; block++)
 			raw_inode->i_block[block] = ei->i_data[block];
+	}
 
 	raw_inode->i_disk_version = cpu_to_le32(inode->i_version);
 	if (ei->i_extra_isize) {
@@ -5679,6 +5760,10 @@ static int ext4_expand_extra_isize(struct inode *inode,
 	if (EXT4_I(inode)->i_extra_isize >= new_extra_isize)
 		return 0;
 
+	/* i_inline_off points into the in-inode EA area, leave it alone */
+	if (ext4_has_inline_data(inode))
+		return 0;
+
 	raw_inode = ext4_raw_inode(&iloc);
 
 	header = IHDR(inode, raw_inode);
@@ -5893,6 +5978,12 @@ int ext4_page_mkwrite(struct vm_area_struct *vma, struct vm_fault *vmf)
 	struct inode *inode = file->f_path.dentry->d_inode;
 	struct address_space *mapping = inode->i_mapping;
 
+	/* a shared writable mapping needs the data in a real block */
+	ret = ext4_convert_inline_data(inode);
+	if (ret)
+		return VM_FAULT_SIGBUS;
+	ret = -EINVAL;
+
 	/*
 	 * Get i_alloc_sem to stop truncates messing with the inode. We cannot
 	 * get i_mutex because we are already holding mmap_sem.
@@ -22,6 +22,7 @@
  */
 
 #include "mballoc.h"
+#include <linux/list_sort.h>
 #include <linux/debugfs.h>
 #include <linux/slab.h>
 #include <trace/events/ext4.h>
@@ -356,6 +357,9 @@ static void ext4_mb_generate_from_pa(struct super_block *sb, void *bitmap,
 static void ext4_mb_generate_from_freelist(struct super_block *sb, void *bitmap,
 						ext4_group_t group);
 static void release_blocks_on_commit(journal_t *journal, transaction_t *txn);
+static unsigned long ext4_mb_process_discards(struct super_block *sb,
+					      unsigned long max_blocks);
+static void ext4_mb_discard_work(struct work_struct *work);
 
 static inline void *mb_correct_addr_and_bit(int *bit, void *addr)
 {
@@ -2491,6 +2495,14 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		proc_create_data("mb_groups", S_IRUGO, sbi->s_proc,
 				 &ext4_mb_seq_groups_fops, sb);
 
+	INIT_LIST_HEAD(&sbi->s_discard_list);
+	spin_lock_init(&sbi->s_discard_lock);
+	mutex_init(&sbi->s_discard_mutex);
+	INIT_DELAYED_WORK(&sbi->s_discard_work, ext4_mb_discard_work);
+	sbi->s_discard_async = 1;
+	sbi->s_discard_interval = MB_DEFAULT_DISCARD_INTERVAL;
+	sbi->s_discard_batch = MB_DEFAULT_DISCARD_BATCH;
+
 	if (sbi->s_journal)
 		sbi->s_journal->j_commit_callback = release_blocks_on_commit;
 out:
@@ -2531,6 +2543,10 @@ int ext4_mb_release(struct super_block *sb)
 	if (sbi->s_proc)
 		remove_proc_entry("mb_groups", sbi->s_proc);
 
+	/* the journal is gone, nothing can queue more */
+	cancel_delayed_work_sync(&sbi->s_discard_work);
+	ext4_mb_process_discards(sb, 0);
+
 	if (sbi->s_group_info) {
 		for (i = 0; i < ngroups; i++) {
 			grinfo = ext4_get_group_info(sb, i);
@@ -2593,6 +2609,159 @@ static inline int ext4_issue_discard(struct super_block *sb,
 	return sb_issue_discard(sb, discard_block, count, GFP_NOFS, 0);
 }
 
+/* Put the blocks of @entry back into the buddy, now they are really free. */
+static void ext4_mb_free_entry(struct super_block *sb,
+			       struct ext4_free_data *entry)
+{
+	struct ext4_buddy e4b;
+	struct ext4_group_info *db;
+	int err;
+
+	err = ext4_mb_load_buddy(sb, entry->group, &e4b);
+	/* we expect to find existing buddy because it's pinned */
+	BUG_ON(err != 0);
+
+	db = e4b.bd_info;
+	ext4_lock_group(sb, entry->group);
+	/* Take it out of per group rb tree */
+	rb_erase(&entry->node, &(db->bb_free_root));
+	mb_free_blocks(NULL, &e4b, entry->start_blk, entry->count);
+
+	if (!db->bb_free_root.rb_node) {
+		/* No more items in the per group rb tree
+		 * balance refcounts from ext4_mb_free_metadata()
+		 */
+		page_cache_release(e4b.bd_buddy_page);
+		page_cache_release(e4b.bd_bitmap_page);
+	}
+	ext4_unlock_group(sb, entry->group);
+	kmem_cache_free(ext4_free_ext_cachep, entry);
+	ext4_mb_unload_buddy(&e4b);
+}
+
+/*
+ * Asynchronous discard
+ *
+ * Discarding freed blocks from the commit callback stalls kjournald2 for
+ * as long as the device takes to trim them, which on eMMC can be a good
+ * part of a second.  With async_discard set, the extents freed by a
+ * commit are queued on the superblock instead.  They stay out of the
+ * buddy, and in the group's bb_free_root so that a regenerated buddy keeps
+ * them in use too, until a worker has discarded them: after the device
+ * has seen no I/O for discard_interval_ms (or has deferred us too often),
+ * at most discard_batch_blocks per run, adjacent extents merged into one
+ * request.  An allocation about to fail with ENOSPC flushes the queue.
+ */
+
+static unsigned long ext4_mb_disk_ios(struct super_block *sb)
+{
+	struct hd_struct *part = sb->s_bdev->bd_part;
+
+	return part_stat_read(part, ios[READ]) +
+		part_stat_read(part, ios[WRITE]);
+}
+
+static int ext4_free_data_cmp(void *priv, struct list_head *a,
+			      struct list_head *b)
+{
+	struct ext4_free_data *fa = list_entry(a, struct ext4_free_data, list);
+	struct ext4_free_data *fb = list_entry(b, struct ext4_free_data, list);
+
+	if (fa->group != fb->group)
+		return fa->group < fb->group ? -1 : 1;
+	return fa->start_blk < fb->start_blk ? -1 : 1;
+}
+
+/*
+ * Discard and free up to @max_blocks queued blocks, all of them if 0.
+ * Returns the number of blocks freed.
+ */
+static unsigned long ext4_mb_process_discards(struct super_block *sb,
+					      unsigned long max_blocks)
+{
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_free_data *entry, *tmp;
+	unsigned long done = 0;
+	ext4_grpblk_t start, end;
+	ext4_group_t group;
+	LIST_HEAD(list);
+	LIST_HEAD(batch);
+
+	mutex_lock(&sbi->s_discard_mutex);
+	spin_lock(&sbi->s_discard_lock);
+	list_splice_init(&sbi->s_discard_list, &list);
+	spin_unlock(&sbi->s_discard_lock);
+
+	list_sort(NULL, &list, ext4_free_data_cmp);
+	while (!list_empty(&list) && (!max_blocks || done < max_blocks)) {
+		entry = list_first_entry(&list, struct ext4_free_data, list);
+		group = entry->group;
+		start = end = entry->start_blk;
+		list_for_each_entry_safe(entry, tmp, &list, list) {
+			if (entry->group != group || entry->start_blk != end)
+				break;
+			if (end != start)
+				sbi->s_discard_merged++;
+			end += entry->count;
+			list_move_tail(&entry->list, &batch);
+		}
+
+		/* the option may have been turned off by a remount */
+		if (test_opt(sb, DISCARD)) {
+			ext4_issue_discard(sb, group, start, end - start);
+			sbi->s_discard_requests++;
+			sbi->s_discard_blocks += end - start;
+		}
+		list_for_each_entry_safe(entry, tmp, &batch, list) {
+			list_del(&entry->list);
+			ext4_mb_free_entry(sb, entry);
+		}
+		done += end - start;
+	}
+
+	spin_lock(&sbi->s_discard_lock);
+	list_splice(&list, &sbi->s_discard_list);
+	sbi->s_discard_pending -= done;
+	spin_unlock(&sbi->s_discard_lock);
+	mutex_unlock(&sbi->s_discard_mutex);
+	return done;
+}
+
+static void ext4_mb_queue_discard_work(struct ext4_sb_info *sbi)
+{
+	queue_delayed_work(system_long_wq, &sbi->s_discard_work,
+			   msecs_to_jiffies(sbi->s_discard_interval));
+}
+
+static void ext4_mb_discard_work(struct work_struct *work)
+{
+	struct ext4_sb_info *sbi = container_of(to_delayed_work(work),
+					struct ext4_sb_info, s_discard_work);
+	struct super_block *sb = sbi->s_sb;
+	unsigned long ios = ext4_mb_disk_ios(sb);
+	int more;
+
+	if (ios != sbi->s_discard_last_ios &&
+	    sbi->s_discard_deferred < MB_DISCARD_MAX_DEFER) {
+		/* not idle, look again later */
+		sbi->s_discard_last_ios = ios;
+		sbi->s_discard_deferred++;
+		ext4_mb_queue_discard_work(sbi);
+		return;
+	}
+
+	sbi->s_discard_deferred = 0;
+	ext4_mb_process_discards(sb, sbi->s_discard_batch);
+	/* our own discards do not count as activity */
+	sbi->s_discard_last_ios = ext4_mb_disk_ios(sb);
+
+	spin_lock(&sbi->s_discard_lock);
+	more = !list_empty(&sbi->s_discard_list);
+	spin_unlock(&sbi->s_discard_lock);
+	if (more)
+		ext4_mb_queue_discard_work(sbi);
+}
+
 /*
  * This function is called by the jbd2 layer once the commit has finished,
  * so we know we can free the blocks that were released with that commit.
@@ -2600,11 +2769,12 @@ static inline int ext4_issue_discard(struct super_block *sb,
 static void release_blocks_on_commit(journal_t *journal, transaction_t *txn)
 {
 	struct super_block *sb = journal->j_private;
-	struct ext4_buddy e4b;
-	struct ext4_group_info *db;
-	int err, count = 0, count2 = 0;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int count = 0, count2 = 0;
 	struct ext4_free_data *entry;
 	struct list_head *l, *ltmp;
+	unsigned long queued = 0;
+	LIST_HEAD(discard_list);
 
 	list_for_each_safe(l, ltmp, &txn->t_private_list) {
 		entry = list_entry(l, struct ext4_free_data, list);
@@ -2612,33 +2782,31 @@ static void release_blocks_on_commit(journal_t *journal, transaction_t *txn)
 		mb_debug(1, "gonna free %u blocks in group %u (0x%p):",
 			 entry->count, entry->group, entry);
 
+		if (test_opt(sb, DISCARD) && sbi->s_discard_async) {
+			/* the discard worker frees them */
+			list_move_tail(&entry->list, &discard_list);
+			queued += entry->count;
+			continue;
+		}
+
 		if (test_opt(sb, DISCARD))
 			ext4_issue_discard(sb, entry->group,
 					   entry->start_blk, entry->count);
 
-		err = ext4_mb_load_buddy(sb, entry->group, &e4b);
-		/* we expect to find existing buddy because it's pinned */
-		BUG_ON(err != 0);
-
-		db = e4b.bd_info;
 		/* there are blocks to put in buddy to make them really free */
 		count += entry->count;
 		count2++;
-		ext4_lock_group(sb, entry->group);
-		/* Take it out of per group rb tree */
-		rb_erase(&entry->node, &(db->bb_free_root));
-		mb_free_blocks(NULL, &e4b, entry->start_blk, entry->count);
-
-		if (!db->bb_free_root.rb_node) {
-			/* No more items in the per group rb tree
-			 * balance refcounts from ext4_mb_free_metadata()
-			 */
-			page_cache_release(e4b.bd_buddy_page);
-			page_cache_release(e4b.bd_bitmap_page);
-		}
-		ext4_unlock_group(sb, entry->group);
-		kmem_cache_free(ext4_free_ext_cachep, entry);
-		ext4_mb_unload_buddy(&e4b);
+		ext4_mb_free_entry(sb, entry);
+	}
+
+	if (queued) {
+		spin_lock(&sbi->s_discard_lock);
+		list_splice_tail(&discard_list, &sbi->s_discard_list);
+		sbi->s_discard_pending += queued;
+		spin_unlock(&sbi->s_discard_lock);
+		if (!delayed_work_pending(&sbi->s_discard_work))
+			sbi->s_discard_last_ios = ext4_mb_disk_ios(sb);
+		ext4_mb_queue_discard_work(sbi);
 	}
 
 	mb_debug(1, "freed %u blocks in %u structures\n", count, count2);
@@ -4318,6 +4486,8 @@ repeat:
 		}
 	} else {
 		freed  = ext4_mb_discard_preallocations(sb, ac->ac_o_ex.fe_len);
+		if (!freed)
+			freed = ext4_mb_process_discards(sb, 0);
 		if (freed)
 			goto repeat;
 		*errp = -ENOSPC;
@@ -4486,6 +4656,9 @@ void ext4_free_blocks(handle_t *handle, struct inode *inode,
 	ext4_debug("freeing block %llu\n", block);
 	trace_ext4_free_blocks(inode, block, count, flags);
 
+	/* fast commit replay only ever sets bitmap bits */
+	ext4_fc_mark_ineligible(sb, handle);
+
 	if (flags & EXT4_FREE_BLOCKS_FORGET) {
 		struct buffer_head *tbh = bh;
 		int i;
@@ -94,6 +94,16 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * with the discard mount option, freed blocks are queued and discarded
+ * once the device has been idle for MB_DEFAULT_DISCARD_INTERVAL ms, at
+ * most MB_DEFAULT_DISCARD_BATCH blocks at a time.  A busy device defers
+ * the discards MB_DISCARD_MAX_DEFER times in a row at most.
+ */
+#define MB_DEFAULT_DISCARD_INTERVAL	1000
+#define MB_DEFAULT_DISCARD_BATCH	65536
+#define MB_DISCARD_MAX_DEFER		10
+
 
 struct ext4_free_data {
 	/* this links the free block information from group_info */
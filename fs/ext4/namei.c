@@ -872,6 +872,13 @@ static struct buffer_head * ext4_find_entry (struct inode *dir,
 	namelen = d_name->len;
 	if (namelen > EXT4_NAME_LEN)
 		return NULL;
+	if (ext4_has_inline_data(dir)) {
+		int has_inline = 1;
+
+		ret = ext4_find_inline_entry(dir, d_name, res_dir, &has_inline);
+		if (has_inline)
+			return ret;
+	}
 	if ((namelen <= 2) && (name[0] == '.') &&
 	    (name[1] == '.' || name[1] == '\0')) {
 		/*
@@ -1061,12 +1068,18 @@ struct dentry *ext4_get_parent(struct dentry *child)
 	};
 	struct ext4_dir_entry_2 * de;
 	struct buffer_head *bh;
-
-	bh = ext4_find_entry(child->d_inode, &dotdot, &de);
-	if (!bh)
-		return ERR_PTR(-ENOENT);
-	ino = le32_to_cpu(de->inode);
-	brelse(bh);
+	int ret;
+
+	ret = ext4_inline_dir_parent(child->d_inode, &ino);
+	if (ret < 0)
+		return ERR_PTR(ret);
+	if (!ret) {
+		bh = ext4_find_entry(child->d_inode, &dotdot, &de);
+		if (!bh)
+			return ERR_PTR(-ENOENT);
+		ino = le32_to_cpu(de->inode);
+		brelse(bh);
+	}
 
 	if (!ext4_valid_inum(child->d_inode->i_sb, ino)) {
 		EXT4_ERROR_INODE(child->d_inode,
@@ -1461,6 +1474,9 @@ static int ext4_add_entry(handle_t *handle, struct dentry *dentry,
 	blocksize = sb->s_blocksize;
 	if (!dentry->d_name.len)
 		return -EINVAL;
+	/* inline directories are moved to a block before any change */
+	if (WARN_ON(ext4_has_inline_data(dir)))
+		return -EIO;
 	if (is_dx(dir)) {
 		retval = ext4_dx_add_entry(handle, dentry, inode);
 		if (!retval || (retval != ERR_BAD_DX_DIR))
@@ -1649,6 +1665,9 @@ static int ext4_delete_entry(handle_t *handle,
 	unsigned int blocksize = dir->i_sb->s_blocksize;
 	int i, err;
 
+	if (WARN_ON(ext4_has_inline_data(dir)))
+		return -EIO;
+
 	i = 0;
 	pde = NULL;
 	de = (struct ext4_dir_entry_2 *) bh->b_data;
@@ -1748,6 +1767,9 @@ static int ext4_create(struct inode *dir, struct dentry *dentry, int mode,
 	int err, retries = 0;
 
 	dquot_initialize(dir);
+	err = ext4_convert_inline_dir(dir);
+	if (err)
+		return err;
 
 retry:
 	handle = ext4_journal_start(dir, EXT4_DATA_TRANS_BLOCKS(dir->i_sb) +
@@ -1784,6 +1806,9 @@ static int ext4_mknod(struct inode *dir, struct dentry *dentry,
 		return -EINVAL;
 
 	dquot_initialize(dir);
+	err = ext4_convert_inline_dir(dir);
+	if (err)
+		return err;
 
 retry:
 	handle = ext4_journal_start(dir, EXT4_DATA_TRANS_BLOCKS(dir->i_sb) +
@@ -1823,6 +1848,9 @@ static int ext4_mkdir(struct inode *dir, struct dentry *dentry, int mode)
 		return -EMLINK;
 
 	dquot_initialize(dir);
+	err = ext4_convert_inline_dir(dir);
+	if (err)
+		return err;
 
 retry:
 	handle = ext4_journal_start(dir, EXT4_DATA_TRANS_BLOCKS(dir->i_sb) +
@@ -1906,6 +1934,14 @@ static int empty_dir(struct inode *inode)
 	struct super_block *sb;
 	int err = 0;
 
+	if (ext4_has_inline_data(inode)) {
+		int has_inline = 1;
+
+		err = ext4_empty_inline_dir(inode, &has_inline);
+		if (has_inline)
+			return err;
+	}
+
 	sb = inode->i_sb;
 	if (inode->i_size < EXT4_DIR_REC_LEN(1) + EXT4_DIR_REC_LEN(2) ||
 	    !(bh = ext4_bread(NULL, inode, 0, 0, &err))) {
@@ -1985,6 +2021,7 @@ int ext4_orphan_add(handle_t *handle, struct inode *inode)
 	if (!ext4_handle_valid(handle))
 		return 0;
 
+	ext4_fc_mark_ineligible(sb, handle);
 	mutex_lock(&EXT4_SB(sb)->s_orphan_lock);
 	if (!list_empty(&EXT4_I(inode)->i_orphan))
 		goto out_unlock;
@@ -2067,6 +2104,7 @@ int ext4_orphan_del(handle_t *handle, struct inode *inode)
 	if (handle && !ext4_handle_valid(handle))
 		return 0;
 
+	ext4_fc_mark_ineligible(inode->i_sb, handle);
 	mutex_lock(&EXT4_SB(inode->i_sb)->s_orphan_lock);
 	if (list_empty(&ei->i_orphan))
 		goto out;
@@ -2139,6 +2177,9 @@ static int ext4_rmdir(struct inode *dir, struct dentry *dentry)
 	 * separate transaction */
 	dquot_initialize(dir);
 	dquot_initialize(dentry->d_inode);
+	retval = ext4_convert_inline_dir(dir);
+	if (retval)
+		return retval;
 
 	handle = ext4_journal_start(dir, EXT4_DELETE_TRANS_BLOCKS(dir->i_sb));
 	if (IS_ERR(handle))
@@ -2201,6 +2242,9 @@ static int ext4_unlink(struct inode *dir, struct dentry *dentry)
 	 * in separate transaction */
 	dquot_initialize(dir);
 	dquot_initialize(dentry->d_inode);
+	retval = ext4_convert_inline_dir(dir);
+	if (retval)
+		return retval;
 
 	handle = ext4_journal_start(dir, EXT4_DELETE_TRANS_BLOCKS(dir->i_sb));
 	if (IS_ERR(handle))
@@ -2259,6 +2303,9 @@ static int ext4_symlink(struct inode *dir,
 		return -ENAMETOOLONG;
 
 	dquot_initialize(dir);
+	err = ext4_convert_inline_dir(dir);
+	if (err)
+		return err;
 
 	if (l > EXT4_N_BLOCKS * 4) {
 		/*
@@ -2364,6 +2411,9 @@ static int ext4_link(struct dentry *old_dentry,
 		return -EMLINK;
 
 	dquot_initialize(dir);
+	err = ext4_convert_inline_dir(dir);
+	if (err)
+		return err;
 
 retry:
 	handle = ext4_journal_start(dir, EXT4_DATA_TRANS_BLOCKS(dir->i_sb) +
@@ -2395,6 +2445,35 @@ retry:
 #define PARENT_INO(buffer, size) \
 	(ext4_next_entry((struct ext4_dir_entry_2 *)(buffer), size)->inode)
 
+/*
+ * Point ".." of directory @inode at @ino, in its first block as read into
+ * *dir_bh with write access, or in the inode if *dir_bh is NULL because
+ * @inode was inline.  rename does not lock @inode, so it may have been
+ * moved to a block since: read the block then.
+ */
+static int ext4_set_dotdot(handle_t *handle, struct inode *inode,
+			   struct buffer_head **dir_bh, __u32 ino)
+{
+	int err;
+
+	if (!*dir_bh) {
+		err = ext4_inline_dir_set_parent(handle, inode, ino);
+		if (err)
+			return err < 0 ? err : 0;
+		*dir_bh = ext4_bread(handle, inode, 0, 0, &err);
+		if (!*dir_bh)
+			return err ? err : -EIO;
+		BUFFER_TRACE(*dir_bh, "get_write_access");
+		err = ext4_journal_get_write_access(handle, *dir_bh);
+		if (err)
+			return err;
+	}
+	PARENT_INO((*dir_bh)->b_data, inode->i_sb->s_blocksize) =
+						cpu_to_le32(ino);
+	BUFFER_TRACE(*dir_bh, "call ext4_handle_dirty_metadata");
+	return ext4_handle_dirty_metadata(handle, inode, *dir_bh);
+}
+
 /*
  * Anybody can rename anything with this: the permission checks are left to the
  * higher-level routines.
@@ -2417,6 +2496,12 @@ static int ext4_rename(struct inode *old_dir, struct dentry *old_dentry,
 	 * in separate transaction */
 	if (new_dentry->d_inode)
 		dquot_initialize(new_dentry->d_inode);
+
+	retval = ext4_convert_inline_dir(old_dir);
+	if (!retval)
+		retval = ext4_convert_inline_dir(new_dir);
+	if (retval)
+		return retval;
 	handle = ext4_journal_start(old_dir, 2 *
 					EXT4_DATA_TRANS_BLOCKS(old_dir->i_sb) +
 					EXT4_INDEX_EXTRA_TRANS_BLOCKS + 2);
@@ -2447,26 +2532,38 @@ static int ext4_rename(struct inode *old_dir, struct dentry *old_dentry,
 		}
 	}
 	if (S_ISDIR(old_inode->i_mode)) {
+		__u32 parent;
+
 		if (new_inode) {
 			retval = -ENOTEMPTY;
 			if (!empty_dir(new_inode))
 				goto end_rename;
 		}
-		retval = -EIO;
-		dir_bh = ext4_bread(handle, old_inode, 0, 0, &retval);
-		if (!dir_bh)
+		/* old_inode is not locked and is left inline if it is */
+		retval = ext4_inline_dir_parent(old_inode, &parent);
+		if (retval < 0)
 			goto end_rename;
-		if (le32_to_cpu(PARENT_INO(dir_bh->b_data,
-				old_dir->i_sb->s_blocksize)) != old_dir->i_ino)
+		if (!retval) {
+			retval = -EIO;
+			dir_bh = ext4_bread(handle, old_inode, 0, 0, &retval);
+			if (!dir_bh)
+				goto end_rename;
+			parent = le32_to_cpu(PARENT_INO(dir_bh->b_data,
+						old_dir->i_sb->s_blocksize));
+		}
+		retval = -EIO;
+		if (parent != old_dir->i_ino)
 			goto end_rename;
 		retval = -EMLINK;
 		if (!new_inode && new_dir != old_dir &&
 		    EXT4_DIR_LINK_MAX(new_dir))
 			goto end_rename;
-		BUFFER_TRACE(dir_bh, "get_write_access");
-		retval = ext4_journal_get_write_access(handle, dir_bh);
-		if (retval)
-			goto end_rename;
+		if (dir_bh) {
+			BUFFER_TRACE(dir_bh, "get_write_access");
+			retval = ext4_journal_get_write_access(handle, dir_bh);
+			if (retval)
+				goto end_rename;
+		}
 	}
 	if (!new_bh) {
 		retval = ext4_add_entry(handle, new_dentry, old_inode);
@@ -2536,11 +2633,9 @@ static int ext4_rename(struct inode *old_dir, struct dentry *old_dentry,
 	}
 	old_dir->i_ctime = old_dir->i_mtime = ext4_current_time(old_dir);
 	ext4_update_dx_flag(old_dir);
-	if (dir_bh) {
-		PARENT_INO(dir_bh->b_data, new_dir->i_sb->s_blocksize) =
-						cpu_to_le32(new_dir->i_ino);
-		BUFFER_TRACE(dir_bh, "call ext4_handle_dirty_metadata");
-		retval = ext4_handle_dirty_metadata(handle, old_inode, dir_bh);
+	if (S_ISDIR(old_inode->i_mode)) {
+		retval = ext4_set_dotdot(handle, old_inode, &dir_bh,
+					 new_dir->i_ino);
 		if (retval) {
 			ext4_std_error(old_dir->i_sb, retval);
 			goto end_rename;
@@ -871,6 +871,8 @@ static struct inode *ext4_alloc_inode(struct super_block *sb)
 	ei->cur_aio_dio = NULL;
 	ei->i_sync_tid = 0;
 	ei->i_datasync_tid = 0;
+	ei->i_inline_off = 0;
+	ei->i_inline_size = 0;
 	atomic_set(&ei->i_ioend_count, 0);
 	atomic_set(&ei->i_aiodio_unwritten, 0);
 
@@ -1120,6 +1122,9 @@ static int ext4_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_printf(seq, ",init_itable=%u",
 			   (unsigned) sbi->s_li_wait_mult);
 
+	if (test_opt2(sb, FAST_COMMIT))
+		seq_puts(seq, ",fast_commit");
+
 	ext4_show_quota_options(seq, sb);
 
 	return 0;
@@ -1294,6 +1299,7 @@ enum {
 	Opt_inode_readahead_blks, Opt_journal_ioprio,
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
+	Opt_fast_commit, Opt_nofast_commit,
 };
 
 static const match_table_t tokens = {
@@ -1369,6 +1375,8 @@ static const match_table_t tokens = {
 	{Opt_init_itable, "init_itable=%u"},
 	{Opt_init_itable, "init_itable"},
 	{Opt_noinit_itable, "noinit_itable"},
+	{Opt_fast_commit, "fast_commit"},
+	{Opt_nofast_commit, "nofast_commit"},
 	{Opt_err, NULL},
 };
 
@@ -1859,6 +1867,12 @@ set_qf_format:
 		case Opt_noinit_itable:
 			clear_opt(sb, INIT_INODE_TABLE);
 			break;
+		case Opt_fast_commit:
+			set_opt2(sb, FAST_COMMIT);
+			break;
+		case Opt_nofast_commit:
+			clear_opt2(sb, FAST_COMMIT);
+			break;
 		default:
 			ext4_msg(sb, KERN_ERR,
 			       "Unrecognized mount option \"%s\" "
@@ -2463,6 +2477,18 @@ static ssize_t extent_cache_misses_show(struct ext4_attr *a,
 	return snprintf(buf, PAGE_SIZE, "%lu\n", sbi->extent_cache_misses);
 }
 
+static ssize_t fast_commits_show(struct ext4_attr *a,
+				 struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n", sbi->s_fc_commits);
+}
+
+static ssize_t fast_commit_fallbacks_show(struct ext4_attr *a,
+					  struct ext4_sb_info *sbi, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%lu\n", sbi->s_fc_fallbacks);
+}
+
 static ssize_t inode_readahead_blks_store(struct ext4_attr *a,
 					  struct ext4_sb_info *sbi,
 					  const char *buf, size_t count)
@@ -2500,6 +2526,14 @@ static ssize_t sbi_ui_store(struct ext4_attr *a,
 	return count;
 }
 
+static ssize_t sbi_ul_show(struct ext4_attr *a,
+			   struct ext4_sb_info *sbi, char *buf)
+{
+	unsigned long *ul = (unsigned long *) (((char *) sbi) + a->offset);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", *ul);
+}
+
 #define EXT4_ATTR_OFFSET(_name,_mode,_show,_store,_elname) \
 static struct ext4_attr ext4_attr_##_name = {			\
 	.attr = {.name = __stringify(_name), .mode = _mode },	\
@@ -2515,6 +2549,8 @@ static struct ext4_attr ext4_attr_##name = __ATTR(name, mode, show, store)
 #define EXT4_RW_ATTR(name) EXT4_ATTR(name, 0644, name##_show, name##_store)
 #define EXT4_RW_ATTR_SBI_UI(name, elname)	\
 	EXT4_ATTR_OFFSET(name, 0644, sbi_ui_show, sbi_ui_store, elname)
+#define EXT4_RO_ATTR_SBI_UL(name, elname)	\
+	EXT4_ATTR_OFFSET(name, 0444, sbi_ul_show, NULL, elname)
 #define ATTR_LIST(name) &ext4_attr_##name.attr
 
 EXT4_RO_ATTR(delayed_allocation_blocks);
@@ -2522,6 +2558,8 @@ EXT4_RO_ATTR(session_write_kbytes);
 EXT4_RO_ATTR(lifetime_write_kbytes);
 EXT4_RO_ATTR(extent_cache_hits);
 EXT4_RO_ATTR(extent_cache_misses);
+EXT4_RO_ATTR(fast_commits);
+EXT4_RO_ATTR(fast_commit_fallbacks);
 EXT4_ATTR_OFFSET(inode_readahead_blks, 0644, sbi_ui_show,
 		 inode_readahead_blks_store, s_inode_readahead_blks);
 EXT4_RW_ATTR_SBI_UI(inode_goal, s_inode_goal);
@@ -2532,6 +2570,13 @@ EXT4_RW_ATTR_SBI_UI(mb_order2_req, s_mb_order2_reqs);
 EXT4_RW_ATTR_SBI_UI(mb_stream_req, s_mb_stream_request);
 EXT4_RW_ATTR_SBI_UI(mb_group_prealloc, s_mb_group_prealloc);
 EXT4_RW_ATTR_SBI_UI(max_writeback_mb_bump, s_max_writeback_mb_bump);
+EXT4_RW_ATTR_SBI_UI(async_discard, s_discard_async);
+EXT4_RW_ATTR_SBI_UI(discard_interval_ms, s_discard_interval);
+EXT4_RW_ATTR_SBI_UI(discard_batch_blocks, s_discard_batch);
+EXT4_RO_ATTR_SBI_UL(discard_pending_blocks, s_discard_pending);
+EXT4_RO_ATTR_SBI_UL(discard_requests, s_discard_requests);
+EXT4_RO_ATTR_SBI_UL(discarded_blocks, s_discard_blocks);
+EXT4_RO_ATTR_SBI_UL(discard_merged, s_discard_merged);
 
 static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(delayed_allocation_blocks),
@@ -2539,6 +2584,8 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(lifetime_write_kbytes),
 	ATTR_LIST(extent_cache_hits),
 	ATTR_LIST(extent_cache_misses),
+	ATTR_LIST(fast_commits),
+	ATTR_LIST(fast_commit_fallbacks),
 	ATTR_LIST(inode_readahead_blks),
 	ATTR_LIST(inode_goal),
 	ATTR_LIST(mb_stats),
@@ -2548,6 +2595,13 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(mb_stream_req),
 	ATTR_LIST(mb_group_prealloc),
 	ATTR_LIST(max_writeback_mb_bump),
+	ATTR_LIST(async_discard),
+	ATTR_LIST(discard_interval_ms),
+	ATTR_LIST(discard_batch_blocks),
+	ATTR_LIST(discard_pending_blocks),
+	ATTR_LIST(discard_requests),
+	ATTR_LIST(discarded_blocks),
+	ATTR_LIST(discard_merged),
 	NULL,
 };
 
@@ -3076,6 +3130,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 		goto out_free_orig;
 	}
 	sb->s_fs_info = sbi;
+	sbi->s_sb = sb;
 	sbi->s_mount_opt = 0;
 	sbi->s_resuid = EXT4_DEF_RESUID;
 	sbi->s_resgid = EXT4_DEF_RESGID;
@@ -3431,6 +3486,8 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 			goto failed_mount2;
 		}
 	}
+	for (i = 0; i < db_count; i++)
+		set_buffer_fc_safe(sbi->s_group_desc[i]);
 	if (!ext4_check_descriptors(sb, &first_not_zeroed)) {
 		ext4_msg(sb, KERN_ERR, "group descriptors corrupted!");
 		goto failed_mount2;
@@ -3518,6 +3575,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 		goto failed_mount_wq;
 	} else {
 		clear_opt(sb, DATA_FLAGS);
+		clear_opt2(sb, FAST_COMMIT);
 		sbi->s_journal = NULL;
 		needs_recovery = 0;
 		goto no_journal;
@@ -3571,6 +3629,16 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	default:
 		break;
 	}
+
+	if (test_opt2(sb, FAST_COMMIT) &&
+	    (test_opt(sb, DATA_FLAGS) != EXT4_MOUNT_ORDERED_DATA ||
+	     !jbd2_journal_set_features(sbi->s_journal, 0, 0,
+					JBD2_FEATURE_INCOMPAT_INODE_FC))) {
+		ext4_msg(sb, KERN_WARNING, "fast commits need data=ordered "
+			 "and room in an empty journal, disabling them");
+		clear_opt2(sb, FAST_COMMIT);
+	}
+	sbi->s_fc_ineligible_tid = sbi->s_journal->j_transaction_sequence - 1;
 	set_task_ioprio(sbi->s_journal->j_task, journal_ioprio);
 
 	/*
@@ -3696,6 +3764,8 @@ no_journal:
 		goto failed_mount4;
 	};
 
+	if (EXT4_SB(sb)->s_journal)
+		ext4_fc_replay(sb);
 	EXT4_SB(sb)->s_mount_state |= EXT4_ORPHAN_FS;
 	ext4_orphan_cleanup(sb, es);
 	EXT4_SB(sb)->s_mount_state &= ~EXT4_ORPHAN_FS;
@@ -4334,6 +4404,17 @@ static int ext4_remount(struct super_block *sb, int *flags, char *data)
 		set_task_ioprio(sbi->s_journal->j_task, journal_ioprio);
 	}
 
+	/* the fast commit area can only be set up at mount time */
+	if (test_opt2(sb, FAST_COMMIT) &&
+	    !(sbi->s_journal &&
+	      JBD2_HAS_INCOMPAT_FEATURE(sbi->s_journal,
+					JBD2_FEATURE_INCOMPAT_INODE_FC) &&
+	      test_opt(sb, DATA_FLAGS) == EXT4_MOUNT_ORDERED_DATA)) {
+		ext4_msg(sb, KERN_ERR, "can't enable fast commits on remount");
+		err = -EINVAL;
+		goto restore_opts;
+	}
+
 	if ((*flags & MS_RDONLY) != (sb->s_flags & MS_RDONLY) ||
 		n_blocks_count > ext4_blocks_count(es)) {
 		if (sbi->s_mount_flags & EXT4_MF_FS_ABORTED) {
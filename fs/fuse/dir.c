@@ -411,6 +411,8 @@ static int fuse_create_open(struct inode *dir, struct dentry *entry, int mode,
 	memset(&inarg, 0, sizeof(inarg));
 	memset(&outentry, 0, sizeof(outentry));
 	inarg.flags = flags;
+	if (fc->writeback_cache)
+		inarg.flags = fuse_writeback_open_flags(flags);
 	inarg.mode = mode;
 	inarg.umask = current_umask();
 	req->in.h.opcode = FUSE_CREATE;
@@ -784,6 +786,9 @@ static void fuse_fillattr(struct inode *inode, struct fuse_attr *attr,
 	stat->ctime.tv_sec = attr->ctime;
 	stat->ctime.tv_nsec = attr->ctimensec;
 	stat->size = attr->size;
+	/* the server's size may be stale while cached writes are pending */
+	if (get_fuse_conn(inode)->writeback_cache && S_ISREG(inode->i_mode))
+		stat->size = i_size_read(inode);
 	stat->blocks = attr->blocks;
 	stat->blksize = (1 << inode->i_blkbits);
 }
@@ -1358,6 +1363,9 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	fuse_change_attributes_common(inode, &outarg.attr,
 				      attr_timeout(&outarg));
 	oldsize = inode->i_size;
+	/* with the writeback cache, only truncate changes i_size */
+	if (!is_truncate && fc->writeback_cache && S_ISREG(inode->i_mode))
+		outarg.attr.size = oldsize;
 	i_size_write(inode, outarg.attr.size);
 
 	if (is_truncate) {
@@ -23,9 +23,12 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
-/** Max number of pages that can be used in a single read request */
+/** Default max number of pages that can be used in a single request */
 #define FUSE_MAX_PAGES_PER_REQ 32
 
+/** Upper limit for the max_pages negotiated with FUSE_MAX_PAGES */
+#define FUSE_MAX_MAX_PAGES 256
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -288,7 +291,13 @@ struct fuse_req {
 	} misc;
 
 	/** page vector */
-	struct page *pages[FUSE_MAX_PAGES_PER_REQ];
+	struct page **pages;
+
+	/** size of the page vector */
+	unsigned max_pages;
+
+	/** inline page vector, used unless more pages are needed */
+	struct page *inline_pages[FUSE_MAX_PAGES_PER_REQ];
 
 	/** number of pages in vector */
 	unsigned num_pages;
@@ -344,6 +353,9 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
+	/** Maximum number of pages in a read or write request */
+	unsigned max_pages;
+
 	/** Readers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
@@ -472,6 +484,9 @@ struct fuse_conn {
 	/** Do multi-page cached writes */
 	unsigned big_writes:1;
 
+	/** Keep dirty pages in the page cache and send them in writepages */
+	unsigned writeback_cache:1;
+
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
@@ -538,6 +553,18 @@ static inline u64 get_node_id(struct inode *inode)
 	return get_fuse_inode(inode)->nodeid;
 }
 
+/**
+ * Open flags sent to the server with the writeback cache.  Partial page
+ * writes read the page through the same handle, so write-only opens
+ * become read-write; appending is done by the kernel, which owns i_size.
+ */
+static inline int fuse_writeback_open_flags(int flags)
+{
+	if ((flags & O_ACCMODE) == O_WRONLY)
+		flags = (flags & ~O_ACCMODE) | O_RDWR;
+	return flags & ~O_APPEND;
+}
+
 /** Device operations */
 extern const struct file_operations fuse_dev_operations;
 
@@ -647,7 +674,10 @@ void fuse_ctl_cleanup(void);
  */
 struct fuse_req *fuse_request_alloc(void);
 
-struct fuse_req *fuse_request_alloc_nofs(void);
+/**
+ * Allocate a request with room for npages pages, for writeback
+ */
+struct fuse_req *fuse_request_alloc_nofs(unsigned npages);
 
 /**
  * Free a request
@@ -659,6 +689,11 @@ void fuse_request_free(struct fuse_req *req);
  */
 struct fuse_req *fuse_get_req(struct fuse_conn *fc);
 
+/**
+ * Get a request with room for npages pages, may fail with -ENOMEM
+ */
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages);
+
 /**
  * Gets a requests for a file operation, always succeeds
  */
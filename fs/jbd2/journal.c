@@ -94,6 +94,10 @@ EXPORT_SYMBOL(jbd2_journal_file_inode);
 EXPORT_SYMBOL(jbd2_journal_init_jbd_inode);
 EXPORT_SYMBOL(jbd2_journal_release_jbd_inode);
 EXPORT_SYMBOL(jbd2_journal_begin_ordered_truncate);
+EXPORT_SYMBOL(jbd2_fc_begin_commit);
+EXPORT_SYMBOL(jbd2_fc_end_commit);
+EXPORT_SYMBOL(jbd2_fc_get_buf);
+EXPORT_SYMBOL(jbd2_fc_read_buf);
 EXPORT_SYMBOL(jbd2_inode_cache);
 
 static int journal_convert_superblock_v1(journal_t *, journal_superblock_t *);
@@ -744,6 +748,191 @@ struct journal_head *jbd2_journal_get_descriptor_buffer(journal_t *journal)
 	return jbd2_journal_add_journal_head(bh);
 }
 
+/*
+ * Fast commits
+ *
+ * With JBD2_FEATURE_INCOMPAT_INODE_FC, the last blocks of the journal
+ * are taken out of the log and given to the filesystem, which can log
+ * there whatever it needs to redo an fsync of the running transaction
+ * without committing it.  jbd2 only hands out the blocks and keeps fast
+ * and full commits apart; the format of the blocks and their replay
+ * after recovery are up to the filesystem.  A full commit supersedes all
+ * fast commits of its transaction, so the area starts over after each.
+ */
+
+static unsigned long jbd2_journal_fc_blocks(journal_superblock_t *sb)
+{
+	unsigned long num = be32_to_cpu(sb->s_inode_fc_blks);
+
+	return num ? num : JBD2_DEFAULT_FAST_COMMIT_BLOCKS;
+}
+
+/* Carve the fast commit area out of the end of an empty log. */
+static int journal_init_fast_commit(journal_t *journal)
+{
+	unsigned long num = jbd2_journal_fc_blocks(journal->j_superblock);
+	int err = 0;
+
+	write_lock(&journal->j_state_lock);
+	if (journal->j_running_transaction ||
+	    journal->j_committing_transaction ||
+	    journal->j_head != journal->j_first ||
+	    journal->j_tail != journal->j_first) {
+		err = -EBUSY;
+	} else if (journal->j_last - num <
+		   journal->j_first + JBD2_MIN_JOURNAL_BLOCKS) {
+		err = -ENOSPC;
+	} else {
+		journal->j_fc_last = journal->j_last;
+		journal->j_last -= num;
+		journal->j_fc_first = journal->j_last;
+		journal->j_fc_off = 0;
+		journal->j_free = journal->j_last - journal->j_first;
+	}
+	write_unlock(&journal->j_state_lock);
+	if (err)
+		printk(KERN_WARNING "JBD2: cannot reserve %lu fast commit "
+		       "blocks on %s: %d\n", num, journal->j_devname, err);
+	return err;
+}
+
+/**
+ * int jbd2_fc_begin_commit() - start a fast commit of a transaction
+ * @journal: Journal to act on.
+ * @tid: Transaction to fast commit.
+ *
+ * Returns 0 if @tid is running and the caller may write to the fast
+ * commit area until jbd2_fc_end_commit(); @tid will not start to commit
+ * meanwhile.  Returns -EALREADY if @tid has been committed already, and
+ * -EINVAL if a full commit of @tid is needed.
+ */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid)
+{
+	int ret;
+
+	if (!JBD2_HAS_INCOMPAT_FEATURE(journal,
+				       JBD2_FEATURE_INCOMPAT_INODE_FC))
+		return -EINVAL;
+
+	write_lock(&journal->j_state_lock);
+	while (journal->j_flags & JBD2_FAST_COMMIT_ONGOING) {
+		DEFINE_WAIT(wait);
+
+		prepare_to_wait(&journal->j_fc_wait, &wait,
+				TASK_UNINTERRUPTIBLE);
+		write_unlock(&journal->j_state_lock);
+		schedule();
+		write_lock(&journal->j_state_lock);
+		finish_wait(&journal->j_fc_wait, &wait);
+	}
+
+	if (tid_geq(journal->j_commit_sequence, tid))
+		ret = -EALREADY;
+	else if (!journal->j_running_transaction ||
+		 journal->j_running_transaction->t_tid != tid ||
+		 journal->j_running_transaction->t_state != T_RUNNING ||
+		 (journal->j_flags & (JBD2_FULL_COMMIT_ONGOING |
+				      JBD2_FLUSHED | JBD2_ABORT)))
+		/*
+		 * A flushed journal has s_start == 0 on disk and would not
+		 * even be recovered; the next full commit fixes that.
+		 */
+		ret = -EINVAL;
+	else {
+		journal->j_flags |= JBD2_FAST_COMMIT_ONGOING;
+		ret = 0;
+	}
+	write_unlock(&journal->j_state_lock);
+	return ret;
+}
+
+/**
+ * void jbd2_fc_end_commit() - end a fast commit
+ * @journal: Journal to act on.
+ */
+void jbd2_fc_end_commit(journal_t *journal)
+{
+	write_lock(&journal->j_state_lock);
+	journal->j_flags &= ~JBD2_FAST_COMMIT_ONGOING;
+	write_unlock(&journal->j_state_lock);
+	wake_up(&journal->j_fc_wait);
+}
+
+/**
+ * int jbd2_fc_get_buf() - get the next fast commit block
+ * @journal: Journal to act on.
+ * @bh_out: Returns a zeroed buffer for the block.
+ *
+ * Only valid between jbd2_fc_begin_commit() and jbd2_fc_end_commit().
+ * The caller fills the buffer, writes it out and releases it.  Returns
+ * -ENOSPC once the area is full, a full commit is needed then.
+ */
+int jbd2_fc_get_buf(journal_t *journal, struct buffer_head **bh_out)
+{
+	unsigned long long pblock;
+	struct buffer_head *bh;
+	int err;
+
+	J_ASSERT(journal->j_flags & JBD2_FAST_COMMIT_ONGOING);
+
+	if (journal->j_fc_first + journal->j_fc_off >= journal->j_fc_last)
+		return -ENOSPC;
+
+	err = jbd2_journal_bmap(journal,
+				journal->j_fc_first + journal->j_fc_off, &pblock);
+	if (err)
+		return err;
+
+	bh = __getblk(journal->j_dev, pblock, journal->j_blocksize);
+	if (!bh)
+		return -ENOMEM;
+	journal->j_fc_off++;
+
+	lock_buffer(bh);
+	memset(bh->b_data, 0, journal->j_blocksize);
+	set_buffer_uptodate(bh);
+	unlock_buffer(bh);
+	*bh_out = bh;
+	return 0;
+}
+
+/**
+ * int jbd2_fc_read_buf() - read a fast commit block for replay
+ * @journal: Journal to act on.
+ * @off: Index of the block in the fast commit area.
+ * @bh_out: Returns the block.
+ *
+ * Returns -ENOENT past the end of the area.
+ */
+int jbd2_fc_read_buf(journal_t *journal, unsigned long off,
+		     struct buffer_head **bh_out)
+{
+	unsigned long long pblock;
+	struct buffer_head *bh;
+	int err;
+
+	if (journal->j_fc_first + off >= journal->j_fc_last)
+		return -ENOENT;
+
+	err = jbd2_journal_bmap(journal, journal->j_fc_first + off, &pblock);
+	if (err)
+		return err;
+
+	bh = __getblk(journal->j_dev, pblock, journal->j_blocksize);
+	if (!bh)
+		return -ENOMEM;
+	if (!buffer_uptodate(bh)) {
+		ll_rw_block(READ, 1, &bh);
+		wait_on_buffer(bh);
+		if (!buffer_uptodate(bh)) {
+			brelse(bh);
+			return -EIO;
+		}
+	}
+	*bh_out = bh;
+	return 0;
+}
+
 struct jbd2_stats_proc_session {
 	journal_t *journal;
 	struct transaction_stats_s *stats;
@@ -894,6 +1083,7 @@ static journal_t * journal_init_common (void)
 	init_waitqueue_head(&journal->j_wait_checkpoint);
 	init_waitqueue_head(&journal->j_wait_commit);
 	init_waitqueue_head(&journal->j_wait_updates);
+	init_waitqueue_head(&journal->j_fc_wait);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
 	spin_lock_init(&journal->j_revoke_lock);
@@ -1092,6 +1282,13 @@ static int journal_reset(journal_t *journal)
 
 	first = be32_to_cpu(sb->s_first);
 	last = be32_to_cpu(sb->s_maxlen);
+	if (JBD2_HAS_INCOMPAT_FEATURE(journal,
+				      JBD2_FEATURE_INCOMPAT_INODE_FC)) {
+		journal->j_fc_last = last;
+		last -= jbd2_journal_fc_blocks(sb);
+		journal->j_fc_first = last;
+		journal->j_fc_off = 0;
+	}
 	if (first + JBD2_MIN_JOURNAL_BLOCKS > last + 1) {
 		printk(KERN_ERR "JBD: Journal too short (blocks %llu-%llu).\n",
 		       first, last);
@@ -1288,6 +1485,14 @@ static int load_superblock(journal_t *journal)
 	journal->j_last = be32_to_cpu(sb->s_maxlen);
 	journal->j_errno = be32_to_cpu(sb->s_errno);
 
+	/* the log ends where the fast commit area starts */
+	if (JBD2_HAS_INCOMPAT_FEATURE(journal,
+				      JBD2_FEATURE_INCOMPAT_INODE_FC)) {
+		journal->j_fc_last = journal->j_last;
+		journal->j_last -= jbd2_journal_fc_blocks(sb);
+		journal->j_fc_first = journal->j_last;
+	}
+
 	return 0;
 }
 
@@ -1515,6 +1720,12 @@ int jbd2_journal_set_features (journal_t *journal, unsigned long compat,
 
 	sb = journal->j_superblock;
 
+	if ((incompat & JBD2_FEATURE_INCOMPAT_INODE_FC) &&
+	    !JBD2_HAS_INCOMPAT_FEATURE(journal,
+				       JBD2_FEATURE_INCOMPAT_INODE_FC) &&
+	    journal_init_fast_commit(journal))
+		return 0;
+
 	sb->s_feature_compat    |= cpu_to_be32(compat);
 	sb->s_feature_ro_compat |= cpu_to_be32(ro);
 	sb->s_feature_incompat  |= cpu_to_be32(incompat);
@@ -257,6 +257,14 @@ int jbd2_journal_recover(journal_t *journal)
 	jbd_debug(1, "JBD: Replayed %d and revoked %d/%d blocks\n",
 		  info.nr_replays, info.nr_revoke_hits, info.nr_revokes);
 
+	/* Fast commits of the first transaction that did not make it
+	 * to the log are left for the filesystem to replay. */
+	if (!err && JBD2_HAS_INCOMPAT_FEATURE(journal,
+				JBD2_FEATURE_INCOMPAT_INODE_FC)) {
+		journal->j_fc_replay_tid = info.end_transaction;
+		journal->j_flags |= JBD2_FC_REPLAY;
+	}
+
 	/* Restart the log at the next transaction ID, thus invalidating
 	 * any existing commit records in the log. */
 	journal->j_transaction_sequence = ++info.end_transaction;
@@ -32,6 +32,8 @@
 #include <linux/fcntl.h>
 #include <linux/device_cgroup.h>
 #include <linux/fs_struct.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <asm/uaccess.h>
 
 #include "internal.h"
@@ -405,17 +407,106 @@ EXPORT_SYMBOL(path_put);
  * to restart the path walk from the beginning in ref-walk mode.
  */
 
+/*
+ * How rcu-walk lookups end, see "Interesting statistics" in
+ * Documentation/filesystems/path-lookup.txt.
+ */
+enum rcu_walk_item {
+	RCU_WALK_LOOKUPS,
+	RCU_WALK_COMPLETED,
+	RCU_WALK_NEGATIVE,
+	RCU_WALK_NODENTRY,
+	RCU_WALK_REVALIDATE,
+	RCU_WALK_MOUNT,
+	RCU_WALK_PERMISSION,
+	RCU_WALK_LINK,
+	RCU_WALK_UNLAZY_FAILED,
+	RCU_WALK_RESTART_SEQ,
+	RCU_WALK_RESTART_DOTDOT,
+	RCU_WALK_RESTART_COMPLETE,
+	RCU_WALK_RESTARTS,
+	NR_RCU_WALK_ITEMS
+};
+
+#ifdef CONFIG_RCU_WALK_STATS
+struct rcu_walk_stats {
+	unsigned long item[NR_RCU_WALK_ITEMS];
+};
+
+static DEFINE_PER_CPU(struct rcu_walk_stats, rcu_walk_stats);
+
+static const char * const rcu_walk_item_names[NR_RCU_WALK_ITEMS] = {
+	"lookups",
+	"completed",
+	"negative",
+	"nodentry",
+	"revalidate",
+	"mount",
+	"permission",
+	"link",
+	"unlazy_failed",
+	"restart_seq",
+	"restart_dotdot",
+	"restart_complete",
+	"restarts",
+};
+
+static inline void rcu_walk_count(enum rcu_walk_item item)
+{
+	this_cpu_inc(rcu_walk_stats.item[item]);
+}
+
+static int rcu_walk_stats_show(struct seq_file *m, void *v)
+{
+	int i, cpu;
+
+	for (i = 0; i < NR_RCU_WALK_ITEMS; i++) {
+		unsigned long sum = 0;
+
+		for_each_possible_cpu(cpu)
+			sum += per_cpu(rcu_walk_stats, cpu).item[i];
+		seq_printf(m, "%-16s %lu\n", rcu_walk_item_names[i], sum);
+	}
+	return 0;
+}
+
+static int rcu_walk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rcu_walk_stats_show, NULL);
+}
+
+static const struct file_operations rcu_walk_stats_fops = {
+	.open		= rcu_walk_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init rcu_walk_stats_init(void)
+{
+	proc_create("fs/rcu_walk_stats", 0444, NULL, &rcu_walk_stats_fops);
+	return 0;
+}
+module_init(rcu_walk_stats_init);
+#else
+static inline void rcu_walk_count(enum rcu_walk_item item)
+{
+}
+#endif
+
 /**
  * unlazy_walk - try to switch to ref-walk mode.
  * @nd: nameidata pathwalk data
  * @dentry: child of nd->path.dentry or NULL
+ * @reason: why rcu-walk can't go on, for the statistics
  * Returns: 0 on success, -ECHILD on failure
  *
  * unlazy_walk attempts to legitimize the current nd->path, nd->root and dentry
  * for ref-walk mode.  @dentry must be a path found by a do_lookup call on
  * @nd or NULL.  Must be called from rcu-walk context.
  */
-static int unlazy_walk(struct nameidata *nd, struct dentry *dentry)
+static int unlazy_walk(struct nameidata *nd, struct dentry *dentry,
+		       enum rcu_walk_item reason)
 {
 	struct fs_struct *fs = current->fs;
 	struct dentry *parent = nd->path.dentry;
@@ -461,6 +552,7 @@ static int unlazy_walk(struct nameidata *nd, struct dentry *dentry)
 	rcu_read_unlock();
 	br_read_unlock(vfsmount_lock);
 	nd->flags &= ~LOOKUP_RCU;
+	rcu_walk_count(reason);
 	return 0;
 
 err_child:
@@ -470,6 +562,7 @@ err_parent:
 err_root:
 	if (want_root)
 		spin_unlock(&fs->lock);
+	rcu_walk_count(RCU_WALK_UNLAZY_FAILED);
 	return -ECHILD;
 }
 
@@ -540,6 +633,7 @@ static int complete_walk(struct nameidata *nd)
 			spin_unlock(&dentry->d_lock);
 			rcu_read_unlock();
 			br_read_unlock(vfsmount_lock);
+			rcu_walk_count(RCU_WALK_RESTART_COMPLETE);
 			return -ECHILD;
 		}
 		BUG_ON(nd->inode != dentry->d_inode);
@@ -547,6 +641,7 @@ static int complete_walk(struct nameidata *nd)
 		mntget(nd->path.mnt);
 		rcu_read_unlock();
 		br_read_unlock(vfsmount_lock);
+		rcu_walk_count(RCU_WALK_COMPLETED);
 	}
 
 	if (likely(!(nd->flags & LOOKUP_JUMPED)))
@@ -1018,6 +1113,7 @@ failed:
 		nd->root.mnt = NULL;
 	rcu_read_unlock();
 	br_read_unlock(vfsmount_lock);
+	rcu_walk_count(RCU_WALK_RESTART_DOTDOT);
 	return -ECHILD;
 }
 
@@ -1159,6 +1255,7 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 	 * do the non-racy lookup, below.
 	 */
 	if (nd->flags & LOOKUP_RCU) {
+		enum rcu_walk_item reason = RCU_WALK_NODENTRY;
 		unsigned seq;
 		*inode = nd->inode;
 		dentry = __d_lookup_rcu(parent, name, &seq, inode);
@@ -1166,8 +1263,10 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 			goto unlazy;
 
 		/* Memory barrier in read_seqcount_begin of child is enough */
-		if (__read_seqcount_retry(&parent->d_seq, nd->seq))
+		if (__read_seqcount_retry(&parent->d_seq, nd->seq)) {
+			rcu_walk_count(RCU_WALK_RESTART_SEQ);
 			return -ECHILD;
+		}
 		nd->seq = seq;
 
 		if (unlikely(dentry->d_flags & DCACHE_OP_REVALIDATE)) {
@@ -1175,18 +1274,20 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 			if (unlikely(status <= 0)) {
 				if (status != -ECHILD)
 					need_reval = 0;
+				reason = RCU_WALK_REVALIDATE;
 				goto unlazy;
 			}
 		}
 		path->mnt = mnt;
 		path->dentry = dentry;
+		reason = RCU_WALK_MOUNT;
 		if (unlikely(!__follow_mount_rcu(nd, path, inode)))
 			goto unlazy;
 		if (unlikely(path->dentry->d_flags & DCACHE_NEED_AUTOMOUNT))
 			goto unlazy;
 		return 0;
 unlazy:
-		if (unlazy_walk(nd, dentry))
+		if (unlazy_walk(nd, dentry, reason))
 			return -ECHILD;
 	} else {
 		dentry = __d_lookup(parent, name);
@@ -1245,7 +1346,7 @@ static inline int may_lookup(struct nameidata *nd)
 		int err = exec_permission(nd->inode, IPERM_FLAG_RCU);
 		if (err != -ECHILD)
 			return err;
-		if (unlazy_walk(nd, NULL))
+		if (unlazy_walk(nd, NULL, RCU_WALK_PERMISSION))
 			return -ECHILD;
 	}
 	return exec_permission(nd->inode, 0);
@@ -1294,13 +1395,18 @@ static inline int walk_component(struct nameidata *nd, struct path *path,
 		return err;
 	}
 	if (!inode) {
+		if (nd->flags & LOOKUP_RCU) {
+			d_negative_referenced(path->dentry);
+			rcu_walk_count(RCU_WALK_NEGATIVE);
+		}
 		path_to_nameidata(path, nd);
 		terminate_walk(nd);
 		return -ENOENT;
 	}
 	if (unlikely(inode->i_op->follow_link) && follow) {
 		if (nd->flags & LOOKUP_RCU) {
-			if (unlikely(unlazy_walk(nd, path->dentry))) {
+			if (unlikely(unlazy_walk(nd, path->dentry,
+						 RCU_WALK_LINK))) {
 				terminate_walk(nd);
 				return -ECHILD;
 			}
@@ -1626,9 +1732,14 @@ static int path_lookupat(int dfd, const char *name,
 static int do_path_lookup(int dfd, const char *name,
 				unsigned int flags, struct nameidata *nd)
 {
-	int retval = path_lookupat(dfd, name, flags | LOOKUP_RCU, nd);
-	if (unlikely(retval == -ECHILD))
+	int retval;
+
+	rcu_walk_count(RCU_WALK_LOOKUPS);
+	retval = path_lookupat(dfd, name, flags | LOOKUP_RCU, nd);
+	if (unlikely(retval == -ECHILD)) {
+		rcu_walk_count(RCU_WALK_RESTARTS);
 		retval = path_lookupat(dfd, name, flags, nd);
+	}
 	if (unlikely(retval == -ESTALE))
 		retval = path_lookupat(dfd, name, flags | LOOKUP_REVAL, nd);
 
@@ -2322,9 +2433,12 @@ struct file *do_filp_open(int dfd, const char *pathname,
 	struct nameidata nd;
 	struct file *filp;
 
+	rcu_walk_count(RCU_WALK_LOOKUPS);
 	filp = path_openat(dfd, pathname, &nd, op, flags | LOOKUP_RCU);
-	if (unlikely(filp == ERR_PTR(-ECHILD)))
+	if (unlikely(filp == ERR_PTR(-ECHILD))) {
+		rcu_walk_count(RCU_WALK_RESTARTS);
 		filp = path_openat(dfd, pathname, &nd, op, flags);
+	}
 	if (unlikely(filp == ERR_PTR(-ESTALE)))
 		filp = path_openat(dfd, pathname, &nd, op, flags | LOOKUP_REVAL);
 	return filp;
@@ -2344,9 +2458,12 @@ struct file *do_file_open_root(struct dentry *dentry, struct vfsmount *mnt,
 	if (dentry->d_inode->i_op->follow_link && op->intent & LOOKUP_OPEN)
 		return ERR_PTR(-ELOOP);
 
+	rcu_walk_count(RCU_WALK_LOOKUPS);
 	file = path_openat(-1, name, &nd, op, flags | LOOKUP_RCU);
-	if (unlikely(file == ERR_PTR(-ECHILD)))
+	if (unlikely(file == ERR_PTR(-ECHILD))) {
+		rcu_walk_count(RCU_WALK_RESTARTS);
 		file = path_openat(-1, name, &nd, op, flags);
+	}
 	if (unlikely(file == ERR_PTR(-ESTALE)))
 		file = path_openat(-1, name, &nd, op, flags | LOOKUP_REVAL);
 	return file;
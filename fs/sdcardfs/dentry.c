@@ -0,0 +1,83 @@
+/*
+ * sdcardfs: dentry operations
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#include <linux/dcache.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include "sdcardfs.h"
+
+struct kmem_cache *sdcardfs_dentry_info_cache;
+
+/**
+ * sdcardfs_d_revalidate - revalidate against the lower dentry
+ *
+ * The lower directory may be changed behind our back (MTP, adb push to the
+ * underlying path), so an upper dentry is only valid while its lower
+ * dentry is still hashed and still revalidates.
+ */
+static int sdcardfs_d_revalidate(struct dentry *dentry, struct nameidata *nd)
+{
+	struct path lower_path;
+	struct dentry *lower_dentry;
+	int rc = 1;
+
+	if (nd && nd->flags & LOOKUP_RCU)
+		return -ECHILD;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	lower_dentry = lower_path.dentry;
+
+	if (d_unhashed(lower_dentry) ||
+	    (dentry->d_inode && !lower_dentry->d_inode)) {
+		rc = 0;
+		goto out;
+	}
+
+	if (lower_dentry->d_op && lower_dentry->d_op->d_revalidate) {
+		rc = lower_dentry->d_op->d_revalidate(lower_dentry, NULL);
+		if (rc <= 0)
+			goto out;
+	}
+
+	if (dentry->d_inode)
+		sdcardfs_copy_attr(dentry->d_inode, lower_dentry->d_inode);
+out:
+	path_put(&lower_path);
+	return rc;
+}
+
+static void sdcardfs_d_release(struct dentry *dentry)
+{
+	struct sdcardfs_dentry_info *info = SDCARDFS_D(dentry);
+
+	if (!info)
+		return;
+
+	path_put(&info->lower_path);
+	kmem_cache_free(sdcardfs_dentry_info_cache, info);
+	dentry->d_fsdata = NULL;
+}
+
+int sdcardfs_new_dentry_private(struct dentry *dentry)
+{
+	struct sdcardfs_dentry_info *info;
+
+	info = kmem_cache_zalloc(sdcardfs_dentry_info_cache, GFP_KERNEL);
+	if (!info)
+		return -ENOMEM;
+
+	spin_lock_init(&info->lock);
+	dentry->d_fsdata = info;
+	return 0;
+}
+
+const struct dentry_operations sdcardfs_dops = {
+	.d_revalidate	= sdcardfs_d_revalidate,
+	.d_release	= sdcardfs_d_release,
+};
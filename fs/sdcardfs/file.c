@@ -0,0 +1,225 @@
+/*
+ * sdcardfs: file operations
+ *
+ * Every open upper file has an open lower file, and reads, writes, splice
+ * and mmap go straight to it. No data is cached at this layer.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/fs_stack.h>
+#include <linux/mm.h>
+#include <linux/mount.h>
+#include <linux/slab.h>
+#include "sdcardfs.h"
+
+static ssize_t sdcardfs_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	ssize_t err;
+
+	err = vfs_read(lower_file, buf, count, ppos);
+	if (err >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+static ssize_t sdcardfs_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	ssize_t err;
+
+	err = vfs_write(lower_file, buf, count, ppos);
+	if (err >= 0) {
+		fsstack_copy_inode_size(inode, lower_file->f_path.dentry->d_inode);
+		fsstack_copy_attr_times(inode, lower_file->f_path.dentry->d_inode);
+	}
+	return err;
+}
+
+static ssize_t sdcardfs_splice_read(struct file *file, loff_t *ppos,
+				    struct pipe_inode_info *pipe, size_t len,
+				    unsigned int flags)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (!lower_file->f_op || !lower_file->f_op->splice_read)
+		return -EINVAL;
+
+	return lower_file->f_op->splice_read(lower_file, ppos, pipe, len, flags);
+}
+
+static ssize_t sdcardfs_splice_write(struct pipe_inode_info *pipe,
+				     struct file *file, loff_t *ppos,
+				     size_t len, unsigned int flags)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	ssize_t err;
+
+	if (!lower_file->f_op || !lower_file->f_op->splice_write)
+		return -EINVAL;
+
+	err = lower_file->f_op->splice_write(pipe, lower_file, ppos, len, flags);
+	if (err >= 0) {
+		fsstack_copy_inode_size(inode, lower_file->f_path.dentry->d_inode);
+		fsstack_copy_attr_times(inode, lower_file->f_path.dentry->d_inode);
+	}
+	return err;
+}
+
+static loff_t sdcardfs_llseek(struct file *file, loff_t offset, int origin)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	loff_t ret;
+
+	/* let the lower fs resolve SEEK_END and directory cookies */
+	lower_file->f_pos = file->f_pos;
+	ret = vfs_llseek(lower_file, offset, origin);
+	if (ret >= 0)
+		file->f_pos = lower_file->f_pos;
+	return ret;
+}
+
+static int sdcardfs_readdir(struct file *file, void *dirent, filldir_t filldir)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	int err;
+
+	lower_file->f_pos = file->f_pos;
+	err = vfs_readdir(lower_file, filldir, dirent);
+	file->f_pos = lower_file->f_pos;
+	if (err >= 0)
+		fsstack_copy_attr_atime(file->f_path.dentry->d_inode,
+					lower_file->f_path.dentry->d_inode);
+	return err;
+}
+
+static long sdcardfs_unlocked_ioctl(struct file *file, unsigned int cmd,
+				    unsigned long arg)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (!lower_file->f_op || !lower_file->f_op->unlocked_ioctl)
+		return -ENOTTY;
+
+	return lower_file->f_op->unlocked_ioctl(lower_file, cmd, arg);
+}
+
+/**
+ * sdcardfs_mmap - map the lower file in place of the upper one
+ *
+ * The vma is handed over to the lower file, so pages are only ever cached
+ * by the lower fs and page faults never pass through this layer.
+ */
+static int sdcardfs_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+	int err;
+
+	if (!lower_file->f_op || !lower_file->f_op->mmap)
+		return -ENODEV;
+
+	vma->vm_file = lower_file;
+	err = lower_file->f_op->mmap(lower_file, vma);
+	if (err) {
+		vma->vm_file = file;
+		return err;
+	}
+
+	/* swap the reference mmap_region() took on the upper file */
+	get_file(lower_file);
+	fput(file);
+	return 0;
+}
+
+static int sdcardfs_open(struct inode *inode, struct file *file)
+{
+	struct sdcardfs_file_info *info;
+	const struct cred *old_cred;
+	struct file *lower_file;
+	struct path lower_path;
+
+	info = kzalloc(sizeof(*info), GFP_KERNEL);
+	if (!info)
+		return -ENOMEM;
+
+	old_cred = sdcardfs_override_creds(inode->i_sb);
+	if (!old_cred) {
+		kfree(info);
+		return -ENOMEM;
+	}
+
+	/* dentry_open() consumes the lower path references */
+	sdcardfs_get_lower_path(file->f_path.dentry, &lower_path);
+	lower_file = dentry_open(lower_path.dentry, lower_path.mnt,
+				 file->f_flags, current_cred());
+	revert_creds(old_cred);
+
+	if (IS_ERR(lower_file)) {
+		kfree(info);
+		return PTR_ERR(lower_file);
+	}
+
+	info->lower_file = lower_file;
+	file->private_data = info;
+	sdcardfs_copy_attr(inode, sdcardfs_lower_inode(inode));
+	return 0;
+}
+
+static int sdcardfs_flush(struct file *file, fl_owner_t id)
+{
+	struct file *lower_file = sdcardfs_lower_file(file);
+
+	if (lower_file && lower_file->f_op && lower_file->f_op->flush)
+		return lower_file->f_op->flush(lower_file, id);
+
+	return 0;
+}
+
+static int sdcardfs_release(struct inode *inode, struct file *file)
+{
+	struct sdcardfs_file_info *info = SDCARDFS_F(file);
+
+	fput(info->lower_file);
+	kfree(info);
+	return 0;
+}
+
+static int sdcardfs_fsync(struct file *file, int datasync)
+{
+	return vfs_fsync(sdcardfs_lower_file(file), datasync);
+}
+
+const struct file_operations sdcardfs_main_fops = {
+	.llseek		= sdcardfs_llseek,
+	.read		= sdcardfs_read,
+	.write		= sdcardfs_write,
+	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
+	.mmap		= sdcardfs_mmap,
+	.open		= sdcardfs_open,
+	.flush		= sdcardfs_flush,
+	.release	= sdcardfs_release,
+	.fsync		= sdcardfs_fsync,
+	.splice_read	= sdcardfs_splice_read,
+	.splice_write	= sdcardfs_splice_write,
+};
+
+const struct file_operations sdcardfs_dir_fops = {
+	.llseek		= sdcardfs_llseek,
+	.read		= generic_read_dir,
+	.readdir	= sdcardfs_readdir,
+	.unlocked_ioctl	= sdcardfs_unlocked_ioctl,
+	.open		= sdcardfs_open,
+	.release	= sdcardfs_release,
+	.fsync		= sdcardfs_fsync,
+};
@@ -0,0 +1,464 @@
+/*
+ * sdcardfs: inode operations
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#include <linux/fs.h>
+#include <linux/fs_stack.h>
+#include <linux/namei.h>
+#include <linux/mount.h>
+#include <linux/slab.h>
+#include "sdcardfs.h"
+
+static struct dentry *lock_parent(struct dentry *dentry)
+{
+	struct dentry *dir;
+
+	dir = dget_parent(dentry);
+	mutex_lock_nested(&(dir->d_inode->i_mutex), I_MUTEX_PARENT);
+	return dir;
+}
+
+static void unlock_dir(struct dentry *dir)
+{
+	mutex_unlock(&dir->d_inode->i_mutex);
+	dput(dir);
+}
+
+/**
+ * sdcardfs_override_creds - switch to the lower fs credentials
+ *
+ * Lower fs operations are done as the owner of the lower tree (media_rw on
+ * Android), whatever the uid of the calling app. The caller has already
+ * passed the permission checks on the upper inodes. Returns the old
+ * credentials for revert_creds(), or NULL if out of memory.
+ */
+const struct cred *sdcardfs_override_creds(struct super_block *sb)
+{
+	struct sdcardfs_mount_options *opts = &SDCARDFS_SB(sb)->options;
+	const struct cred *old;
+	struct cred *cred;
+
+	cred = prepare_creds();
+	if (!cred)
+		return NULL;
+
+	cred->fsuid = opts->lower_uid;
+	cred->fsgid = opts->lower_gid;
+	old = override_creds(cred);
+	put_cred(cred);
+	return old;
+}
+
+/**
+ * sdcardfs_copy_attr - refresh an inode from its lower inode
+ *
+ * Everything but ownership and permissions comes from the lower inode.
+ * Those are fixed per mount, like the sdcard daemon presented them.
+ */
+void sdcardfs_copy_attr(struct inode *inode, struct inode *lower_inode)
+{
+	struct sdcardfs_mount_options *opts = &SDCARDFS_SB(inode->i_sb)->options;
+	umode_t perm;
+
+	fsstack_copy_attr_all(inode, lower_inode);
+	fsstack_copy_inode_size(inode, lower_inode);
+
+	perm = S_ISDIR(lower_inode->i_mode) ? 0775 : 0664;
+	inode->i_mode = (lower_inode->i_mode & S_IFMT) | (perm & ~opts->mask);
+	inode->i_uid = opts->uid;
+	inode->i_gid = opts->gid;
+}
+
+static int sdcardfs_inode_test(struct inode *inode, void *lower_inode)
+{
+	return sdcardfs_lower_inode(inode) == (struct inode *)lower_inode;
+}
+
+static int sdcardfs_inode_set(struct inode *inode, void *lower_inode)
+{
+	SDCARDFS_I(inode)->lower_inode = lower_inode;
+	return 0;
+}
+
+/**
+ * sdcardfs_get_inode - find or create the upper inode for a lower inode
+ *
+ * Takes a reference on lower_inode for a new upper inode; it is dropped
+ * again when the upper inode is evicted.
+ */
+struct inode *sdcardfs_get_inode(struct inode *lower_inode,
+				 struct super_block *sb)
+{
+	struct inode *inode;
+
+	if (lower_inode->i_sb != SDCARDFS_SB(sb)->lower_sb)
+		return ERR_PTR(-EXDEV);
+	if (!igrab(lower_inode))
+		return ERR_PTR(-ESTALE);
+
+	inode = iget5_locked(sb, (unsigned long)lower_inode,
+			     sdcardfs_inode_test, sdcardfs_inode_set,
+			     lower_inode);
+	if (!inode) {
+		iput(lower_inode);
+		return ERR_PTR(-ENOMEM);
+	}
+	if (!(inode->i_state & I_NEW)) {
+		iput(lower_inode);
+		return inode;
+	}
+
+	inode->i_ino = lower_inode->i_ino;
+	inode->i_version++;
+	sdcardfs_copy_attr(inode, lower_inode);
+
+	if (S_ISDIR(inode->i_mode)) {
+		inode->i_op = &sdcardfs_dir_iops;
+		inode->i_fop = &sdcardfs_dir_fops;
+	} else if (S_ISREG(inode->i_mode)) {
+		inode->i_op = &sdcardfs_main_iops;
+		inode->i_fop = &sdcardfs_main_fops;
+	} else {
+		/* no symlinks, devices or fifos on emulated storage */
+		inode->i_op = &sdcardfs_main_iops;
+		init_special_inode(inode, inode->i_mode, lower_inode->i_rdev);
+	}
+
+	unlock_new_inode(inode);
+	return inode;
+}
+
+/* instantiate a newly created dentry with the inode of its lower dentry */
+static int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
+			      struct path *lower_path)
+{
+	struct inode *inode;
+
+	inode = sdcardfs_get_inode(lower_path->dentry->d_inode, sb);
+	if (IS_ERR(inode))
+		return PTR_ERR(inode);
+
+	d_instantiate(dentry, inode);
+	return 0;
+}
+
+/**
+ * sdcardfs_lookup - look a name up in the lower directory
+ *
+ * Negative lower dentries are kept as well, so that create and mkdir find
+ * the lower dentry to instantiate.
+ */
+static struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
+				      struct nameidata *nd)
+{
+	struct path lower_parent_path, lower_path;
+	struct dentry *lower_dentry;
+	struct inode *inode = NULL;
+	const struct cred *old_cred;
+	int err;
+
+	sdcardfs_get_lower_path(dentry->d_parent, &lower_parent_path);
+
+	err = sdcardfs_new_dentry_private(dentry);
+	if (err)
+		goto out;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	if (!old_cred) {
+		err = -ENOMEM;
+		goto out;
+	}
+	mutex_lock(&lower_parent_path.dentry->d_inode->i_mutex);
+	lower_dentry = lookup_one_len(dentry->d_name.name,
+				      lower_parent_path.dentry,
+				      dentry->d_name.len);
+	mutex_unlock(&lower_parent_path.dentry->d_inode->i_mutex);
+	revert_creds(old_cred);
+
+	if (IS_ERR(lower_dentry)) {
+		err = PTR_ERR(lower_dentry);
+		goto out;
+	}
+
+	lower_path.dentry = lower_dentry;
+	lower_path.mnt = mntget(lower_parent_path.mnt);
+	sdcardfs_set_lower_path(dentry, &lower_path);
+
+	if (lower_dentry->d_inode) {
+		inode = sdcardfs_get_inode(lower_dentry->d_inode, dir->i_sb);
+		if (IS_ERR(inode)) {
+			err = PTR_ERR(inode);
+			goto out;
+		}
+	}
+
+	d_add(dentry, inode);
+	fsstack_copy_attr_atime(dir, lower_parent_path.dentry->d_inode);
+out:
+	path_put(&lower_parent_path);
+	return ERR_PTR(err);
+}
+
+static int sdcardfs_create(struct inode *dir, struct dentry *dentry,
+			   int mode, struct nameidata *nd)
+{
+	struct dentry *lower_dentry, *lower_parent_dentry;
+	const struct cred *old_cred;
+	struct path lower_path;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	if (!old_cred)
+		return -ENOMEM;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	lower_dentry = lower_path.dentry;
+	lower_parent_dentry = lock_parent(lower_dentry);
+
+	err = vfs_create(lower_parent_dentry->d_inode, lower_dentry,
+			 SDCARDFS_LOWER_FILE_MODE | S_IFREG, NULL);
+	if (err)
+		goto out;
+
+	err = sdcardfs_interpose(dentry, dir->i_sb, &lower_path);
+	if (err)
+		goto out;
+	sdcardfs_copy_attr(dir, lower_parent_dentry->d_inode);
+out:
+	unlock_dir(lower_parent_dentry);
+	path_put(&lower_path);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_mkdir(struct inode *dir, struct dentry *dentry, int mode)
+{
+	struct dentry *lower_dentry, *lower_parent_dentry;
+	const struct cred *old_cred;
+	struct path lower_path;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	if (!old_cred)
+		return -ENOMEM;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	lower_dentry = lower_path.dentry;
+	lower_parent_dentry = lock_parent(lower_dentry);
+
+	err = vfs_mkdir(lower_parent_dentry->d_inode, lower_dentry,
+			SDCARDFS_LOWER_DIR_MODE);
+	if (err)
+		goto out;
+
+	err = sdcardfs_interpose(dentry, dir->i_sb, &lower_path);
+	if (err)
+		goto out;
+	sdcardfs_copy_attr(dir, lower_parent_dentry->d_inode);
+	dir->i_nlink = lower_parent_dentry->d_inode->i_nlink;
+out:
+	unlock_dir(lower_parent_dentry);
+	path_put(&lower_path);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_unlink(struct inode *dir, struct dentry *dentry)
+{
+	struct dentry *lower_dentry, *lower_dir_dentry;
+	const struct cred *old_cred;
+	struct path lower_path;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	if (!old_cred)
+		return -ENOMEM;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	lower_dentry = lower_path.dentry;
+	dget(lower_dentry);
+	lower_dir_dentry = lock_parent(lower_dentry);
+
+	err = vfs_unlink(lower_dir_dentry->d_inode, lower_dentry);
+	if (err)
+		goto out;
+
+	sdcardfs_copy_attr(dir, lower_dir_dentry->d_inode);
+	dentry->d_inode->i_nlink =
+		sdcardfs_lower_inode(dentry->d_inode)->i_nlink;
+	dentry->d_inode->i_ctime = dir->i_ctime;
+	d_drop(dentry);
+out:
+	unlock_dir(lower_dir_dentry);
+	dput(lower_dentry);
+	path_put(&lower_path);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_rmdir(struct inode *dir, struct dentry *dentry)
+{
+	struct dentry *lower_dentry, *lower_dir_dentry;
+	const struct cred *old_cred;
+	struct path lower_path;
+	int err;
+
+	old_cred = sdcardfs_override_creds(dir->i_sb);
+	if (!old_cred)
+		return -ENOMEM;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	lower_dentry = lower_path.dentry;
+	lower_dir_dentry = lock_parent(lower_dentry);
+
+	err = vfs_rmdir(lower_dir_dentry->d_inode, lower_dentry);
+	if (err)
+		goto out;
+
+	d_drop(dentry);
+	if (dentry->d_inode)
+		clear_nlink(dentry->d_inode);
+	sdcardfs_copy_attr(dir, lower_dir_dentry->d_inode);
+	dir->i_nlink = lower_dir_dentry->d_inode->i_nlink;
+out:
+	unlock_dir(lower_dir_dentry);
+	path_put(&lower_path);
+	revert_creds(old_cred);
+	return err;
+}
+
+static int sdcardfs_rename(struct inode *old_dir, struct dentry *old_dentry,
+			   struct inode *new_dir, struct dentry *new_dentry)
+{
+	struct dentry *lower_old_dentry, *lower_new_dentry;
+	struct dentry *lower_old_dir_dentry, *lower_new_dir_dentry;
+	struct dentry *trap;
+	const struct cred *old_cred;
+	struct path lower_old_path, lower_new_path;
+	int err;
+
+	old_cred = sdcardfs_override_creds(old_dir->i_sb);
+	if (!old_cred)
+		return -ENOMEM;
+
+	sdcardfs_get_lower_path(old_dentry, &lower_old_path);
+	sdcardfs_get_lower_path(new_dentry, &lower_new_path);
+	lower_old_dentry = lower_old_path.dentry;
+	lower_new_dentry = lower_new_path.dentry;
+	lower_old_dir_dentry = dget_parent(lower_old_dentry);
+	lower_new_dir_dentry = dget_parent(lower_new_dentry);
+
+	trap = lock_rename(lower_old_dir_dentry, lower_new_dir_dentry);
+	err = -EINVAL;
+	/* source should not be ancestor of target */
+	if (trap == lower_old_dentry)
+		goto out;
+	err = -ENOTEMPTY;
+	/* target should not be an ancestor of source */
+	if (trap == lower_new_dentry)
+		goto out;
+
+	err = vfs_rename(lower_old_dir_dentry->d_inode, lower_old_dentry,
+			 lower_new_dir_dentry->d_inode, lower_new_dentry);
+	if (err)
+		goto out;
+
+	sdcardfs_copy_attr(new_dir, lower_new_dir_dentry->d_inode);
+	if (new_dir != old_dir)
+		sdcardfs_copy_attr(old_dir, lower_old_dir_dentry->d_inode);
+out:
+	unlock_rename(lower_old_dir_dentry, lower_new_dir_dentry);
+	dput(lower_old_dir_dentry);
+	dput(lower_new_dir_dentry);
+	path_put(&lower_old_path);
+	path_put(&lower_new_path);
+	revert_creds(old_cred);
+	return err;
+}
+
+/**
+ * sdcardfs_setattr - apply size and time changes to the lower inode
+ *
+ * Ownership and mode are fixed per mount; like the sdcard daemon, requests
+ * to change them are accepted and ignored so that tools copying files onto
+ * the storage do not fail.
+ */
+static int sdcardfs_setattr(struct dentry *dentry, struct iattr *ia)
+{
+	struct inode *inode = dentry->d_inode;
+	struct inode *lower_inode = sdcardfs_lower_inode(inode);
+	const struct cred *old_cred;
+	struct path lower_path;
+	struct iattr lower_ia;
+	int err;
+
+	ia->ia_valid &= ~(ATTR_UID | ATTR_GID | ATTR_MODE);
+	err = inode_change_ok(inode, ia);
+	if (err)
+		return err;
+
+	if (ia->ia_valid & ATTR_SIZE) {
+		err = inode_newsize_ok(inode, ia->ia_size);
+		if (err)
+			return err;
+	}
+
+	lower_ia = *ia;
+	if (ia->ia_valid & ATTR_FILE)
+		lower_ia.ia_file = sdcardfs_lower_file(ia->ia_file);
+
+	old_cred = sdcardfs_override_creds(inode->i_sb);
+	if (!old_cred)
+		return -ENOMEM;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	mutex_lock(&lower_inode->i_mutex);
+	err = notify_change(lower_path.dentry, &lower_ia);
+	mutex_unlock(&lower_inode->i_mutex);
+	path_put(&lower_path);
+	revert_creds(old_cred);
+
+	sdcardfs_copy_attr(inode, lower_inode);
+	return err;
+}
+
+static int sdcardfs_getattr(struct vfsmount *mnt, struct dentry *dentry,
+			    struct kstat *stat)
+{
+	struct inode *inode = dentry->d_inode;
+	struct path lower_path;
+	struct kstat lower_stat;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	err = vfs_getattr(lower_path.mnt, lower_path.dentry, &lower_stat);
+	path_put(&lower_path);
+	if (err)
+		return err;
+
+	sdcardfs_copy_attr(inode, sdcardfs_lower_inode(inode));
+	generic_fillattr(inode, stat);
+	stat->blocks = lower_stat.blocks;
+	return 0;
+}
+
+const struct inode_operations sdcardfs_dir_iops = {
+	.create		= sdcardfs_create,
+	.lookup		= sdcardfs_lookup,
+	.unlink		= sdcardfs_unlink,
+	.mkdir		= sdcardfs_mkdir,
+	.rmdir		= sdcardfs_rmdir,
+	.rename		= sdcardfs_rename,
+	.setattr	= sdcardfs_setattr,
+	.getattr	= sdcardfs_getattr,
+};
+
+const struct inode_operations sdcardfs_main_iops = {
+	.setattr	= sdcardfs_setattr,
+	.getattr	= sdcardfs_getattr,
+};
@@ -0,0 +1,250 @@
+/*
+ * sdcardfs: mount handling and module setup
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/namei.h>
+#include <linux/parser.h>
+#include <linux/slab.h>
+#include "sdcardfs.h"
+
+enum {
+	Opt_lower_uid,
+	Opt_lower_gid,
+	Opt_uid,
+	Opt_gid,
+	Opt_mask,
+	Opt_err,
+};
+
+static const match_table_t sdcardfs_tokens = {
+	{Opt_lower_uid, "lower_uid=%u"},
+	{Opt_lower_gid, "lower_gid=%u"},
+	{Opt_uid, "uid=%u"},
+	{Opt_gid, "gid=%u"},
+	{Opt_mask, "mask=%o"},
+	{Opt_err, NULL}
+};
+
+static int sdcardfs_parse_options(struct sdcardfs_mount_options *opts,
+				  char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int option;
+
+	opts->lower_uid = SDCARDFS_DEFAULT_LOWER_UID;
+	opts->lower_gid = SDCARDFS_DEFAULT_LOWER_GID;
+	opts->uid = SDCARDFS_DEFAULT_UID;
+	opts->gid = SDCARDFS_DEFAULT_GID;
+	opts->mask = SDCARDFS_DEFAULT_MASK;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		int token;
+
+		if (!*p)
+			continue;
+
+		token = match_token(p, sdcardfs_tokens, args);
+		switch (token) {
+		case Opt_lower_uid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->lower_uid = option;
+			break;
+		case Opt_lower_gid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->lower_gid = option;
+			break;
+		case Opt_uid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->uid = option;
+			break;
+		case Opt_gid:
+			if (match_int(&args[0], &option))
+				return -EINVAL;
+			opts->gid = option;
+			break;
+		case Opt_mask:
+			if (match_octal(&args[0], &option))
+				return -EINVAL;
+			opts->mask = option & S_IRWXUGO;
+			break;
+		default:
+			printk(KERN_ERR "sdcardfs: unrecognized mount option "
+			       "\"%s\"\n", p);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static struct file_system_type sdcardfs_fs_type;
+
+/**
+ * sdcardfs_mount - stack a new sdcardfs instance on top of dev_name
+ * @dev_name: the lower directory to present
+ */
+static struct dentry *sdcardfs_mount(struct file_system_type *fs_type,
+				     int flags, const char *dev_name,
+				     void *raw_data)
+{
+	struct sdcardfs_sb_info *sbi;
+	struct super_block *s;
+	struct inode *inode;
+	struct path path;
+	int rc;
+
+	sbi = kzalloc(sizeof(*sbi), GFP_KERNEL);
+	if (!sbi)
+		return ERR_PTR(-ENOMEM);
+
+	rc = sdcardfs_parse_options(&sbi->options, raw_data);
+	if (rc) {
+		kfree(sbi);
+		return ERR_PTR(rc);
+	}
+
+	s = sget(fs_type, NULL, set_anon_super, NULL);
+	if (IS_ERR(s)) {
+		kfree(sbi);
+		return ERR_CAST(s);
+	}
+
+	/* ->kill_sb() will take care of sbi after that point */
+	s->s_flags = flags;
+	s->s_fs_info = sbi;
+	s->s_op = &sdcardfs_sops;
+	s->s_d_op = &sdcardfs_dops;
+
+	rc = kern_path(dev_name, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &path);
+	if (rc) {
+		printk(KERN_ERR "sdcardfs: cannot find lower directory %s\n",
+		       dev_name);
+		goto out_deactivate;
+	}
+	if (path.dentry->d_sb->s_type == &sdcardfs_fs_type) {
+		printk(KERN_ERR "sdcardfs: cannot stack on sdcardfs\n");
+		rc = -EINVAL;
+		goto out_put;
+	}
+
+	sbi->lower_sb = path.dentry->d_sb;
+	s->s_maxbytes = path.dentry->d_sb->s_maxbytes;
+	s->s_blocksize = path.dentry->d_sb->s_blocksize;
+	s->s_blocksize_bits = path.dentry->d_sb->s_blocksize_bits;
+	s->s_magic = SDCARDFS_SUPER_MAGIC;
+	s->s_time_gran = path.dentry->d_sb->s_time_gran;
+
+	inode = sdcardfs_get_inode(path.dentry->d_inode, s);
+	if (IS_ERR(inode)) {
+		rc = PTR_ERR(inode);
+		goto out_put;
+	}
+
+	s->s_root = d_alloc_root(inode);
+	if (!s->s_root) {
+		iput(inode);
+		rc = -ENOMEM;
+		goto out_put;
+	}
+
+	rc = sdcardfs_new_dentry_private(s->s_root);
+	if (rc)
+		goto out_put;
+
+	/* the root dentry now owns the lower path reference */
+	sdcardfs_set_lower_path(s->s_root, &path);
+
+	s->s_flags |= MS_ACTIVE;
+	return dget(s->s_root);
+
+out_put:
+	path_put(&path);
+out_deactivate:
+	deactivate_locked_super(s);
+	return ERR_PTR(rc);
+}
+
+static void sdcardfs_kill_sb(struct super_block *sb)
+{
+	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(sb);
+
+	kill_anon_super(sb);
+	kfree(sbi);
+}
+
+static struct file_system_type sdcardfs_fs_type = {
+	.owner		= THIS_MODULE,
+	.name		= SDCARDFS_NAME,
+	.mount		= sdcardfs_mount,
+	.kill_sb	= sdcardfs_kill_sb,
+	.fs_flags	= 0,
+};
+
+static void sdcardfs_inode_init_once(void *obj)
+{
+	struct sdcardfs_inode_info *info = obj;
+
+	inode_init_once(&info->vfs_inode);
+}
+
+static void sdcardfs_destroy_caches(void)
+{
+	if (sdcardfs_inode_info_cache)
+		kmem_cache_destroy(sdcardfs_inode_info_cache);
+	if (sdcardfs_dentry_info_cache)
+		kmem_cache_destroy(sdcardfs_dentry_info_cache);
+}
+
+static int __init init_sdcardfs_fs(void)
+{
+	int err;
+
+	sdcardfs_inode_info_cache =
+		kmem_cache_create("sdcardfs_inode_cache",
+				  sizeof(struct sdcardfs_inode_info), 0,
+				  SLAB_RECLAIM_ACCOUNT | SLAB_MEM_SPREAD,
+				  sdcardfs_inode_init_once);
+	sdcardfs_dentry_info_cache =
+		kmem_cache_create("sdcardfs_dentry_cache",
+				  sizeof(struct sdcardfs_dentry_info), 0,
+				  SLAB_RECLAIM_ACCOUNT, NULL);
+	if (!sdcardfs_inode_info_cache || !sdcardfs_dentry_info_cache) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	err = register_filesystem(&sdcardfs_fs_type);
+	if (!err)
+		return 0;
+out:
+	sdcardfs_destroy_caches();
+	return err;
+}
+
+static void __exit exit_sdcardfs_fs(void)
+{
+	unregister_filesystem(&sdcardfs_fs_type);
+	/* make sure all delayed rcu free inodes are gone */
+	rcu_barrier();
+	sdcardfs_destroy_caches();
+}
+
+MODULE_DESCRIPTION("Stacked filesystem for emulated external storage");
+MODULE_LICENSE("GPL");
+
+module_init(init_sdcardfs_fs);
+module_exit(exit_sdcardfs_fs);
@@ -0,0 +1,132 @@
+/*
+ * sdcardfs: stacked filesystem for emulated external storage
+ *
+ * Presents a lower directory (usually on ext4 or vfat) with the fixed
+ * ownership and permissions the userspace sdcard daemon used to apply,
+ * and forwards all I/O straight to the lower files.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#ifndef _SDCARDFS_H_
+#define _SDCARDFS_H_
+
+#include <linux/fs.h>
+#include <linux/path.h>
+#include <linux/sched.h>
+#include <linux/cred.h>
+#include <linux/spinlock.h>
+
+#define SDCARDFS_NAME		"sdcardfs"
+#define SDCARDFS_SUPER_MAGIC	0x5dca2df5
+
+/* defaults match the sdcard daemon: media_rw on disk, root:sdcard_rw above */
+#define SDCARDFS_DEFAULT_LOWER_UID	1023
+#define SDCARDFS_DEFAULT_LOWER_GID	1023
+#define SDCARDFS_DEFAULT_UID		0
+#define SDCARDFS_DEFAULT_GID		1015
+#define SDCARDFS_DEFAULT_MASK		0
+
+/* modes used for files and directories created on the lower fs */
+#define SDCARDFS_LOWER_FILE_MODE	0664
+#define SDCARDFS_LOWER_DIR_MODE		0775
+
+struct sdcardfs_mount_options {
+	uid_t lower_uid;	/* fsuid used for lower fs operations */
+	gid_t lower_gid;	/* fsgid used for lower fs operations */
+	uid_t uid;		/* owner presented for every inode */
+	gid_t gid;		/* group presented for every inode */
+	umode_t mask;		/* removed from the presented 0775/0664 */
+};
+
+struct sdcardfs_sb_info {
+	struct super_block *lower_sb;
+	struct sdcardfs_mount_options options;
+};
+
+struct sdcardfs_inode_info {
+	struct inode *lower_inode;
+	struct inode vfs_inode;
+};
+
+struct sdcardfs_dentry_info {
+	spinlock_t lock;	/* protects lower_path */
+	struct path lower_path;
+};
+
+struct sdcardfs_file_info {
+	struct file *lower_file;
+};
+
+extern const struct file_operations sdcardfs_main_fops;
+extern const struct file_operations sdcardfs_dir_fops;
+extern const struct inode_operations sdcardfs_main_iops;
+extern const struct inode_operations sdcardfs_dir_iops;
+extern const struct super_operations sdcardfs_sops;
+extern const struct dentry_operations sdcardfs_dops;
+
+extern struct kmem_cache *sdcardfs_inode_info_cache;
+extern struct kmem_cache *sdcardfs_dentry_info_cache;
+
+extern struct inode *sdcardfs_get_inode(struct inode *lower_inode,
+					struct super_block *sb);
+extern int sdcardfs_new_dentry_private(struct dentry *dentry);
+extern const struct cred *sdcardfs_override_creds(struct super_block *sb);
+extern void sdcardfs_copy_attr(struct inode *inode, struct inode *lower_inode);
+
+static inline struct sdcardfs_sb_info *SDCARDFS_SB(struct super_block *sb)
+{
+	return sb->s_fs_info;
+}
+
+static inline struct sdcardfs_inode_info *SDCARDFS_I(struct inode *inode)
+{
+	return container_of(inode, struct sdcardfs_inode_info, vfs_inode);
+}
+
+static inline struct sdcardfs_dentry_info *SDCARDFS_D(struct dentry *dentry)
+{
+	return dentry->d_fsdata;
+}
+
+static inline struct sdcardfs_file_info *SDCARDFS_F(struct file *file)
+{
+	return file->private_data;
+}
+
+static inline struct inode *sdcardfs_lower_inode(const struct inode *inode)
+{
+	return SDCARDFS_I((struct inode *)inode)->lower_inode;
+}
+
+static inline struct file *sdcardfs_lower_file(struct file *file)
+{
+	return SDCARDFS_F(file)->lower_file;
+}
+
+/* take a reference on the lower path of dentry; drop it with path_put() */
+static inline void sdcardfs_get_lower_path(struct dentry *dentry,
+					   struct path *lower_path)
+{
+	struct sdcardfs_dentry_info *info = SDCARDFS_D(dentry);
+
+	spin_lock(&info->lock);
+	*lower_path = info->lower_path;
+	path_get(lower_path);
+	spin_unlock(&info->lock);
+}
+
+static inline void sdcardfs_set_lower_path(struct dentry *dentry,
+					   struct path *lower_path)
+{
+	struct sdcardfs_dentry_info *info = SDCARDFS_D(dentry);
+
+	spin_lock(&info->lock);
+	info->lower_path = *lower_path;
+	spin_unlock(&info->lock);
+}
+
+#endif /* _SDCARDFS_H_ */
@@ -0,0 +1,86 @@
+/*
+ * sdcardfs: super block operations
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ */
+
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/statfs.h>
+#include <linux/mount.h>
+#include "sdcardfs.h"
+
+struct kmem_cache *sdcardfs_inode_info_cache;
+
+static struct inode *sdcardfs_alloc_inode(struct super_block *sb)
+{
+	struct sdcardfs_inode_info *info;
+
+	info = kmem_cache_alloc(sdcardfs_inode_info_cache, GFP_KERNEL);
+	if (!info)
+		return NULL;
+
+	info->lower_inode = NULL;
+	return &info->vfs_inode;
+}
+
+static void sdcardfs_i_callback(struct rcu_head *head)
+{
+	struct inode *inode = container_of(head, struct inode, i_rcu);
+
+	INIT_LIST_HEAD(&inode->i_dentry);
+	kmem_cache_free(sdcardfs_inode_info_cache, SDCARDFS_I(inode));
+}
+
+static void sdcardfs_destroy_inode(struct inode *inode)
+{
+	call_rcu(&inode->i_rcu, sdcardfs_i_callback);
+}
+
+/* drop the reference taken on the lower inode by sdcardfs_get_inode() */
+static void sdcardfs_evict_inode(struct inode *inode)
+{
+	truncate_inode_pages(&inode->i_data, 0);
+	end_writeback(inode);
+	iput(sdcardfs_lower_inode(inode));
+	SDCARDFS_I(inode)->lower_inode = NULL;
+}
+
+static int sdcardfs_statfs(struct dentry *dentry, struct kstatfs *buf)
+{
+	struct path lower_path;
+	int err;
+
+	sdcardfs_get_lower_path(dentry, &lower_path);
+	err = vfs_statfs(&lower_path, buf);
+	path_put(&lower_path);
+
+	buf->f_type = SDCARDFS_SUPER_MAGIC;
+	return err;
+}
+
+static int sdcardfs_show_options(struct seq_file *m, struct vfsmount *mnt)
+{
+	struct sdcardfs_mount_options *opts =
+		&SDCARDFS_SB(mnt->mnt_sb)->options;
+
+	seq_printf(m, ",lower_uid=%u,lower_gid=%u", opts->lower_uid,
+		   opts->lower_gid);
+	seq_printf(m, ",uid=%u,gid=%u,mask=%04o", opts->uid, opts->gid,
+		   opts->mask);
+	return 0;
+}
+
+const struct super_operations sdcardfs_sops = {
+	.alloc_inode	= sdcardfs_alloc_inode,
+	.destroy_inode	= sdcardfs_destroy_inode,
+	.drop_inode	= generic_drop_inode,
+	.evict_inode	= sdcardfs_evict_inode,
+	.statfs		= sdcardfs_statfs,
+	.show_options	= sdcardfs_show_options,
+};
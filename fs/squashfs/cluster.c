@@ -0,0 +1,124 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * cluster.c
+ */
+
+/*
+ * Clustered datablocks.
+ *
+ * In a filesystem with the SQUASHFS_CLUSTERED flag set, every compressed
+ * datablock is split into SQUASHFS_CLUSTER_SIZE output clusters which are
+ * compressed independently.  The block starts with a table of one __le16
+ * per cluster giving its stored size (SQUASHFS_COMPRESSED_BIT set if the
+ * cluster is stored uncompressed), followed by the clusters themselves.
+ *
+ * As the cluster size equals the page size, a single page can be read by
+ * fetching the head of the table and decompressing one cluster straight
+ * into the page, rather than decompressing the whole (by default 128K)
+ * block.  Uncompressed datablocks and fragments are unchanged.
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+/*
+ * Read the page from the clustered datablock at block (stored size bsize).
+ * Expected is the uncompressed size of the datablock, which is less than
+ * the block size only for the last block of a file without a fragment.
+ */
+int squashfs_readpage_cluster(struct page *page, u64 block, int bsize,
+	int expected)
+{
+	struct inode *inode = page->mapping->host;
+	struct super_block *sb = inode->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int cluster = page->index & mask;
+	int clusters = DIV_ROUND_UP(expected, SQUASHFS_CLUSTER_SIZE);
+	int length = SQUASHFS_COMPRESSED_SIZE_BLOCK(bsize);
+	int table_len = (cluster + 1) * sizeof(__le16);
+	int offset = clusters * sizeof(__le16);
+	int i, csize, res;
+	__le16 *table;
+	void *pageaddr;
+
+	if (cluster >= clusters || offset > length)
+		goto corrupt;
+
+	/* only the entries up to and including this cluster are needed */
+	table = kmalloc(table_len, GFP_KERNEL);
+	if (table == NULL)
+		return -ENOMEM;
+
+	res = squashfs_read_data(sb, (void **) &table, block,
+		table_len | SQUASHFS_COMPRESSED_BIT_BLOCK, NULL, table_len, 1);
+	if (res < 0) {
+		kfree(table);
+		goto failed;
+	}
+
+	for (i = 0; i < cluster; i++)
+		offset += le16_to_cpu(table[i]) & ~SQUASHFS_COMPRESSED_BIT;
+	csize = le16_to_cpu(table[cluster]);
+	kfree(table);
+
+	if (SQUASHFS_COMPRESSED(csize)) {
+		if (csize == 0)
+			goto corrupt;
+	} else {
+		csize &= ~SQUASHFS_COMPRESSED_BIT;
+		if (csize > SQUASHFS_CLUSTER_SIZE)
+			goto corrupt;
+		csize |= SQUASHFS_COMPRESSED_BIT_BLOCK;
+	}
+
+	if (offset + SQUASHFS_COMPRESSED_SIZE_BLOCK(csize) > length)
+		goto corrupt;
+
+	pageaddr = kmap(page);
+	res = squashfs_read_data(sb, &pageaddr, block + offset, csize, NULL,
+		PAGE_CACHE_SIZE, 1);
+	if (res >= 0)
+		memset(pageaddr + res, 0, PAGE_CACHE_SIZE - res);
+	kunmap(page);
+	if (res < 0)
+		goto failed;
+
+	flush_dcache_page(page);
+	SetPageUptodate(page);
+	unlock_page(page);
+	return 0;
+
+corrupt:
+	ERROR("Corrupt cluster %d in block %llx, size %x\n", cluster, block,
+		bsize);
+	return -EIO;
+
+failed:
+	ERROR("Unable to read page, block %llx, size %x\n", block, bsize);
+	return res;
+}
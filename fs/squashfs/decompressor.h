@@ -26,28 +26,49 @@
 struct squashfs_decompressor {
 	void	*(*init)(struct squashfs_sb_info *, void *, int);
 	void	(*free)(void *);
-	int	(*decompress)(struct squashfs_sb_info *, void **,
+	int	(*decompress)(struct squashfs_sb_info *, void *, void **,
 		struct buffer_head **, int, int, int, int, int);
 	int	id;
 	char	*name;
 	int	supported;
 };
 
-static inline void squashfs_decompressor_free(struct squashfs_sb_info *msblk,
-	void *s)
+/*
+ * How decompressor streams are shared between readers.  "single" keeps
+ * one stream per filesystem behind a mutex, "percpu" gives every CPU its
+ * own stream so blocks can be decompressed in parallel.
+ */
+struct squashfs_decompressor_thread_ops {
+	void	*(*create)(struct squashfs_sb_info *, void *, int);
+	void	(*destroy)(struct squashfs_sb_info *);
+	int	(*decompress)(struct squashfs_sb_info *, void **,
+		struct buffer_head **, int, int, int, int, int);
+	int	(*max_decompressors)(void);
+	char	*name;
+};
+
+static inline void squashfs_decompressor_free(struct squashfs_sb_info *msblk)
 {
-	if (msblk->decompressor)
-		msblk->decompressor->free(s);
+	if (msblk->decompressor && msblk->thread_ops && msblk->stream)
+		msblk->thread_ops->destroy(msblk);
 }
 
 static inline int squashfs_decompress(struct squashfs_sb_info *msblk,
 	void **buffer, struct buffer_head **bh, int b, int offset, int length,
 	int srclength, int pages)
 {
-	return msblk->decompressor->decompress(msblk, buffer, bh, b, offset,
+	return msblk->thread_ops->decompress(msblk, buffer, bh, b, offset,
 		length, srclength, pages);
 }
 
+/* decompressor_single.c */
+extern const struct squashfs_decompressor_thread_ops
+	squashfs_decompressor_single;
+
+/* decompressor_multi_percpu.c */
+extern const struct squashfs_decompressor_thread_ops
+	squashfs_decompressor_percpu;
+
 #ifdef CONFIG_SQUASHFS_XZ
 extern const struct squashfs_decompressor squashfs_xz_comp_ops;
 #endif
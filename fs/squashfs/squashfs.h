@@ -46,6 +46,17 @@ extern struct squashfs_cache_entry *squashfs_get_datablock(struct super_block *,
 				u64, int);
 extern void *squashfs_read_table(struct super_block *, u64, int);
 
+/* cluster.c */
+#ifdef CONFIG_SQUASHFS_CLUSTERED
+extern int squashfs_readpage_cluster(struct page *, u64, int, int);
+#else
+static inline int squashfs_readpage_cluster(struct page *page, u64 block,
+				int bsize, int expected)
+{
+	return -EIO;
+}
+#endif
+
 /* decompressor.c */
 extern const struct squashfs_decompressor *squashfs_lookup_decompressor(int);
 extern void *squashfs_decompressor_init(struct super_block *, unsigned short);
@@ -54,6 +65,13 @@ extern void *squashfs_decompressor_init(struct super_block *, unsigned short);
 extern __le64 *squashfs_read_inode_lookup_table(struct super_block *, u64, u64,
 				unsigned int);
 
+/* file.c */
+extern void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *,
+				int, int);
+
+/* file_xxx.c */
+extern int squashfs_readpage_block(struct page *, u64, int);
+
 /* fragment.c */
 extern int squashfs_frag_lookup(struct super_block *, unsigned int, u64 *);
 extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
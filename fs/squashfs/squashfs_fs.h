@@ -26,6 +26,9 @@
 #define SQUASHFS_CACHED_FRAGMENTS	CONFIG_SQUASHFS_FRAGMENT_CACHE_SIZE
 #define SQUASHFS_MAJOR			4
 #define SQUASHFS_MINOR			0
+
+/* Minor version of filesystems with clustered datablocks */
+#define SQUASHFS_CLUSTER_MINOR		1
 #define SQUASHFS_START			0
 
 /* size of metadata (inode and directory) blocks */
@@ -58,6 +61,7 @@
 #define SQUASHFS_DUPLICATE		6
 #define SQUASHFS_EXPORT			7
 #define SQUASHFS_COMP_OPT		10
+#define SQUASHFS_CLUSTERED		15
 
 #define SQUASHFS_BIT(flag, bit)		((flag >> bit) & 1)
 
@@ -85,6 +89,13 @@
 #define SQUASHFS_COMP_OPTS(flags)		SQUASHFS_BIT(flags, \
 						SQUASHFS_COMP_OPT)
 
+#define SQUASHFS_CLUSTERED_DATA(flags)		SQUASHFS_BIT(flags, \
+						SQUASHFS_CLUSTERED)
+
+/* Output size of each independently compressed cluster in a datablock */
+#define SQUASHFS_CLUSTER_SIZE		4096
+#define SQUASHFS_CLUSTER_LOG		12
+
 /* Max number of types and file types */
 #define SQUASHFS_DIR_TYPE		1
 #define SQUASHFS_REG_TYPE		2
@@ -53,6 +53,7 @@ struct squashfs_cache_entry {
 
 struct squashfs_sb_info {
 	const struct squashfs_decompressor	*decompressor;
+	const struct squashfs_decompressor_thread_ops *thread_ops;
 	int					devblksize;
 	int					devblksize_log2;
 	struct squashfs_cache			*block_cache;
@@ -62,7 +63,6 @@ struct squashfs_sb_info {
 	__le64					*id_table;
 	__le64					*fragment_index;
 	__le64					*xattr_id_table;
-	struct mutex				read_data_mutex;
 	struct mutex				meta_index_mutex;
 	struct meta_index			*meta_index;
 	void					*stream;
@@ -72,6 +72,7 @@ struct squashfs_sb_info {
 	u64					xattr_table;
 	unsigned int				block_size;
 	unsigned short				block_log;
+	int					clustered;
 	long long				bytes_used;
 	unsigned int				inodes;
 	int					xattr_ids;
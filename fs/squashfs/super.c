@@ -36,6 +36,9 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
+#include <linux/mount.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -47,6 +50,56 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+enum {
+	Opt_threads_single,
+	Opt_threads_percpu,
+	Opt_err
+};
+
+static const match_table_t squashfs_tokens = {
+	{Opt_threads_single, "threads=single"},
+	{Opt_threads_percpu, "threads=percpu"},
+	{Opt_err, NULL}
+};
+
+#ifdef CONFIG_SQUASHFS_DECOMP_MULTI_PERCPU
+#define SQUASHFS_DEFAULT_THREAD_OPS	(&squashfs_decompressor_percpu)
+#else
+#define SQUASHFS_DEFAULT_THREAD_OPS	(&squashfs_decompressor_single)
+#endif
+
+static int squashfs_parse_options(struct squashfs_sb_info *msblk,
+	char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+
+	msblk->thread_ops = SQUASHFS_DEFAULT_THREAD_OPS;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, squashfs_tokens, args)) {
+		case Opt_threads_single:
+			msblk->thread_ops = &squashfs_decompressor_single;
+			break;
+		case Opt_threads_percpu:
+			msblk->thread_ops = &squashfs_decompressor_percpu;
+			break;
+		default:
+			ERROR("Unrecognised mount option \"%s\"\n", p);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -56,7 +109,11 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 		ERROR("Major/Minor mismatch, older Squashfs %d.%d "
 			"filesystems are unsupported\n", major, minor);
 		return NULL;
-	} else if (major > SQUASHFS_MAJOR || minor > SQUASHFS_MINOR) {
+	} else if (major > SQUASHFS_MAJOR || (minor > SQUASHFS_MINOR
+#ifdef CONFIG_SQUASHFS_CLUSTERED
+			&& minor != SQUASHFS_CLUSTER_MINOR
+#endif
+			)) {
 		ERROR("Major/Minor mismatch, trying to mount newer "
 			"%d.%d filesystem\n", major, minor);
 		ERROR("Please update your kernel\n");
@@ -98,9 +155,12 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	msblk->devblksize = sb_min_blocksize(sb, BLOCK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
-	mutex_init(&msblk->read_data_mutex);
 	mutex_init(&msblk->meta_index_mutex);
 
+	err = squashfs_parse_options(msblk, data);
+	if (err)
+		goto failed_mount;
+
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
 	 * are not beyond filesystem end.  But as we're using
@@ -172,11 +232,28 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	msblk->inodes = le32_to_cpu(sblk->inodes);
 	flags = le16_to_cpu(sblk->flags);
 
+	/*
+	 * Clustered datablocks are only understood by kernels accepting the
+	 * bumped minor version, so the two must always go together.
+	 */
+	msblk->clustered = SQUASHFS_CLUSTERED_DATA(flags);
+	if (msblk->clustered != (le16_to_cpu(sblk->s_minor) ==
+						SQUASHFS_CLUSTER_MINOR)) {
+		ERROR("Inconsistent clustered datablock flag\n");
+		goto failed_mount;
+	}
+	if (msblk->clustered && PAGE_CACHE_SIZE != SQUASHFS_CLUSTER_SIZE) {
+		ERROR("Clustered datablocks need %d byte pages\n",
+			SQUASHFS_CLUSTER_SIZE);
+		goto failed_mount;
+	}
+
 	TRACE("Found valid superblock on %s\n", bdevname(sb->s_bdev, b));
 	TRACE("Inodes are %scompressed\n", SQUASHFS_UNCOMPRESSED_INODES(flags)
 				? "un" : "");
 	TRACE("Data is %scompressed\n", SQUASHFS_UNCOMPRESSED_DATA(flags)
 				? "un" : "");
+	TRACE("Data is %sclustered\n", msblk->clustered ? "" : "not ");
 	TRACE("Filesystem size %lld bytes\n", msblk->bytes_used);
 	TRACE("Block size %d\n", msblk->block_size);
 	TRACE("Number of inodes %d\n", msblk->inodes);
@@ -200,8 +277,12 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
-	/* Allocate read_page block */
-	msblk->read_page = squashfs_cache_init("data", 1, msblk->block_size);
+	/*
+	 * Allocate read_page blocks, one for each reader that can be
+	 * decompressing at the same time
+	 */
+	msblk->read_page = squashfs_cache_init("data",
+		msblk->thread_ops->max_decompressors(), msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
@@ -332,7 +413,7 @@ failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
-	squashfs_decompressor_free(msblk, msblk->stream);
+	squashfs_decompressor_free(msblk);
 	kfree(msblk->inode_lookup_table);
 	kfree(msblk->fragment_index);
 	kfree(msblk->id_table);
@@ -365,6 +446,15 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 }
 
 
+static int squashfs_show_options(struct seq_file *m, struct vfsmount *mnt)
+{
+	struct squashfs_sb_info *msblk = mnt->mnt_sb->s_fs_info;
+
+	seq_printf(m, ",threads=%s", msblk->thread_ops->name);
+	return 0;
+}
+
+
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
 	*flags |= MS_RDONLY;
@@ -379,7 +469,7 @@ static void squashfs_put_super(struct super_block *sb)
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
-		squashfs_decompressor_free(sbi, sbi->stream);
+		squashfs_decompressor_free(sbi);
 		kfree(sbi->id_table);
 		kfree(sbi->fragment_index);
 		kfree(sbi->meta_index);
@@ -487,7 +577,8 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
-	.remount_fs = squashfs_remount
+	.remount_fs = squashfs_remount,
+	.show_options = squashfs_show_options
 };
 
 module_init(init_squashfs_fs);
@@ -43,7 +43,8 @@ struct dentry_stat_t {
 	int nr_unused;
 	int age_limit;          /* age in seconds */
 	int want_pages;         /* pages requested by system */
-	int dummy[2];
+	int nr_negative;	/* unused negative dentries */
+	int dummy;
 };
 extern struct dentry_stat_t dentry_stat;
 
@@ -220,6 +221,8 @@ struct dentry_operations {
 #define DCACHE_MANAGED_DENTRY \
 	(DCACHE_MOUNTED|DCACHE_NEED_AUTOMOUNT|DCACHE_MANAGE_TRANSIT)
 
+#define DCACHE_NEGATIVE_LRU	0x80000	/* on the sb negative dentry LRU */
+
 extern seqlock_t rename_lock;
 
 static inline int dname_external(struct dentry *dentry)
@@ -421,5 +424,8 @@ static inline bool d_mountpoint(struct dentry *dentry)
 extern struct dentry *lookup_create(struct nameidata *nd, int is_dir);
 
 extern int sysctl_vfs_cache_pressure;
+extern int sysctl_negative_dentry_limit;
+
+extern void d_negative_referenced(struct dentry *dentry);
 
 #endif	/* __LINUX_DCACHE_H */
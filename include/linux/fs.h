@@ -1397,9 +1397,14 @@ struct super_block {
 #else
 	struct list_head	s_files;
 #endif
-	/* s_dentry_lru, s_nr_dentry_unused protected by dcache.c lru locks */
+	/*
+	 * s_dentry_lru, s_negative_lru, s_nr_dentry_unused and
+	 * s_nr_negative_unused protected by dcache.c lru locks
+	 */
 	struct list_head	s_dentry_lru;	/* unused dentry lru */
-	int			s_nr_dentry_unused;	/* # of dentry on lru */
+	struct list_head	s_negative_lru;	/* unused negative dentry lru */
+	int			s_nr_dentry_unused;	/* # of dentry on lrus */
+	int			s_nr_negative_unused;	/* # on negative lru */
 
 	struct block_device	*s_bdev;
 	struct backing_dev_info *s_bdi;
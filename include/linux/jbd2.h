@@ -74,6 +74,7 @@ extern void *jbd2_alloc(size_t size, gfp_t flags);
 extern void jbd2_free(void *ptr, size_t size);
 
 #define JBD2_MIN_JOURNAL_BLOCKS 1024
+#define JBD2_DEFAULT_FAST_COMMIT_BLOCKS 256
 
 #ifdef __KERNEL__
 
@@ -241,7 +242,12 @@ typedef struct journal_superblock_s
 	__be32	s_max_trans_data;	/* Limit of data blocks per trans. */
 
 /* 0x0050 */
-	__u32	s_padding[44];
+	__u32	s_padding[42];
+
+/* 0x00F8 */
+	__be32	s_inode_fc_blks;	/* Nr of blocks of the inode fast
+					   commit area, 0 for the default */
+	__u32	s_padding2;
 
 /* 0x0100 */
 	__u8	s_users[16*48];		/* ids of all fs'es sharing the log */
@@ -263,13 +269,19 @@ typedef struct journal_superblock_s
 #define JBD2_FEATURE_INCOMPAT_REVOKE		0x00000001
 #define JBD2_FEATURE_INCOMPAT_64BIT		0x00000002
 #define JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT	0x00000004
+/*
+ * Fast commits of raw inodes, specific to this tree: not the upstream
+ * FAST_COMMIT feature (0x20), whose tagged records they cannot replay.
+ */
+#define JBD2_FEATURE_INCOMPAT_INODE_FC		0x80000000
 
 /* Features known to this kernel version: */
 #define JBD2_KNOWN_COMPAT_FEATURES	JBD2_FEATURE_COMPAT_CHECKSUM
 #define JBD2_KNOWN_ROCOMPAT_FEATURES	0
 #define JBD2_KNOWN_INCOMPAT_FEATURES	(JBD2_FEATURE_INCOMPAT_REVOKE | \
 					JBD2_FEATURE_INCOMPAT_64BIT | \
-					JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT)
+					JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT | \
+					JBD2_FEATURE_INCOMPAT_INODE_FC)
 
 #ifdef __KERNEL__
 
@@ -874,6 +886,22 @@ struct journal_s
 	unsigned long		j_first;
 	unsigned long		j_last;
 
+	/*
+	 * Fast commit area: blocks j_fc_first to j_fc_last - 1, past the end
+	 * of the log, of which the first j_fc_off are in use by fast
+	 * commits of the running transaction.  [j_state_lock]
+	 * [j_fc_off: JBD2_FAST_COMMIT_ONGOING holder]
+	 */
+	unsigned long		j_fc_first;
+	unsigned long		j_fc_last;
+	unsigned long		j_fc_off;
+
+	/* Transaction whose fast commits recovery left to replay */
+	tid_t			j_fc_replay_tid;
+
+	/* Wait queue for the end of a fast or a full commit */
+	wait_queue_head_t	j_fc_wait;
+
 	/*
 	 * Device, blocksize and starting block offset for the location where we
 	 * store the journal.
@@ -1016,6 +1044,11 @@ struct journal_s
 #define JBD2_ABORT_ON_SYNCDATA_ERR	0x040	/* Abort the journal on file
 						 * data write error in ordered
 						 * mode */
+#define JBD2_FAST_COMMIT_ONGOING	0x080	/* A fast commit is writing
+						 * to the fast commit area */
+#define JBD2_FULL_COMMIT_ONGOING	0x100	/* A full commit is running */
+#define JBD2_FC_REPLAY	0x200	/* Recovery found fast commits of
+				 * j_fc_replay_tid to replay */
 
 /*
  * Function declarations for the journaling transaction and buffer
@@ -1231,6 +1264,13 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
+/* Fast commits */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid);
+void jbd2_fc_end_commit(journal_t *journal);
+int jbd2_fc_get_buf(journal_t *journal, struct buffer_head **bh_out);
+int jbd2_fc_read_buf(journal_t *journal, unsigned long off,
+		     struct buffer_head **bh_out);
+
 void __jbd2_log_wait_for_space(journal_t *journal);
 extern void __jbd2_journal_drop_transaction(journal_t *, transaction_t *);
 extern int jbd2_cleanup_journal_tail(journal_t *);
@@ -119,6 +119,11 @@ struct pid_namespace;
 extern int pid_ns_prepare_proc(struct pid_namespace *ns);
 extern void pid_ns_release_proc(struct pid_namespace *ns);
 
+struct seq_file;
+
+/* architecture specific lines of /proc/<pid>/status */
+extern void arch_proc_pid_status(struct seq_file *m, struct task_struct *task);
+
 /*
  * proc_tty.c
  */
@@ -60,6 +60,9 @@ extern const char raid6_empty_zero_page[PAGE_SIZE];
 #define cpu_has_feature(x) 1
 #define enable_kernel_altivec()
 #define disable_kernel_altivec()
+#define cpu_has_neon() 1
+#define kernel_neon_begin()
+#define kernel_neon_end()
 
 #define EXPORT_SYMBOL(sym)
 #define EXPORT_SYMBOL_GPL(sym)
@@ -98,6 +101,10 @@ extern const struct raid6_calls raid6_altivec1;
 extern const struct raid6_calls raid6_altivec2;
 extern const struct raid6_calls raid6_altivec4;
 extern const struct raid6_calls raid6_altivec8;
+extern const struct raid6_calls raid6_neon1;
+extern const struct raid6_calls raid6_neon2;
+extern const struct raid6_calls raid6_neon4;
+extern const struct raid6_calls raid6_neon8;
 
 /* Algorithm list */
 extern const struct raid6_calls * const raid6_algos[];
@@ -6,27 +6,52 @@
 #define CRCPOLY_LE 0xedb88320
 #define CRCPOLY_BE 0x04c11db7
 
-/* How many bits at a time to use.  Requires a table of 4<<CRC_xx_BITS bytes. */
-/* For less performance-sensitive, use 4 */
-#ifndef CRC_LE_BITS 
-# define CRC_LE_BITS 8
+/*
+ * This is the CRC32c polynomial, as outlined by Castagnoli.
+ * x^32+x^28+x^27+x^26+x^25+x^23+x^22+x^20+x^19+x^18+x^14+x^13+x^11+x^10+x^9+
+ * x^8+x^6+x^0
+ */
+#define CRC32C_POLY_LE 0x82F63B78
+
+/*
+ * How many bits at a time to use.  1, 2 and 4 use one table of 1 << bits
+ * entries, 8 uses one table of 256 entries (Sarwate), 32 uses four tables
+ * (slice-by-4) and 64 eight tables (slice-by-8) of 256 entries.
+ */
+#ifndef CRC_LE_BITS
+# ifdef CONFIG_CRC32_BIT
+#  define CRC_LE_BITS 1
+# elif defined CONFIG_CRC32_SARWATE
+#  define CRC_LE_BITS 8
+# elif defined CONFIG_CRC32_SLICEBY4
+#  define CRC_LE_BITS 32
+# else
+#  define CRC_LE_BITS 64
+# endif
 #endif
 #ifndef CRC_BE_BITS
-# define CRC_BE_BITS 8
+# define CRC_BE_BITS CRC_LE_BITS
 #endif
 
 /*
  * Little-endian CRC computation.  Used with serial bit streams sent
  * lsbit-first.  Be sure to use cpu_to_le32() to append the computed CRC.
  */
-#if CRC_LE_BITS > 8 || CRC_LE_BITS < 1 || CRC_LE_BITS & CRC_LE_BITS-1
-# error CRC_LE_BITS must be a power of 2 between 1 and 8
+#if CRC_LE_BITS > 64 || CRC_LE_BITS < 1 || CRC_LE_BITS == 16 || \
+	CRC_LE_BITS & CRC_LE_BITS-1
+# error "CRC_LE_BITS must be one of {1, 2, 4, 8, 32, 64}"
 #endif
 
 /*
  * Big-endian CRC computation.  Used with serial bit streams sent
  * msbit-first.  Be sure to use cpu_to_be32() to append the computed CRC.
  */
-#if CRC_BE_BITS > 8 || CRC_BE_BITS < 1 || CRC_BE_BITS & CRC_BE_BITS-1
-# error CRC_BE_BITS must be a power of 2 between 1 and 8
+#if CRC_BE_BITS > 64 || CRC_BE_BITS < 1 || CRC_BE_BITS == 16 || \
+	CRC_BE_BITS & CRC_BE_BITS-1
+# error "CRC_BE_BITS must be one of {1, 2, 4, 8, 32, 64}"
+#endif
+
+/* The slice-by-4/8 code is shared, so both directions must use the same. */
+#if (CRC_LE_BITS > 8 || CRC_BE_BITS > 8) && CRC_LE_BITS != CRC_BE_BITS
+# error "CRC_LE_BITS and CRC_BE_BITS must match when above 8"
 #endif
@@ -59,6 +59,12 @@ const struct raid6_calls * const raid6_algos[] = {
 	&raid6_altivec2,
 	&raid6_altivec4,
 	&raid6_altivec8,
+#endif
+#ifdef CONFIG_KERNEL_MODE_NEON
+	&raid6_neon1,
+	&raid6_neon2,
+	&raid6_neon4,
+	&raid6_neon8,
 #endif
 	NULL
 };
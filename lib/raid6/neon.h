@@ -0,0 +1,16 @@
+/*
+ * linux/lib/raid6/neon.h
+ *
+ * Syndrome generators built from neon.uc.  This header is included both
+ * from neon.c and from the unrolled neon$#.c files, so it must not pull
+ * in any kernel headers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+void raid6_neon1_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs);
+void raid6_neon2_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs);
+void raid6_neon4_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs);
+void raid6_neon8_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs);
@@ -0,0 +1,323 @@
+/*
+ * Self-test and per-packet benchmark for socket filters.
+ *
+ * Each filter is run over a few crafted frames: a linear Ethernet/IPv4/TCP
+ * frame, the same frame with everything past the IP header in a page
+ * fragment, and a truncated one, so both the direct and the
+ * skb_copy_bits() paths of the load instructions are exercised.  The
+ * result of the BPF JIT, if the filter was compiled, must match the one
+ * of sk_run_filter().  Enable the JIT with the net.core.bpf_jit_enable
+ * sysctl before loading the module.  The init function always returns
+ * -EINVAL, so comparing runs with and without the JIT needs no rmmod.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/gfp.h>
+#include <linux/hrtimer.h>
+#include <linux/if_ether.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/skbuff.h>
+#include <linux/filter.h>
+
+#define BENCH_LOOPS	10000
+#define MAX_INSNS	24
+
+struct bpf_test {
+	const char *name;
+	struct sock_filter insns[MAX_INSNS];
+	/* expected result for the linear, fragmented and short frames */
+	unsigned int expect[3];
+};
+
+static struct bpf_test bpf_tests[] __initdata = {
+	{
+		"ret_k",
+		{
+			BPF_STMT(BPF_RET | BPF_K, 0xffff),
+		},
+		{ 0xffff, 0xffff, 0xffff },
+	},
+	{
+		"ip",
+		{
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 0xffff),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		{ 0xffff, 0xffff, 0xffff },
+	},
+	{
+		/* tcpdump -dd tcp dst port 22 (IPv4 part) */
+		"tcp_dst_port_22",
+		{
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 8),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 6, 0, 6),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 4, 0),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 22, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 0xffff),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		{ 0xffff, 0xffff, 0 },
+	},
+	{
+		/* tcpdump -dd udp dst port 68, as used by DHCP clients */
+		"udp_dst_port_68",
+		{
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 8),
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 17, 0, 6),
+			BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+			BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 4, 0),
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+			BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 68, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, 0xffff),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		},
+		{ 0, 0, 0 },
+	},
+	{
+		/* 32 bit load from the payload, past the linear part */
+		"ld_w_payload",
+		{
+			BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+			BPF_STMT(BPF_LD | BPF_W | BPF_IND, 14 + 20 + 1),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		{ 0x2728292a, 0x2728292a, 0 },
+	},
+	{
+		"alu",
+		{
+			BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+			BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 1000003),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 7),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 0x12345678),
+			BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 3),
+			BPF_STMT(BPF_ALU | BPF_OR | BPF_K, 0x80000001),
+			BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 1),
+			BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xfff0ffff),
+			BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 0x1000),
+			BPF_STMT(BPF_ALU | BPF_NEG, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		{ 0xb2dfa2fc, 0xb2dfa2fc, 0xb68f5324 },
+	},
+	{
+		"alu_x_scratch",
+		{
+			BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+			BPF_STMT(BPF_ST, 3),
+			BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, 5),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_MEM, 3),
+			BPF_STMT(BPF_ALU | BPF_MUL | BPF_X, 0),
+			BPF_STMT(BPF_STX, 15),
+			BPF_STMT(BPF_LDX | BPF_MEM, 15),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		{ 3225, 3225, 84 },
+	},
+	{
+		/* division by a zero X ends the filter with 0 */
+		"div_x_zero",
+		{
+			BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+			BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, 0),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_K, 1),
+		},
+		{ 0, 0, 0 },
+	},
+	{
+		/* so does a load past the end of the packet */
+		"ld_out_of_bounds",
+		{
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 1000),
+			BPF_STMT(BPF_RET | BPF_K, 1),
+		},
+		{ 0, 0, 0 },
+	},
+	{
+		/* IP protocol through the network header */
+		"ld_net_off",
+		{
+			BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF + 9),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		{ 6, 6, 0 },
+	},
+	{
+		/* protocol + mark + rxhash */
+		"ancillary",
+		{
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_PROTOCOL),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_MARK),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+				 SKF_AD_OFF + SKF_AD_RXHASH),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		},
+		{ 0x11a34, 0x11a34, 0x11a34 },
+	},
+};
+
+/* Ethernet, IPv4 and TCP headers to port 22, then a counting payload */
+static const u8 frame_hdr[] __initconst = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x00, 0x66,
+	0x77, 0x88, 0x99, 0xaa, 0x08, 0x00,
+	0x45, 0x00, 0x00, 0x72, 0x12, 0x34, 0x40, 0x00,
+	0x40, 0x06, 0x00, 0x00, 0xc0, 0xa8, 0x00, 0x01,
+	0xc0, 0xa8, 0x00, 0x02,
+	0xc3, 0x50, 0x00, 0x16,
+};
+
+#define FRAME_LEN	128
+#define FRAME_SHORT	20
+/* the fragmented frame has only the Ethernet and IP headers linear */
+#define FRAME_HEADLEN	(ETH_HLEN + 20)
+
+static void __init frame_fill(u8 *buf)
+{
+	int i;
+
+	memcpy(buf, frame_hdr, sizeof(frame_hdr));
+	for (i = sizeof(frame_hdr); i < FRAME_LEN; i++)
+		buf[i] = i - 16;
+}
+
+static struct sk_buff *__init frame_skb(const u8 *frame, int len, int headlen)
+{
+	struct sk_buff *skb;
+	struct page *page;
+
+	skb = alloc_skb(headlen, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+	memcpy(skb_put(skb, headlen), frame, headlen);
+
+	if (len > headlen) {
+		page = alloc_page(GFP_KERNEL);
+		if (!page) {
+			kfree_skb(skb);
+			return NULL;
+		}
+		memcpy(page_address(page), frame + headlen, len - headlen);
+		skb_fill_page_desc(skb, 0, page, 0, len - headlen);
+		skb->len += len - headlen;
+		skb->data_len += len - headlen;
+		skb->truesize += PAGE_SIZE;
+	}
+
+	skb->protocol = htons(ETH_P_IP);
+	skb->mark = 0x1234;
+	skb->rxhash = 0x10000;
+	skb_set_network_header(skb, ETH_HLEN);
+	return skb;
+}
+
+static s64 __init bpf_bench(struct sk_buff *skb, struct sk_filter *fp,
+			    int jit)
+{
+	ktime_t start;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < BENCH_LOOPS; i++) {
+		if (jit)
+			fp->bpf_func(skb, fp->insns);
+		else
+			sk_run_filter(skb, fp->insns);
+	}
+	return div_s64(ktime_to_ns(ktime_sub(ktime_get(), start)), BENCH_LOOPS);
+}
+
+static int __init bpf_run_test(struct bpf_test *t, struct sk_buff *skbs[3])
+{
+	static const char * const kind[3] = { "linear", "frag", "short" };
+	struct sock_fprog fprog;
+	struct sk_filter *fp;
+	unsigned int ret, jret;
+	int i, len, jit, err, errors = 0;
+
+	/* the unused tail of insns[] is zeroed, no filter ends in ld #0 */
+	for (len = MAX_INSNS; len > 1; len--)
+		if (t->insns[len - 1].code)
+			break;
+	fprog.len = len;
+	fprog.filter = t->insns;
+
+	err = sk_unattached_filter_create(&fp, &fprog);
+	if (err) {
+		printk(KERN_ERR "test_bpf: %s: rejected (%d)\n", t->name, err);
+		return 1;
+	}
+	jit = fp->bpf_func != sk_run_filter;
+
+	for (i = 0; i < 3; i++) {
+		ret = sk_run_filter(skbs[i], fp->insns);
+		jret = jit ? fp->bpf_func(skbs[i], fp->insns) : ret;
+		if (ret != t->expect[i] || jret != ret) {
+			printk(KERN_ERR "test_bpf: %s/%s: expected %#x, interpreter %#x, jit %#x\n",
+			       t->name, kind[i], t->expect[i], ret, jret);
+			errors++;
+			continue;
+		}
+		printk(KERN_INFO "test_bpf: %-16s %-6s interpreter %4lld ns",
+		       t->name, kind[i], bpf_bench(skbs[i], fp, 0));
+		if (jit)
+			printk(KERN_CONT ", jit %4lld ns", bpf_bench(skbs[i], fp, 1));
+		printk(KERN_CONT "\n");
+	}
+
+	sk_unattached_filter_destroy(fp);
+	return errors;
+}
+
+static int __init test_bpf_init(void)
+{
+	struct sk_buff *skbs[3];
+	u8 frame[FRAME_LEN];
+	int i, errors = 0;
+
+	frame_fill(frame);
+	skbs[0] = frame_skb(frame, FRAME_LEN, FRAME_LEN);
+	skbs[1] = frame_skb(frame, FRAME_LEN, FRAME_HEADLEN);
+	skbs[2] = frame_skb(frame, FRAME_SHORT, FRAME_SHORT);
+	if (!skbs[0] || !skbs[1] || !skbs[2])
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(bpf_tests); i++)
+		errors += bpf_run_test(&bpf_tests[i], skbs);
+
+	if (errors)
+		printk(KERN_ERR "test_bpf: %d checks FAILED\n", errors);
+	else
+		printk(KERN_INFO "test_bpf: %zu checks passed\n",
+		       3 * ARRAY_SIZE(bpf_tests));
+out:
+	for (i = 0; i < 3; i++)
+		kfree_skb(skbs[i]);
+	return -EINVAL;
+}
+module_init(test_bpf_init);
+MODULE_DESCRIPTION("Socket filter self-test and benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,234 @@
+/*
+ * Self-test and throughput benchmark for memcpy(), copy_page(),
+ * clear_page() and the user copy routines.
+ *
+ * memcpy() is checked against a byte loop for all source and destination
+ * alignments over a range of lengths, since architectures may switch to a
+ * different implementation above some size.  The throughput is then
+ * printed per size class; the largest class doesn't fit in the L2 cache
+ * of most systems and shows the memory bound case.  The user copies go
+ * to and from an anonymous mapping in the address space of the process
+ * loading the module, and are checked the same way before they are
+ * timed.  That mapping is removed again and the init function returns
+ * -EINVAL, so the module never stays loaded.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define BUF_LEN		(1024 * 1024)
+#define BENCH_BYTES	(16 * 1024 * 1024)
+
+static const unsigned int sizes[] __initconst = {
+	64, 256, 1024, 4096, 16384, 65536, BUF_LEN,
+};
+
+static const unsigned int test_lens[] __initconst = {
+	1, 3, 15, 16, 63, 64, 255, 256, 257, 511, 1000, 4095, 4096, 4097,
+	20000,
+};
+
+static int __init memcpy_selftest(u8 *dst, u8 *src)
+{
+	unsigned int i, n, s, d, errors = 0;
+
+	for (i = 0; i < BUF_LEN; i++)
+		src[i] = i * 7 + (i >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(test_lens); i++) {
+		n = test_lens[i];
+		for (s = 0; s < 16; s++) {
+			for (d = 0; d < 16; d++) {
+				memset(dst, 0xa5, n + 32);
+				memcpy(dst + d, src + s, n);
+				if (memcmp(dst + d, src + s, n) ||
+				    dst[d + n] != 0xa5 || (d && dst[d - 1] != 0xa5))
+					errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+/*
+ * Round trip through user space: copy_to_user() of the pattern at every
+ * source and user alignment, copy_from_user() back, and check the data
+ * and the bytes around it on both sides.  The user range straddles a
+ * page boundary.
+ */
+static int __init usercopy_selftest(u8 *dst, u8 *src, u8 __user *ubuf)
+{
+	unsigned int i, n, s, u, errors = 0;
+	u8 __user *up;
+	u8 before, after;
+
+	for (i = 0; i < ARRAY_SIZE(test_lens); i++) {
+		n = test_lens[i];
+		for (s = 0; s < 8; s++) {
+			for (u = 0; u < 8; u++) {
+				up = ubuf + 8 * PAGE_SIZE - n / 2 + u;
+				memset(dst, 0xa5, n + 32);
+				if (copy_to_user(up - 16, dst, n + 32) ||
+				    copy_to_user(up, src + s, n) ||
+				    copy_from_user(dst + s, up, n) ||
+				    get_user(before, up - 1) ||
+				    get_user(after, up + n)) {
+					errors++;
+					continue;
+				}
+				if (memcmp(dst + s, src + s, n) ||
+				    before != 0xa5 || after != 0xa5 ||
+				    dst[s + n] != 0xa5 || (s && dst[s - 1] != 0xa5))
+					errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+static void __init bench_report(const char *name, unsigned int size, s64 ns,
+				unsigned int loops)
+{
+	/* @loops copies of @size bytes took @ns; report MB/s */
+	printk(KERN_INFO "test_memcpy: %-16s %8u bytes %6lld MB/s\n", name,
+	       size, ns ? div64_s64((s64)size * loops * 1000, ns) : 0);
+}
+
+enum { BENCH_MEMCPY, BENCH_TO_USER, BENCH_FROM_USER };
+
+static void __init bench_copy(const char *name, int how, void *dst,
+			      void *src, void __user *ubuf)
+{
+	unsigned int i, j, size, loops;
+	unsigned long left = 0;
+	ktime_t start;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		size = sizes[i];
+		loops = BENCH_BYTES / size;
+		start = ktime_get();
+		for (j = 0; j < loops; j++) {
+			switch (how) {
+			case BENCH_MEMCPY:
+				memcpy(dst, src, size);
+				break;
+			case BENCH_TO_USER:
+				left |= copy_to_user(ubuf, src, size);
+				break;
+			case BENCH_FROM_USER:
+				left |= copy_from_user(dst, ubuf, size);
+				break;
+			}
+		}
+		bench_report(name, size,
+			     ktime_to_ns(ktime_sub(ktime_get(), start)), loops);
+	}
+	if (left)
+		printk(KERN_ERR "test_memcpy: %s faulted\n", name);
+}
+
+static void __init bench_page(u8 *dst, u8 *src)
+{
+	unsigned int i, loops = BENCH_BYTES / PAGE_SIZE;
+	ktime_t start;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		copy_page(dst, src);
+	bench_report("copy_page", PAGE_SIZE,
+		     ktime_to_ns(ktime_sub(ktime_get(), start)), loops);
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		copy_page(dst + i * PAGE_SIZE % BUF_LEN,
+			  src + i * PAGE_SIZE % BUF_LEN);
+	bench_report("copy_page", BUF_LEN,
+		     ktime_to_ns(ktime_sub(ktime_get(), start)), loops /
+		     (BUF_LEN / PAGE_SIZE));
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		clear_page(dst);
+	bench_report("clear_page", PAGE_SIZE,
+		     ktime_to_ns(ktime_sub(ktime_get(), start)), loops);
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		clear_page(dst + i * PAGE_SIZE % BUF_LEN);
+	bench_report("clear_page", BUF_LEN,
+		     ktime_to_ns(ktime_sub(ktime_get(), start)), loops /
+		     (BUF_LEN / PAGE_SIZE));
+}
+
+static int __init test_memcpy_init(void)
+{
+	unsigned long uaddr = -ENOMEM;
+	u8 *src, *dst;
+	int errors;
+
+	src = vmalloc(BUF_LEN);
+	dst = vmalloc(BUF_LEN);
+	if (!src || !dst)
+		goto out;
+
+	errors = memcpy_selftest(dst, src);
+	if (errors)
+		printk(KERN_ERR "test_memcpy: %d of %zu checks FAILED\n",
+		       errors, 16 * 16 * ARRAY_SIZE(test_lens));
+	else
+		printk(KERN_INFO "test_memcpy: %zu checks passed\n",
+		       16 * 16 * ARRAY_SIZE(test_lens));
+
+	bench_copy("memcpy", BENCH_MEMCPY, dst, src, NULL);
+	bench_page(dst, src);
+
+	if (current->mm) {
+		down_write(&current->mm->mmap_sem);
+		uaddr = do_mmap(NULL, 0, BUF_LEN, PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, 0);
+		up_write(&current->mm->mmap_sem);
+	}
+	if (IS_ERR_VALUE(uaddr))
+		goto out;
+
+	/* fault the mapping in before timing anything */
+	if (clear_user((void __user *)uaddr, BUF_LEN)) {
+		printk(KERN_ERR "test_memcpy: clear_user faulted\n");
+	} else {
+		errors = usercopy_selftest(dst, src, (u8 __user *)uaddr);
+		if (errors)
+			printk(KERN_ERR "test_memcpy: %d of %zu user copy "
+			       "checks FAILED\n", errors,
+			       8 * 8 * ARRAY_SIZE(test_lens));
+		else
+			printk(KERN_INFO "test_memcpy: %zu user copy checks "
+			       "passed\n", 8 * 8 * ARRAY_SIZE(test_lens));
+
+		bench_copy("copy_to_user", BENCH_TO_USER, dst, src,
+			   (void __user *)uaddr);
+		bench_copy("copy_from_user", BENCH_FROM_USER, dst, src,
+			   (void __user *)uaddr);
+	}
+
+	down_write(&current->mm->mmap_sem);
+	do_munmap(current->mm, uaddr, BUF_LEN);
+	up_write(&current->mm->mmap_sem);
+out:
+	vfree(dst);
+	vfree(src);
+	return -EINVAL;
+}
+module_init(test_memcpy_init);
+MODULE_DESCRIPTION("memcpy, page copy and user copy self-test and benchmark");
+MODULE_LICENSE("GPL");
@@ -1274,6 +1274,7 @@ no_cached_page:
 			desc->error = error;
 			goto out;
 		}
+		ra_record_pages(filp, index, 1);
 		goto readpage;
 	}
 
@@ -1527,9 +1528,10 @@ static int page_cache_read(struct file *file, pgoff_t offset)
 			return -ENOMEM;
 
 		ret = add_to_page_cache_lru(page, mapping, offset, GFP_KERNEL);
-		if (ret == 0)
+		if (ret == 0) {
+			ra_record_pages(file, offset, 1);
 			ret = mapping->a_ops->readpage(file, page);
-		else if (ret == -EEXIST)
+		} else if (ret == -EEXIST)
 			ret = 0; /* losing race to add is OK */
 
 		page_cache_release(page);
@@ -309,3 +309,22 @@ extern u64 hwpoison_filter_flags_mask;
 extern u64 hwpoison_filter_flags_value;
 extern u64 hwpoison_filter_memcg;
 extern u32 hwpoison_filter_enable;
+
+#ifdef CONFIG_READAHEAD_RECORD
+extern int ra_recording;
+extern void __ra_record_pages(struct file *filp, pgoff_t start,
+			      unsigned long nr);
+
+/* log pages being read into the page cache while recording is on */
+static inline void ra_record_pages(struct file *filp, pgoff_t start,
+				   unsigned long nr)
+{
+	if (unlikely(ra_recording) && filp)
+		__ra_record_pages(filp, start, nr);
+}
+#else
+static inline void ra_record_pages(struct file *filp, pgoff_t start,
+				   unsigned long nr)
+{
+}
+#endif
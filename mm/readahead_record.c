@@ -0,0 +1,853 @@
+/*
+ * mm/readahead_record.c - record and replay page cache reads
+ *
+ * While recording, every range of a file that gets read into the page
+ * cache, by readahead or by a page fault that missed, is logged against
+ * that file.  Recording is started and stopped by writing "start" and
+ * "stop" to /proc/readahead_record.  Reading the file then gives the
+ * history, one line per range:
+ *
+ *	<first page> <nr pages> <path>
+ *
+ * grouped by file in the order the files were first read, and sorted and
+ * merged within each file.  Writing the same lines to /proc/readahead_replay
+ * reads those ranges back in with large readahead requests, so an app or
+ * service started afterwards finds its code and data in the page cache.
+ *
+ * For boot, "readahead_record=<secs>[,<path>]" on the command line records
+ * the first <secs> seconds after the kernel starts and saves the history
+ * to <path>.  Writing a saved history's path to /proc/readahead_prefetch
+ * from an early init hook reads the whole trace back in from a kernel
+ * thread, sorted into inode and offset order and merged, while init
+ * carries on.
+ *
+ * See Documentation/vm/readahead-record.txt.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hash.h>
+#include <linux/sort.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/capability.h>
+#include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/jiffies.h>
+#include <linux/uaccess.h>
+
+#include "internal.h"
+
+#define RA_RECORD_MAX_FILES	4096
+#define RA_RECORD_MAX_EXTENTS	16384
+#define RA_RECORD_HASH_BITS	8
+
+struct ra_record_file {
+	struct hlist_node	hash;
+	dev_t			dev;
+	unsigned long		ino;
+	unsigned int		id;	/* order in which files were first read */
+	char			*path;	/* NULL if it can't be replayed */
+};
+
+struct ra_record_extent {
+	struct ra_record_file	*file;
+	pgoff_t			start;
+	unsigned long		nr;
+};
+
+int ra_recording __read_mostly;
+
+/* serialises start/stop/clear and readers of the history */
+static DEFINE_MUTEX(ra_record_mutex);
+/* protects the history against the recording hooks */
+static DEFINE_SPINLOCK(ra_record_lock);
+
+static struct hlist_head ra_record_hash[1 << RA_RECORD_HASH_BITS];
+static unsigned int ra_record_nr_files;
+static struct ra_record_extent *ra_record_extents;
+static unsigned int ra_record_nr_extents;
+static unsigned long ra_record_dropped;
+
+static struct hlist_head *ra_record_bucket(dev_t dev, unsigned long ino)
+{
+	return &ra_record_hash[hash_long(ino ^ dev, RA_RECORD_HASH_BITS)];
+}
+
+static struct ra_record_file *ra_record_find(dev_t dev, unsigned long ino)
+{
+	struct ra_record_file *rf;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(rf, pos, ra_record_bucket(dev, ino), hash)
+		if (rf->dev == dev && rf->ino == ino)
+			return rf;
+	return NULL;
+}
+
+static void ra_record_free_file(struct ra_record_file *rf)
+{
+	if (rf) {
+		kfree(rf->path);
+		kfree(rf);
+	}
+}
+
+/*
+ * Build the history entry for a file seen for the first time.  Files
+ * without a usable absolute path (unlinked, unreachable, names with
+ * newlines) still get an entry so d_path() isn't retried on every read,
+ * but are left out of the output.
+ */
+static struct ra_record_file *ra_record_new_file(struct file *filp)
+{
+	struct inode *inode = filp->f_mapping->host;
+	struct ra_record_file *rf;
+	char *buf, *p;
+
+	rf = kzalloc(sizeof(*rf), GFP_NOFS);
+	buf = kmalloc(PATH_MAX, GFP_NOFS);
+	if (!rf || !buf) {
+		kfree(buf);
+		kfree(rf);
+		return NULL;
+	}
+
+	rf->dev = inode->i_sb->s_dev;
+	rf->ino = inode->i_ino;
+
+	p = d_path(&filp->f_path, buf, PATH_MAX);
+	if (!IS_ERR(p) && *p == '/' && !strchr(p, '\n') &&
+	    !d_unlinked(filp->f_path.dentry))
+		rf->path = kstrdup(p, GFP_NOFS);
+
+	kfree(buf);
+	return rf;
+}
+
+/*
+ * Called with pages [start, start + nr) of filp being read into the page
+ * cache, when ra_recording is set.
+ */
+void __ra_record_pages(struct file *filp, pgoff_t start, unsigned long nr)
+{
+	struct inode *inode = filp->f_mapping->host;
+	dev_t dev = inode->i_sb->s_dev;
+	struct ra_record_file *rf, *new = NULL;
+	struct ra_record_extent *ext;
+
+	spin_lock(&ra_record_lock);
+	rf = ra_record_find(dev, inode->i_ino);
+	if (!rf && ra_recording) {
+		spin_unlock(&ra_record_lock);
+		new = ra_record_new_file(filp);
+		spin_lock(&ra_record_lock);
+
+		rf = ra_record_find(dev, inode->i_ino);
+		if (!rf && new && ra_record_nr_files < RA_RECORD_MAX_FILES) {
+			rf = new;
+			new = NULL;
+			rf->id = ra_record_nr_files++;
+			hlist_add_head(&rf->hash, ra_record_bucket(dev, rf->ino));
+		}
+	}
+
+	if (!ra_recording)
+		goto out;
+
+	if (!rf || ra_record_nr_extents == RA_RECORD_MAX_EXTENTS) {
+		ra_record_dropped++;
+		goto out;
+	}
+
+	/* sequential reads of one file extend the previous extent */
+	ext = ra_record_nr_extents ?
+		&ra_record_extents[ra_record_nr_extents - 1] : NULL;
+	if (ext && ext->file == rf && ext->start + ext->nr == start) {
+		ext->nr += nr;
+	} else {
+		ext = &ra_record_extents[ra_record_nr_extents++];
+		ext->file = rf;
+		ext->start = start;
+		ext->nr = nr;
+	}
+out:
+	spin_unlock(&ra_record_lock);
+	ra_record_free_file(new);
+}
+
+/*
+ * Called with ra_record_mutex held and recording stopped.  The hooks
+ * still look files up, so the history is detached under the lock and
+ * freed after dropping it.
+ */
+static void ra_record_clear(void)
+{
+	struct ra_record_extent *extents;
+	struct ra_record_file *rf;
+	struct hlist_node *pos, *n;
+	HLIST_HEAD(files);
+	int i;
+
+	spin_lock(&ra_record_lock);
+	for (i = 0; i < ARRAY_SIZE(ra_record_hash); i++) {
+		hlist_for_each_entry_safe(rf, pos, n, &ra_record_hash[i], hash) {
+			hlist_del(&rf->hash);
+			hlist_add_head(&rf->hash, &files);
+		}
+	}
+	extents = ra_record_extents;
+	ra_record_extents = NULL;
+	ra_record_nr_extents = 0;
+	ra_record_nr_files = 0;
+	ra_record_dropped = 0;
+	spin_unlock(&ra_record_lock);
+
+	hlist_for_each_entry_safe(rf, pos, n, &files, hash)
+		ra_record_free_file(rf);
+	vfree(extents);
+}
+
+static int ra_record_start(void)
+{
+	struct ra_record_extent *extents;
+
+	if (ra_recording)
+		return 0;
+
+	ra_record_clear();
+	extents = vmalloc(RA_RECORD_MAX_EXTENTS *
+			  sizeof(struct ra_record_extent));
+	if (!extents)
+		return -ENOMEM;
+
+	spin_lock(&ra_record_lock);
+	ra_record_extents = extents;
+	ra_recording = 1;
+	spin_unlock(&ra_record_lock);
+	return 0;
+}
+
+static int ra_record_cmp(const void *a, const void *b)
+{
+	const struct ra_record_extent *x = a, *y = b;
+
+	if (x->file->id != y->file->id)
+		return x->file->id < y->file->id ? -1 : 1;
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return 0;
+}
+
+/* Stop recording, then sort the history by file and merge overlaps */
+static void ra_record_stop(void)
+{
+	struct ra_record_extent *ext, *last;
+	unsigned int i, n;
+
+	if (!ra_recording)
+		return;
+
+	spin_lock(&ra_record_lock);
+	ra_recording = 0;
+	spin_unlock(&ra_record_lock);
+
+	sort(ra_record_extents, ra_record_nr_extents,
+	     sizeof(struct ra_record_extent), ra_record_cmp, NULL);
+
+	for (i = 0, n = 0; i < ra_record_nr_extents; i++) {
+		ext = &ra_record_extents[i];
+		last = n ? &ra_record_extents[n - 1] : NULL;
+
+		if (last && last->file == ext->file &&
+		    ext->start <= last->start + last->nr) {
+			last->nr = max(last->nr, ext->start + ext->nr -
+				       last->start);
+			continue;
+		}
+		ra_record_extents[n++] = *ext;
+	}
+	ra_record_nr_extents = n;
+
+	if (ra_record_dropped)
+		printk(KERN_INFO "readahead_record: history full, %lu reads "
+		       "not recorded\n", ra_record_dropped);
+}
+
+static void *ra_record_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&ra_record_mutex);
+	if (ra_recording)
+		return ERR_PTR(-EBUSY);
+	if (*pos >= ra_record_nr_extents)
+		return NULL;
+	return &ra_record_extents[*pos];
+}
+
+static void *ra_record_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	if (++*pos >= ra_record_nr_extents)
+		return NULL;
+	return &ra_record_extents[*pos];
+}
+
+static void ra_record_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&ra_record_mutex);
+}
+
+static int ra_record_seq_show(struct seq_file *m, void *v)
+{
+	struct ra_record_extent *ext = v;
+
+	if (ext->file->path)
+		seq_printf(m, "%lu %lu %s\n", (unsigned long)ext->start,
+			   ext->nr, ext->file->path);
+	return 0;
+}
+
+static const struct seq_operations ra_record_seq_ops = {
+	.start	= ra_record_seq_start,
+	.next	= ra_record_seq_next,
+	.stop	= ra_record_seq_stop,
+	.show	= ra_record_seq_show,
+};
+
+static int ra_record_open(struct inode *inode, struct file *file)
+{
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+	return seq_open(file, &ra_record_seq_ops);
+}
+
+static ssize_t ra_record_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	char buf[16], *cmd;
+	size_t len = min(count, sizeof(buf) - 1);
+	int ret = 0;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+	cmd = strim(buf);
+
+	mutex_lock(&ra_record_mutex);
+	if (!strcmp(cmd, "start"))
+		ret = ra_record_start();
+	else if (!strcmp(cmd, "stop"))
+		ra_record_stop();
+	else if (!strcmp(cmd, "clear")) {
+		ra_record_stop();
+		ra_record_clear();
+	} else
+		ret = -EINVAL;
+	mutex_unlock(&ra_record_mutex);
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations ra_record_fops = {
+	.open		= ra_record_open,
+	.read		= seq_read,
+	.write		= ra_record_write,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+/*
+ * Replay: each writer keeps the file it is currently prefetching open and
+ * accumulates adjacent and overlapping ranges of it, so consecutive lines
+ * turn into as few, and as large, readahead requests as possible.  A line
+ * split across writes is kept in tail until its end arrives, or until the
+ * file is closed for a last line without a newline.
+ */
+struct ra_replay {
+	struct file	*filp;
+	char		*path;
+	pgoff_t		start;
+	unsigned long	nr;
+	char		*tail;
+	size_t		tail_len;
+};
+
+static void ra_replay_flush(struct ra_replay *rp)
+{
+	if (rp->filp && rp->nr)
+		force_page_cache_readahead(rp->filp->f_mapping, rp->filp,
+					   rp->start, rp->nr);
+	rp->nr = 0;
+}
+
+static void ra_replay_close(struct ra_replay *rp)
+{
+	ra_replay_flush(rp);
+	if (rp->filp)
+		fput(rp->filp);
+	rp->filp = NULL;
+	kfree(rp->path);
+	rp->path = NULL;
+}
+
+/*
+ * Parse one "<first page> <nr pages> <path>" line.  Returns 1 for a range,
+ * 0 for a blank line and -EINVAL for anything else.
+ */
+static int ra_parse_line(char *line, unsigned long *start, unsigned long *nr,
+			 char **path)
+{
+	int n = 0;
+
+	line = strim(line);
+	if (!*line)
+		return 0;
+
+	if (sscanf(line, "%lu %lu %n", start, nr, &n) != 2 || !n)
+		return -EINVAL;
+	*path = line + n;
+	if (**path != '/')
+		return -EINVAL;
+	return 1;
+}
+
+static int ra_replay_line(struct ra_replay *rp, char *line)
+{
+	unsigned long start, nr;
+	char *path;
+	int ret;
+
+	ret = ra_parse_line(line, &start, &nr, &path);
+	if (ret <= 0)
+		return ret;
+
+	if (!rp->path || strcmp(rp->path, path)) {
+		ra_replay_close(rp);
+		rp->path = kstrdup(path, GFP_KERNEL);
+		if (!rp->path)
+			return -ENOMEM;
+
+		/* files removed since they were recorded are skipped */
+		rp->filp = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+		if (IS_ERR(rp->filp))
+			rp->filp = NULL;
+	}
+
+	if (!rp->filp || !nr)
+		return 0;
+
+	if (rp->nr && start >= rp->start && start <= rp->start + rp->nr) {
+		rp->nr = max(rp->nr, start + nr - rp->start);
+		return 0;
+	}
+
+	ra_replay_flush(rp);
+	rp->start = start;
+	rp->nr = nr;
+	return 0;
+}
+
+/*
+ * Lines longer than a page are refused; writes longer than what is left
+ * of the page after a pending partial line are reported as short writes
+ * and resubmitted by the writer.
+ */
+static ssize_t ra_replay_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	struct ra_replay *rp = file->private_data;
+	size_t len = min_t(size_t, count, PAGE_SIZE - 1 - rp->tail_len);
+	char *buf, *line, *next;
+	ssize_t ret;
+
+	if (!len)
+		return count ? -EINVAL : 0;
+
+	buf = (char *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	memcpy(buf, rp->tail, rp->tail_len);
+	if (copy_from_user(buf + rp->tail_len, ubuf, len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	buf[rp->tail_len + len] = '\0';
+
+	for (line = buf; (next = strchr(line, '\n')); line = next + 1) {
+		*next = '\0';
+		ret = ra_replay_line(rp, line);
+		if (ret) {
+			rp->tail_len = 0;
+			goto out;
+		}
+	}
+
+	rp->tail_len = strlen(line);
+	memcpy(rp->tail, line, rp->tail_len);
+	ret = len;
+out:
+	free_page((unsigned long)buf);
+	return ret;
+}
+
+static int ra_replay_open(struct inode *inode, struct file *file)
+{
+	struct ra_replay *rp;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	rp = kzalloc(sizeof(*rp), GFP_KERNEL);
+	if (!rp)
+		return -ENOMEM;
+	rp->tail = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!rp->tail) {
+		kfree(rp);
+		return -ENOMEM;
+	}
+
+	file->private_data = rp;
+	return nonseekable_open(inode, file);
+}
+
+static int ra_replay_release(struct inode *inode, struct file *file)
+{
+	struct ra_replay *rp = file->private_data;
+
+	/* the last line may come without a newline */
+	if (rp->tail_len) {
+		rp->tail[rp->tail_len] = '\0';
+		ra_replay_line(rp, rp->tail);
+	}
+	ra_replay_close(rp);
+	kfree(rp->tail);
+	kfree(rp);
+	return 0;
+}
+
+static const struct file_operations ra_replay_fops = {
+	.open		= ra_replay_open,
+	.write		= ra_replay_write,
+	.release	= ra_replay_release,
+	.llseek		= no_llseek,
+};
+
+/*
+ * Boot recording.  The history is saved once recording stops; the target
+ * filesystem may not be mounted yet at that point, so saving is retried
+ * for a while.  The history also stays readable in /proc either way.
+ */
+#define RA_RECORD_SAVE_RETRIES	12
+#define RA_RECORD_SAVE_DELAY	(5 * HZ)
+
+static unsigned long ra_record_boot_secs;
+static char ra_record_boot_file[256];
+static int ra_record_save_tries;
+
+static int __init ra_record_boot_setup(char *str)
+{
+	char *path;
+
+	ra_record_boot_secs = simple_strtoul(str, &path, 0);
+	if (*path == ',')
+		strlcpy(ra_record_boot_file, path + 1,
+			sizeof(ra_record_boot_file));
+	return 1;
+}
+__setup("readahead_record=", ra_record_boot_setup);
+
+/* Write the stopped history to path, in the /proc/readahead_record format */
+static int ra_record_save(const char *path)
+{
+	struct ra_record_extent *ext;
+	struct file *filp;
+	mm_segment_t old_fs;
+	loff_t pos = 0;
+	unsigned int i;
+	char *buf;
+	int len, ret = 0;
+
+	buf = kmalloc(PATH_MAX + 48, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	filp = filp_open(path, O_WRONLY | O_CREAT | O_TRUNC | O_LARGEFILE,
+			 S_IRUSR | S_IWUSR);
+	if (IS_ERR(filp)) {
+		kfree(buf);
+		return PTR_ERR(filp);
+	}
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	for (i = 0; i < ra_record_nr_extents && ret >= 0; i++) {
+		ext = &ra_record_extents[i];
+		if (!ext->file->path)
+			continue;
+		len = snprintf(buf, PATH_MAX + 48, "%lu %lu %s\n",
+			       (unsigned long)ext->start, ext->nr,
+			       ext->file->path);
+		ret = vfs_write(filp, (char __user *)buf, len, &pos);
+	}
+	set_fs(old_fs);
+
+	if (ret >= 0)
+		ret = vfs_fsync(filp, 0);
+	fput(filp);
+	kfree(buf);
+	return ret < 0 ? ret : 0;
+}
+
+static void ra_record_boot_stop(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ra_record_boot_work, ra_record_boot_stop);
+
+static void ra_record_boot_stop(struct work_struct *work)
+{
+	int ret;
+
+	mutex_lock(&ra_record_mutex);
+	ra_record_stop();
+	/* nothing to save, or userspace has cleared or restarted it */
+	if (!ra_record_boot_file[0] || !ra_record_extents || ra_recording) {
+		mutex_unlock(&ra_record_mutex);
+		return;
+	}
+	ret = ra_record_save(ra_record_boot_file);
+	mutex_unlock(&ra_record_mutex);
+
+	if (!ret) {
+		printk(KERN_INFO "readahead_record: boot trace saved to %s\n",
+		       ra_record_boot_file);
+		return;
+	}
+
+	if (++ra_record_save_tries < RA_RECORD_SAVE_RETRIES)
+		schedule_delayed_work(&ra_record_boot_work,
+				      RA_RECORD_SAVE_DELAY);
+	else
+		printk(KERN_WARNING "readahead_record: could not save boot "
+		       "trace to %s: %d\n", ra_record_boot_file, ret);
+}
+
+/*
+ * Boot prefetch.  The whole trace is opened and read up front, so that
+ * all of it can be sorted by device, inode and offset (roughly disk order
+ * on the filesystems we use) and merged before any I/O is issued.
+ */
+#define RA_PREFETCH_MAX_TRACE	(1 << 20)
+
+struct ra_prefetch_range {
+	struct file	*filp;
+	pgoff_t		start;
+	unsigned long	nr;
+};
+
+static int ra_prefetch_cmp(const void *a, const void *b)
+{
+	const struct ra_prefetch_range *x = a, *y = b;
+	struct inode *ix = x->filp->f_mapping->host;
+	struct inode *iy = y->filp->f_mapping->host;
+
+	if (ix->i_sb->s_dev != iy->i_sb->s_dev)
+		return ix->i_sb->s_dev < iy->i_sb->s_dev ? -1 : 1;
+	if (ix->i_ino != iy->i_ino)
+		return ix->i_ino < iy->i_ino ? -1 : 1;
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return 0;
+}
+
+static char *ra_prefetch_read_trace(const char *path)
+{
+	struct file *filp;
+	loff_t size;
+	char *buf;
+	int ret;
+
+	filp = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(filp))
+		return ERR_CAST(filp);
+
+	size = i_size_read(filp->f_mapping->host);
+	if (size > RA_PREFETCH_MAX_TRACE)
+		size = RA_PREFETCH_MAX_TRACE;
+
+	buf = vmalloc(size + 1);
+	if (!buf) {
+		fput(filp);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	ret = kernel_read(filp, 0, buf, size);
+	fput(filp);
+	if (ret < 0) {
+		vfree(buf);
+		return ERR_PTR(ret);
+	}
+
+	buf[ret] = '\0';
+	return buf;
+}
+
+/* Open every file in the trace, each range holding a file reference */
+static unsigned int ra_prefetch_parse(char *trace,
+				      struct ra_prefetch_range *ranges)
+{
+	struct file *filp = NULL;
+	char *line, *next, *path, *cur_path = NULL;
+	unsigned long start, nr;
+	unsigned int n = 0;
+
+	for (line = trace; line && n < RA_RECORD_MAX_EXTENTS; line = next) {
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (ra_parse_line(line, &start, &nr, &path) <= 0 || !nr)
+			continue;
+
+		if (!cur_path || strcmp(cur_path, path)) {
+			if (filp)
+				fput(filp);
+			cur_path = path;
+			filp = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+			if (IS_ERR(filp))
+				filp = NULL;
+		}
+		if (!filp)
+			continue;
+
+		get_file(filp);
+		ranges[n].filp = filp;
+		ranges[n].start = start;
+		ranges[n].nr = nr;
+		n++;
+	}
+
+	if (filp)
+		fput(filp);
+	return n;
+}
+
+static int ra_prefetch_thread(void *data)
+{
+	char *path = data, *trace;
+	struct ra_prefetch_range *ranges, *r, *last;
+	unsigned long begin = jiffies, pages = 0;
+	unsigned int i, n, merged;
+
+	trace = ra_prefetch_read_trace(path);
+	if (IS_ERR(trace)) {
+		printk(KERN_WARNING "readahead_prefetch: cannot read %s: %ld\n",
+		       path, PTR_ERR(trace));
+		goto out;
+	}
+
+	ranges = vmalloc(RA_RECORD_MAX_EXTENTS * sizeof(*ranges));
+	if (!ranges)
+		goto out_trace;
+
+	n = ra_prefetch_parse(trace, ranges);
+	sort(ranges, n, sizeof(*ranges), ra_prefetch_cmp, NULL);
+
+	for (i = 0, merged = 0; i < n; i++) {
+		r = &ranges[i];
+		last = merged ? &ranges[merged - 1] : NULL;
+
+		if (last && last->filp->f_mapping == r->filp->f_mapping &&
+		    r->start <= last->start + last->nr) {
+			last->nr = max(last->nr, r->start + r->nr - last->start);
+			fput(r->filp);
+			continue;
+		}
+		ranges[merged++] = *r;
+	}
+
+	for (i = 0; i < merged; i++) {
+		r = &ranges[i];
+		force_page_cache_readahead(r->filp->f_mapping, r->filp,
+					   r->start, r->nr);
+		pages += r->nr;
+		fput(r->filp);
+	}
+
+	printk(KERN_INFO "readahead_prefetch: %u ranges, %lu pages from %s "
+	       "in %u ms\n", merged, pages, path,
+	       jiffies_to_msecs(jiffies - begin));
+
+	vfree(ranges);
+out_trace:
+	if (!IS_ERR(trace))
+		vfree(trace);
+out:
+	kfree(path);
+	return 0;
+}
+
+static ssize_t ra_prefetch_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char *path, *p;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+	if (count >= PATH_MAX)
+		return -ENAMETOOLONG;
+
+	path = kmalloc(count + 1, GFP_KERNEL);
+	if (!path)
+		return -ENOMEM;
+
+	if (copy_from_user(path, ubuf, count)) {
+		kfree(path);
+		return -EFAULT;
+	}
+	path[count] = '\0';
+
+	/* the thread frees path, so keep the trimmed name at its start */
+	p = strim(path);
+	if (!*p) {
+		kfree(path);
+		return -EINVAL;
+	}
+	memmove(path, p, strlen(p) + 1);
+
+	task = kthread_run(ra_prefetch_thread, path, "raprefetch");
+	if (IS_ERR(task)) {
+		kfree(path);
+		return PTR_ERR(task);
+	}
+
+	return count;
+}
+
+static const struct file_operations ra_prefetch_fops = {
+	.write		= ra_prefetch_write,
+	.llseek		= noop_llseek,
+};
+
+static int __init ra_record_init(void)
+{
+	proc_create("readahead_record", S_IRUSR | S_IWUSR, NULL,
+		    &ra_record_fops);
+	proc_create("readahead_replay", S_IWUSR, NULL, &ra_replay_fops);
+	proc_create("readahead_prefetch", S_IWUSR, NULL, &ra_prefetch_fops);
+
+	if (ra_record_boot_secs) {
+		mutex_lock(&ra_record_mutex);
+		ra_record_start();
+		mutex_unlock(&ra_record_mutex);
+		schedule_delayed_work(&ra_record_boot_work,
+				      ra_record_boot_secs * HZ);
+	}
+	return 0;
+}
+module_init(ra_record_init);
@@ -0,0 +1,200 @@
+/*
+ * sdcardfs_bench: compare emulated storage mounts
+ *
+ * Measures sequential write and read throughput and create/stat/unlink
+ * rates in each directory given on the command line, e.g. a FUSE sdcard
+ * mount and an sdcardfs mount of the same lower directory.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define BUF_SIZE	(128 * 1024)
+
+static char buf[BUF_SIZE];
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void drop_caches(void)
+{
+	int fd;
+
+	sync();
+	fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if (fd < 0)
+		return;
+	if (write(fd, "3\n", 2) < 0)
+		perror("drop_caches");
+	close(fd);
+}
+
+static int seq_write(const char *path, size_t size_mb, double *mbps)
+{
+	size_t left = size_mb << 20;
+	double start;
+	int fd;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+	if (fd < 0)
+		return -errno;
+
+	start = now();
+	while (left) {
+		ssize_t ret = write(fd, buf, left < BUF_SIZE ? left : BUF_SIZE);
+
+		if (ret < 0) {
+			close(fd);
+			return -errno;
+		}
+		left -= ret;
+	}
+	if (fsync(fd) < 0) {
+		close(fd);
+		return -errno;
+	}
+	close(fd);
+
+	*mbps = size_mb / (now() - start);
+	return 0;
+}
+
+static int seq_read(const char *path, double *mbps)
+{
+	size_t total = 0;
+	double start;
+	ssize_t ret;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	start = now();
+	while ((ret = read(fd, buf, BUF_SIZE)) > 0)
+		total += ret;
+	close(fd);
+	if (ret < 0)
+		return -errno;
+
+	*mbps = (total / (double)(1 << 20)) / (now() - start);
+	return 0;
+}
+
+static int meta_ops(const char *dir, int nr, double rates[3])
+{
+	char name[4096];
+	struct stat st;
+	double start;
+	int i, fd;
+
+	start = now();
+	for (i = 0; i < nr; i++) {
+		snprintf(name, sizeof(name), "%s/bench.%d", dir, i);
+		fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0664);
+		if (fd < 0)
+			return -errno;
+		close(fd);
+	}
+	rates[0] = nr / (now() - start);
+
+	start = now();
+	for (i = 0; i < nr; i++) {
+		snprintf(name, sizeof(name), "%s/bench.%d", dir, i);
+		if (stat(name, &st) < 0)
+			return -errno;
+	}
+	rates[1] = nr / (now() - start);
+
+	start = now();
+	for (i = 0; i < nr; i++) {
+		snprintf(name, sizeof(name), "%s/bench.%d", dir, i);
+		if (unlink(name) < 0)
+			return -errno;
+	}
+	rates[2] = nr / (now() - start);
+	return 0;
+}
+
+static int bench_dir(const char *dir, size_t size_mb, int nr)
+{
+	char path[4096];
+	double wr = 0, rd = 0, rates[3] = { 0 };
+	int err;
+
+	snprintf(path, sizeof(path), "%s/bench.seq", dir);
+
+	err = seq_write(path, size_mb, &wr);
+	if (err)
+		goto fail;
+	drop_caches();
+	err = seq_read(path, &rd);
+	unlink(path);
+	if (err)
+		goto fail;
+
+	err = meta_ops(dir, nr, rates);
+	if (err)
+		goto fail;
+
+	printf("%-24s %8.1f %8.1f %10.0f %10.0f %10.0f\n", dir, wr, rd,
+	       rates[0], rates[1], rates[2]);
+	return 0;
+
+fail:
+	fprintf(stderr, "%s: %s\n", dir, strerror(-err));
+	return 1;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-s size_mb] [-n files] dir...\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	size_t size_mb = 64;
+	int nr = 1000;
+	int opt, i, ret = 0;
+
+	while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+		switch (opt) {
+		case 's':
+			size_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			nr = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || !size_mb || nr <= 0)
+		usage(argv[0]);
+
+	memset(buf, 0x5a, sizeof(buf));
+
+	printf("%-24s %8s %8s %10s %10s %10s\n", "directory", "wr MB/s",
+	       "rd MB/s", "create/s", "stat/s", "unlink/s");
+	for (i = optind; i < argc; i++)
+		ret |= bench_dir(argv[i], size_mb, nr);
+
+	return ret;
+}